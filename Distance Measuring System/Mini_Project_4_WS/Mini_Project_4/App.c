@@ -12,14 +12,26 @@
 #include "gpio.h"
 #include "std_types.h"
 #include "ultrasonic.h"
+#include "isr_profile.h"
 #include <avr/io.h>
 #include <util/delay.h>
 
+/* Timer1 counts at F_CPU/8 for the ICU (Ultrasonic_init) */
+#define ICU_US_PER_COUNT	((uint8)(8UL * 1000000UL / F_CPU))
+
 uint16 distance = 0;
 
 int main(void) {
+#ifdef ISR_PROFILE
+	IsrProfile_StatsType stats;
+#endif
+
 	LCD_init();
 	Ultrasonic_init();
+#ifdef ISR_PROFILE
+	/* Time the ICU ISR on the free-running Timer1 count */
+	IsrProfile_init(&ICU_getTimerValue, 0xFFFF, ICU_US_PER_COUNT);
+#endif
 	LCD_displayString("Distance=    cm");
 
 	while (1) {
@@ -34,6 +46,18 @@ int main(void) {
 			/* In case the digital value is two or one digits print space in the next digit place*/
 			LCD_displayCharacter(' ');
 		}
+#ifdef ISR_PROFILE
+		/* Max execution time and latency of the ICU ISR in us */
+		IsrProfile_getStats(ISR_PROFILE_TIMER1_CAPT, &stats);
+		if (stats.runs != 0) {
+			LCD_moveCursor(1, 0);
+			LCD_displayString("ISR ");
+			LCD_intgerToString(stats.time_max_us);
+			LCD_displayString(" Lat ");
+			LCD_intgerToString(stats.latency_max_us);
+			LCD_displayString("us");
+		}
+#endif
 	}
 
 }
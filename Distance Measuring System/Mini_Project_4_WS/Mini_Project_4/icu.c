@@ -11,6 +11,7 @@
  *******************************************************************************/
 
 #include "icu.h"
+#include "isr_profile.h"
 #include "common_macros.h" /* To use the macros like SET_BIT */
 #include <avr/io.h> /* To use ICU/Timer1 Registers */
 #include <avr/interrupt.h> /* For ICU ISR */
@@ -28,11 +29,14 @@ static volatile void (*g_callBackPtr)(void) = NULL_PTR;
 
 ISR(TIMER1_CAPT_vect)
 {
+	/* The edge came at the count captured in ICR1, the latency is the count since */
+	ISR_PROFILE_ENTER_AT(ISR_PROFILE_TIMER1_CAPT, ICR1);
 	if(g_callBackPtr != NULL_PTR)
 	{
 		/* Call the Call Back function in the application after the edge is detected */
 		(*g_callBackPtr)(); /* another method to call the function using pointer to function g_callBackPtr(); */
 	}
+	ISR_PROFILE_EXIT(ISR_PROFILE_TIMER1_CAPT);
 }
 
 /*******************************************************************************
@@ -110,6 +114,14 @@ void ICU_clearTimerValue(void)
 	TCNT1 = 0;
 }
 
+/*
+ * Description: Function to get the Timer1 Value now
+ */
+uint16 ICU_getTimerValue(void)
+{
+	return TCNT1;
+}
+
 /*
  * Description: Function to disable the Timer1 to stop the ICU Driver
  */
@@ -67,6 +67,11 @@ uint16 ICU_getInputCaptureValue(void);
  */
 void ICU_clearTimerValue(void);
 
+/*
+ * Description: Function to get the Timer1 Value now
+ */
+uint16 ICU_getTimerValue(void);
+
 /*
  * Description: Function to disable the Timer1 to stop the ICU Driver
  */
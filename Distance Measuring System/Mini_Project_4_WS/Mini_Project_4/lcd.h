@@ -46,6 +46,11 @@
 
 #endif
 
+/* HD44780 execution times with a margin: 37 us for most instructions and 43 us
+ * for a data write, 1.52 ms for clear and return home */
+#define LCD_EXECUTION_TIME_US                50
+#define LCD_CLEAR_TIME_US                    2000
+
 /* LCD Commands */
 #define LCD_CLEAR_COMMAND                    0x01
 #define LCD_GO_TO_HOME                       0x02
@@ -12,6 +12,7 @@
 
 #include "ultrasonic.h"
 #include "gpio.h"
+#include "power.h"
 #include <avr/io.h>
 #include <math.h>
 #include <util/delay.h>
@@ -20,9 +21,20 @@
  *                           Global Variables                                  *
  ******************************************************************************/
 
-static uint8 g_edgeCount = 0;     /* Number of edges detected by the ICU */
+static volatile uint8 g_edgeCount = 0;     /* Number of edges detected by the ICU */
+static uint16 g_riseTime = 0;     /* Timer1 count captured at the rising edge */
 static uint16 g_highTime = 0;     /* High time between the two edges detected by the ICU */
 
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ ******************************************************************************/
+
+/* Both edges of the echo pulse captured */
+static boolean Ultrasonic_isEchoDone(void)
+{
+    return (g_edgeCount == 2);
+}
+
 /*******************************************************************************
  *                      Functions Definitions                                  *
  ******************************************************************************/
@@ -71,6 +83,7 @@ void Ultrasonic_Trigger(void)
  * Function: Ultrasonic_readDistance
  *
  * Description: Triggers the Ultrasonic Sensor and waits for two edges to be detected by the ICU.
+ * The CPU sleeps in idle mode meanwhile, Timer1 keeps counting and the ICU interrupt wakes it.
  * Calculates the distance based on the high time between these two edges and returns it.
  *
  * Inputs: None
@@ -80,7 +93,7 @@ void Ultrasonic_Trigger(void)
 uint16 Ultrasonic_readDistance(void)
 {
 	Ultrasonic_Trigger();
-	while(g_edgeCount != 2);
+	Power_waitFor(&Ultrasonic_isEchoDone, POWER_IDLE);
 	g_edgeCount = 0;
 	return ceil(g_highTime/58.8);
 }
@@ -100,17 +113,20 @@ void Ultrasonic_edgeProcessing(void)
     /* Increment the edge count */
     g_edgeCount++;
 
+    /*
+     * Timer1 runs free, so it can also time the ISRs (isr_profile.h): the high
+     * time is the difference of the two captures, modulo 2^16 across a wrap.
+     */
     if (g_edgeCount == 1)
     {
-        /* First rising edge detected, clear the time value and set the ICU to detect a falling edge */
-    	ICU_clearTimerValue();
+        /* First rising edge detected, keep its capture and set the ICU to detect a falling edge */
+    	g_riseTime = ICU_getInputCaptureValue();
     	ICU_setEdgeDetectionType(FALLING);
     }
     else if (g_edgeCount == 2)
     {
-        /* Second falling edge detected, get the input capture value and clear the time value. Set the ICU to detect a rising edge. */
-        g_highTime = ICU_getInputCaptureValue();
-        ICU_clearTimerValue();
+        /* Second falling edge detected, the high time is since the rising edge. Set the ICU to detect a rising edge. */
+        g_highTime = ICU_getInputCaptureValue() - g_riseTime;
         ICU_setEdgeDetectionType(RAISING);
     }
 
@@ -13,51 +13,169 @@
 #include <avr/io.h>
 #include <util/delay.h>
 #include "UART.h"
+#include "spi.h"
 #include "twi.h"
-#include "timer.h"
+#include "soft_timer.h"
+#include "scheduler.h"
+#include "power.h"
 #include "motor.h"
 #include "buzzer.h"
 #include "external_eeprom.h"
+#include "kv_store.h"
+#include "event_log.h"
+#include "rtc.h"
+#include "osccal.h"
+#include "isr_profile.h"
+#include "door_link.h"
 
 /*******************************************************************************
  *                                Definitions                                  *
  *******************************************************************************/
 
 /* Password-related constants */
-#define PASSWORD_LEGTH		5
+#define PASSWORD_LEGTH		DOOR_PASSWORD_LENGTH
 #define PASSWORD_MATCH			TRUE
 #define PASSWORD_UNMATCH		FALSE
-/* Communication-related constants */
-#define HMI_READY_UART			0x00
-#define CONTROL_READY_UART		0xFF
-#define EEPROM_PASS_ADDRESS		0x0300
+#define MAX_TRIALS				3
+/* Keys of the records kept in the EEPROM store */
+#define KEY_PASSWORD			0
+#define KEY_COUNTERS			1
+#define COUNTERS_LENGTH			3
+#define KEY_RTC_CALIBRATION		2
+#define CALIBRATION_LENGTH		2
+#define KEY_OSCCAL				3
+#define OSCCAL_LENGTH			1
+#if PASSWORD_LEGTH > KV_VALUE_MAX_LENGTH
+#error "The password must fit in one EEPROM store record"
+#endif
 /* Door-related constants */
 #define DOOR_OPEN_TIME 15
 #define DOOR_HOLD_TIME 3
 #define DOOR_CLOSE_TIME 15
+/* The RAM copy of the password is checked against the EEPROM every minute */
+#define CREDENTIAL_CHECK_TIME	60
 /* Alarm-related constants */
 #define ALARM_TIME				60
+/* TWI slave registers read by a supervisory MCU, REG_COMMAND is the only writable one */
+#define REG_DOOR_STATE			0
+#define REG_ALARM				1
+#define REG_TRIALS				2
+#define REG_REMAINING			3
+#define REG_OPEN_COUNT_L		4
+#define REG_OPEN_COUNT_H		5
+#define REG_ALARM_COUNT			6
+#define REG_BUS_RECOVERIES		7
+#define REG_COMMAND				8
+#define REG_MAP_SIZE			9
+/* Commands written to REG_COMMAND */
+#define CMD_NONE				0
+#define CMD_CLOSE_DOOR			1
+#define CMD_ALARM_ACK			2
+/*
+ * Scheduler tasks, the software timers first, released by the tick. A byte
+ * takes 1.04 ms at 9600 baud, so the link is polled every ms, and its RX
+ * interrupt wakes the CPU; a request writing the EEPROM may take tens of ms.
+ */
+#define TASK_LINK_PERIOD		1
+#define TASK_LINK_DEADLINE		50
+#define TASK_REGISTERS_PERIOD	100
+#define TASK_STORAGE_PERIOD		50
+#define TASK_STORAGE_DEADLINE	500
+/* Posted by the TWI ISR when the supervisor has written a command */
+#define EVENT_SUPERVISOR		SCHEDULER_EVENT(0)
+/* Posted by the Timer1 ISR every software timer tick */
+#define EVENT_TICK				SCHEDULER_EVENT(1)
 
 /*******************************************************************************
  *                               Global-Variables                              *
  *******************************************************************************/
 
-uint8 volatile g_ticks;
+/* Seconds since boot, the time stamp of the event log on a board without the RTC */
+uint32 g_uptime;
+SoftTimer_Type g_uptimeTimer;
 uint8 Trials = 0;
 
+/* Background door cycle and alarm, ended by the expiry of their timers */
+Door_StateType g_doorState = DOOR_IDLE;
+SoftTimer_Type g_doorTimer;
+boolean g_alarmActive = FALSE;
+SoftTimer_Type g_alarmTimer;
+/*
+ * Password creation is allowed while no password is stored, and once after a
+ * verified password. Closed until the EEPROM store tells whether one exists.
+ */
+boolean g_setPasswordAllowed = FALSE;
+/*
+ * RAM copy of the stored password, so a check is a memory compare. Its CRC
+ * catches a corrupted copy, which is then read again from the EEPROM store.
+ */
+uint8 g_credential[PASSWORD_LEGTH];
+uint8 g_credentialCrc;
+boolean g_credentialValid = FALSE;
+SoftTimer_Type g_credentialTimer;
+/* Door openings and alarms, kept in the EEPROM store by storage_task once changed */
+uint16 g_openCount = 0;
+uint8 g_alarmCount = 0;
+boolean g_countersDirty = FALSE;
+/* Set once KV_init has scanned the EEPROM store */
+boolean g_storeReady = FALSE;
+/* TWI slave register map and the command written by the supervisor */
+uint8 volatile g_registers[REG_MAP_SIZE];
+uint8 volatile g_supervisorCommand = CMD_NONE;
+
 /*******************************************************************************
  *                             Functions Prototypes                            *
  *******************************************************************************/
 
-void create_password(void);
-void open_door(void);
-void change_password(void);
+void create_password(const DoorLink_FrameType *request, DoorLink_FrameType *response);
+void open_door(const DoorLink_FrameType *request, DoorLink_FrameType *response);
+void change_password(const DoorLink_FrameType *request, DoorLink_FrameType *response);
+void get_status(DoorLink_FrameType *response);
+void abort_door(DoorLink_FrameType *response);
+void acknowledge_alarm(DoorLink_FrameType *response);
+void wrong_password(DoorLink_FrameType *response);
 void activate_alarm_mode(void);
-void Timer_CallBackFunction(void);
+void door_start_phase(Door_StateType state, uint16 ticks);
+void door_update(void);
+void alarm_update(void);
+uint8 remaining_seconds(void);
+void uptime_update(void);
+uint32 uptime_seconds(void);
+void read_log(const DoorLink_FrameType *request, DoorLink_FrameType *response);
+void clock_request(const DoorLink_FrameType *request, DoorLink_FrameType *response);
+void isr_profile_request(const DoorLink_FrameType *request, DoorLink_FrameType *response);
+void task_stats_request(const DoorLink_FrameType *request, DoorLink_FrameType *response);
+void Registers_CallBackFunction(uint8 first, uint8 count);
+void registers_update(void);
 uint8 check_password(uint8 *pass1 , uint8 *pass2);
 void save_password(uint8 *pass);
+void load_credential(void);
+void credential_update(void);
+void load_counters(void);
+void load_store(void);
+void save_counters(void);
+void load_calibration(void);
+void save_calibration(void);
+boolean load_oscillator(void);
+void calibrate_oscillator(void);
 uint8 check_saved_password(uint8 *pass_entered);
-void mainMenu();
+void handle_request(const DoorLink_FrameType *request);
+void link_task(void);
+void storage_task(void);
+void tick_event(void);
+void idle_task(void);
+
+/*******************************************************************************
+ *                               Task Table                                    *
+ *******************************************************************************/
+
+const Scheduler_TaskType g_tasks[] = {
+	{&SoftTimer_update,  0,                     SOFT_TIMER_TICK_MS,    EVENT_TICK},
+	{&link_task,         TASK_LINK_PERIOD,      TASK_LINK_DEADLINE,    0},
+	{&registers_update,  TASK_REGISTERS_PERIOD, TASK_REGISTERS_PERIOD, EVENT_SUPERVISOR},
+	{&storage_task,      TASK_STORAGE_PERIOD,   TASK_STORAGE_DEADLINE, 0}
+};
+#define TASK_COUNT				(sizeof(g_tasks) / sizeof(g_tasks[0]))
 
 
 /*******************************************************************************
@@ -66,232 +184,792 @@ void mainMenu();
 
 int main(void)
 {
+#ifdef DOOR_LINK_SPI
+	/* The HMI drives the SPI link, the CTRL answers as slave */
+	SPI_ConfigType SPI_config = {SPI_SLAVE,
+								 SPI_F_CPU_4,
+								 SPI_MODE_0,
+								 SPI_MSB_FIRST};
+#else
 	/* Initialize UART with 8bits mode, no parity bit, 1 stop bit and 9600 baud rate */
 	UART_ConfigType UART_config = {Bits_8,
 									DISABLED,
 									ONE_BIT,
 									9600};
-	/* Initialize I2C with No prescalar mode and 400 kbps bit rate */
+#endif
+	/* Initialize I2C at the fastest legal SCL, 222 kHz at 8 MHz (TWBR = 10) */
 	TWI_ConfigType TWI_conf={
 						TWI_SLAVE_ADDRESS,
-						400,
-						NO_PRESCALER
+						TWI_SCL_HZ(TWI_FASTEST_SCL_HZ)
 				};
-	/* Initialize Timer1 with 0 initial value, 23437 compare value, prescalar of 1024 and CTC mode */
-	Timer1_ConfigType TIMER1_config = {0,
-									   23437,
-									   F_CPU_1024,
-										COMPARE_MODE};
-
-	/* Initialize modules and enable global interrupts */
-	Timer1_init(&TIMER1_config);
-	Timer1_setCallBack(&Timer_CallBackFunction);
-	UART_init(&UART_config);
+	/* Answer a supervisory MCU at TWI_SLAVE_ADDRESS with the door registers */
+	TWI_SlaveMapType TWI_map = {g_registers,
+								REG_MAP_SIZE,
+								REG_COMMAND,
+								&Registers_CallBackFunction};
+	boolean oscillatorLoaded;
+
+	/* Initialize modules, global interrupts are enabled before the EEPROM is read */
+	SoftTimer_init();
+#ifdef ISR_PROFILE
+	/* Time the ISRs on the free-running soft timer count */
+	IsrProfile_init(&Timer1_getCount, SOFT_TIMER_COMPARE_VALUE, SOFT_TIMER_US_PER_COUNT);
+#endif
+	SoftTimer_setTickCallBack(&tick_event);
+	SoftTimer_setCallBack(&g_uptimeTimer, &uptime_update);
+	SoftTimer_setCallBack(&g_doorTimer, &door_update);
+	SoftTimer_setCallBack(&g_alarmTimer, &alarm_update);
+	SoftTimer_setCallBack(&g_credentialTimer, &credential_update);
+	SoftTimer_start(&g_uptimeTimer, SOFT_TIMER_SECONDS(1), SOFT_TIMER_SECONDS(1));
+	SoftTimer_start(&g_credentialTimer, SOFT_TIMER_SECONDS(CREDENTIAL_CHECK_TIME), SOFT_TIMER_SECONDS(CREDENTIAL_CHECK_TIME));
 	TWI_init(&TWI_conf);
+	/* The TWI transfers of the EEPROM store only complete from the TWI ISR */
+	SREG |= (1<<7);
+	/* A failed scan is repeated by storage_task, the store refuses writes until then */
+	g_storeReady = (KV_init() == KV_OK);
+	/* The RC oscillator runs uncalibrated at 8 MHz until the stored setting is back */
+	oscillatorLoaded = load_oscillator();
+	load_credential();
+	/* A stored password is only replaced after it has been verified */
+	g_setPasswordAllowed = g_storeReady && !g_credentialValid;
+	load_counters();
+#if RTC_TIMER != TIMER_NONE
+	/* Wall-clock time stamps, from 2000-01-01 until the HMI sets the clock */
+	RTC_init();
+	load_calibration();
+	EventLog_setTimeSource(&RTC_seconds);
+#else
+	EventLog_setTimeSource(&uptime_seconds);
+#endif
+	EventLog_init();
+	EventLog_record(DOOR_EVENT_BOOT, 0);
+	registers_update();
+	TWI_setSlaveMap(&TWI_map);
 	DC_Motor_init();
 	Buzzer_init();
-	SREG |= (1<<7);
-
-	/* Create the password */
-	create_password();
-	/* Program Menu function */
-	while(1)
+#if RTC_TIMER != TIMER_NONE
+	/* First boot: measure the RC oscillator against the crystal, once */
+	if(!oscillatorLoaded)
 	{
-		mainMenu();
+		calibrate_oscillator();
 	}
+#else
+	(void)oscillatorLoaded;
+#endif
+	/* The link starts on the final clock, the baud rate is set from F_CPU */
+#ifdef DOOR_LINK_SPI
+	SPI_init(&SPI_config);
+#else
+	UART_init(&UART_config);
+	/* The max RX latency of the link stats in us */
+	UART_setTimeSource(&SoftTimer_micros);
+#endif
+	DoorLink_init();
+	/* The kept responses are forgotten once the HMI has given their request up */
+	DoorLink_setTimeSource(&SoftTimer_millis);
+
+	/*
+	 * Serve the HMI requests as they arrive while the door cycle and the
+	 * alarm progress in the background
+	 */
+	Scheduler_setTimeSource(&SoftTimer_micros);
+	Scheduler_setIdleHook(&idle_task);
+	Scheduler_init(g_tasks, TASK_COUNT);
+	Scheduler_run();
 }
 /*
- * Function: create_password
+ * Function: link_task
  * ----------------------------------
- * The create_password() function prompts the user to enter a new password and then compares
- *  the entered passwords to ensure that they match. If the passwords match, the password is saved
- *  to the EEPROM.
+ * Serves one HMI request, so a flow of requests cannot hold the CPU: the
+ * next one waits for the next release. A request resent by the HMI after a
+ * lost response gets the same response again without being executed twice.
  *
  * Parameters: None
  *
  * Returns: None
  */
-void create_password(void)
+void link_task(void)
 {
+	DoorLink_FrameType request;
 
-	uint8 firstPassword[PASSWORD_LEGTH + 1];
-	uint8 secondPassword[PASSWORD_LEGTH + 1];
-	uint8 matchCheck;
-
-	/* Wait for a "ready" signal from the HMI */
-	UART_sendByte(CONTROL_READY_UART);
-	UART_receiveString(firstPassword);
-
-	/* Send a "ready" signal back to the HMI */
-	UART_sendByte(CONTROL_READY_UART);
+	if(DoorLink_receiveFrame(&request) && !DoorLink_replay(&request))
+	{
+		handle_request(&request);
+	}
+}
+/*
+ * Function: tick_event
+ * ----------------------------------
+ * Called from the Timer1 ISR every tick, releases the software timers task.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void tick_event(void)
+{
+	Scheduler_postEvent(EVENT_TICK);
+}
+/*
+ * Function: idle_task
+ * ----------------------------------
+ * Sleeps in idle mode until a task is released. The link, TWI and Timer1
+ * interrupts wake the CPU, the tick at least every SOFT_TIMER_TICK_MS.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void idle_task(void)
+{
+	Power_waitFor(&Scheduler_isReleased, POWER_IDLE);
+}
+/*
+ * Function: storage_task
+ * ----------------------------------
+ * Saves the door counters changed since its last run, keeps free pages in
+ * the EEPROM store and commits the full pages of the event log. The counters
+ * changed by several requests in one period are saved in one write. While
+ * the EEPROM store has not been scanned, it tries the scan again instead.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void storage_task(void)
+{
+	if(!g_storeReady)
+	{
+		load_store();
+		return;
+	}
+	if(g_countersDirty)
+	{
+		g_countersDirty = FALSE;
+		save_counters();
+	}
+	KV_update();
+	EventLog_update();
+}
+/*
+ * Function: handle_request
+ * ----------------------------------
+ * Executes one HMI request and sends the response carrying the same sequence
+ * number, so the HMI can match it with the request it belongs to.
+ *
+ * Parameters: DoorLink_FrameType*
+ *
+ * Returns: None
+ */
+void handle_request(const DoorLink_FrameType *request)
+{
+	DoorLink_FrameType response;
+#ifndef DOOR_LINK_SPI
+	UART_StatsType stats;
+#endif
 
-	/* Receive the second password from the HMI */
-	UART_receiveString(secondPassword);
+	response.seq = request->seq;
+	response.code = DOOR_STATUS_OK;
+	response.length = 0;
 
-	/* Check if the passwords match */
-	matchCheck = check_password(firstPassword, secondPassword);
+	switch(request->code)
+	{
+	case DOOR_CMD_SET_PASSWORD:
+		create_password(request, &response);
+		break;
+	case DOOR_CMD_VERIFY_PASSWORD:
+		change_password(request, &response);
+		break;
+	case DOOR_CMD_OPEN:
+		open_door(request, &response);
+		break;
+	case DOOR_CMD_STATUS:
+		get_status(&response);
+		break;
+	case DOOR_CMD_ABORT:
+		abort_door(&response);
+		break;
+	case DOOR_CMD_ALARM_ACK:
+		acknowledge_alarm(&response);
+		break;
+	case DOOR_CMD_LOG_READ:
+		read_log(request, &response);
+		break;
+	case DOOR_CMD_CLOCK:
+		clock_request(request, &response);
+		break;
+	case DOOR_CMD_ISR_PROFILE:
+		isr_profile_request(request, &response);
+		break;
+	case DOOR_CMD_TASK_STATS:
+		task_stats_request(request, &response);
+		break;
+	case DOOR_CMD_LINK_STATS:
+#ifdef DOOR_LINK_SPI
+		/* The SPI driver keeps no error counters, the idle UART ones would read 0 */
+		response.code = DOOR_STATUS_UNKNOWN;
+#else
+		/* Link health request: dump the CTRL side UART counters */
+		UART_getStats(&stats);
+		DoorLink_packStats(&stats, response.payload);
+		response.length = DOOR_LINK_STATS_LENGTH;
+#endif
+		break;
+	default:
+		response.code = DOOR_STATUS_UNKNOWN;
+		break;
+	}
 
-	/* Wait for a "ready" signal from the HMI */
-	while(UART_receiveByte() != HMI_READY_UART){}
+	DoorLink_sendResponse(request, &response);
+}
+/*
+ * Function: create_password
+ * ----------------------------------
+ * The create_password() function receives the new password and its confirmation
+ * and compares them to ensure that they match. If the passwords match, the
+ * password is saved to the EEPROM. It is accepted while no password is
+ * stored, and once after the old password has been verified by
+ * change_password().
+ *
+ * Parameters: DoorLink_FrameType*,DoorLink_FrameType*
+ *
+ * Returns: None
+ */
+void create_password(const DoorLink_FrameType *request, DoorLink_FrameType *response)
+{
+	uint8 *firstPassword = (uint8 *)&request->payload[0];
+	uint8 *secondPassword = (uint8 *)&request->payload[PASSWORD_LEGTH];
 
+	if(request->length != 2 * PASSWORD_LEGTH)
+	{
+		response->code = DOOR_STATUS_UNKNOWN;
+	}
+	else if(!g_setPasswordAllowed)
+	{
+		response->code = DOOR_STATUS_DENIED;
+	}
 	/* If the passwords match, save the password to EEPROM */
-	if(matchCheck)
+	else if(check_password(firstPassword, secondPassword))
 	{
-		UART_sendByte(PASSWORD_MATCH);
 		save_password(firstPassword);
+		EventLog_record(DOOR_EVENT_PASSWORD_SET, 0);
+		g_setPasswordAllowed = FALSE;
+		response->code = DOOR_STATUS_OK;
 	}
-	/* If the passwords do not match, prompt the user to enter a new password */
+	/* If the passwords do not match, the HMI prompts the user to enter a new password */
 	else
 	{
-		UART_sendByte(PASSWORD_UNMATCH);
-		create_password();
+		response->code = DOOR_STATUS_MISMATCH;
 	}
 }
 /*
  * Function: open_door
  * ----------------------------------
- * The open_door() function prompts the user to enter their password and checks if it matches
- *  the saved password. If the password is correct, the door is opened for a preset amount of time.
- *  If the password is incorrect, the function prompts the user to enter their password again.
+ * The open_door() function checks if the received password matches the saved
+ * password. If the password is correct, the door cycle is started and runs in
+ * the background. If the password is incorrect, the trial is counted and the
+ * alarm is activated after the maximum number of trials.
  *
- * Parameters: None
+ * Parameters: DoorLink_FrameType*,DoorLink_FrameType*
  *
  * Returns: None
  */
-void open_door(void)
+void open_door(const DoorLink_FrameType *request, DoorLink_FrameType *response)
 {
-	uint8 password[PASSWORD_LEGTH + 1];
-	uint8 matchCheck;
-	/* Wait for a signal from the HMI that it is ready to receive data */
-	while(UART_receiveByte() != HMI_READY_UART);
-	UART_sendByte(CONTROL_READY_UART);
-	/* Receive the user's password from the HMI */
-	UART_receiveString(password);
-	/* Check if the entered password matches the saved password */
-	matchCheck = check_saved_password(password);
-	/* Wait for a signal from the HMI that it is ready to receive data */
-	while(UART_receiveByte() != HMI_READY_UART);
-	UART_sendByte(CONTROL_READY_UART);
-	/* If the passwords match, open the door */
-	if(matchCheck)
+	if(request->length != PASSWORD_LEGTH)
+	{
+		response->code = DOOR_STATUS_UNKNOWN;
+	}
+	else if(g_alarmActive)
+	{
+		response->code = DOOR_STATUS_ALARM;
+	}
+	else if(g_doorState != DOOR_IDLE)
+	{
+		response->code = DOOR_STATUS_BUSY;
+	}
+	/* If the passwords match, open the door for 15 Secs */
+	else if(check_saved_password((uint8 *)request->payload))
 	{
-		UART_sendByte(PASSWORD_MATCH);
 		Trials = 0;
-		/* Open the door for 15 Secs */
-		g_ticks = 0;
+		g_openCount++;
+		g_countersDirty = TRUE;
+		EventLog_record(DOOR_EVENT_OPEN, 0);
 		DcMotor_Rotate(MOTOR_CW,50);
-		while(g_ticks < DOOR_OPEN_TIME/3);	/* waiting for the door opening time */
+		door_start_phase(DOOR_OPENING, SOFT_TIMER_SECONDS(DOOR_OPEN_TIME));
+		response->code = DOOR_STATUS_OK;
+	}
+	else
+	{
+		wrong_password(response);
+	}
+}
+/*
+ * Function: change_password
+ * ------------------------
+ * Checks if the received old password matches the stored password. If the old
+ * password is correct, one DOOR_CMD_SET_PASSWORD request is allowed. If the old
+ * password is not correct, the trial is counted and the alarm is activated
+ * after the maximum number of trials.
+ *
+ * Parameters: DoorLink_FrameType*,DoorLink_FrameType*
+ *
+ * Returns: None
+ */
+void change_password(const DoorLink_FrameType *request, DoorLink_FrameType *response)
+{
+	if(request->length != PASSWORD_LEGTH)
+	{
+		response->code = DOOR_STATUS_UNKNOWN;
+	}
+	else if(g_alarmActive)
+	{
+		response->code = DOOR_STATUS_ALARM;
+	}
+	else if(check_saved_password((uint8 *)request->payload))
+	{
+		Trials = 0;
+		g_setPasswordAllowed = TRUE;
+		response->code = DOOR_STATUS_OK;
+	}
+	else
+	{
+		wrong_password(response);
+	}
+}
+/*
+ * Function: wrong_password
+ * ------------------------
+ * Counts a wrong password and activates the alarm mode if the maximum number
+ * of trials has been reached.
+ *
+ * Parameters: DoorLink_FrameType*
+ *
+ * Returns: None
+ */
+void wrong_password(DoorLink_FrameType *response)
+{
+	Trials++;
+	EventLog_record(DOOR_EVENT_WRONG_PASSWORD, Trials);
+	if(Trials == MAX_TRIALS)
+	{
+		activate_alarm_mode(); /* activating the alarm mode if the maximum number of trials has been reached */
+		response->code = DOOR_STATUS_ALARM;
+	}
+	else
+	{
+		response->code = DOOR_STATUS_WRONG_PASSWORD; /* allowing the user to try again */
+	}
+}
+/*
+ * Function: get_status
+ * ------------------------
+ * Reports the door phase, the alarm state, the wrong password count and the
+ * seconds left in the current door phase or alarm.
+ *
+ * Parameters: DoorLink_FrameType*
+ *
+ * Returns: None
+ */
+void get_status(DoorLink_FrameType *response)
+{
+	response->payload[0] = g_doorState;
+	response->payload[1] = g_alarmActive;
+	response->payload[2] = Trials;
+	response->payload[3] = remaining_seconds();
+	response->length = 4;
+}
+/*
+ * Function: abort_door
+ * ------------------------
+ * Closes the door immediately. While opening, the door closes for as long as
+ * it has been opening; while held open, the full closing time is used.
+ *
+ * Parameters: DoorLink_FrameType*
+ *
+ * Returns: None
+ */
+void abort_door(DoorLink_FrameType *response)
+{
+	uint16 elapsed = SOFT_TIMER_SECONDS(DOOR_OPEN_TIME) - SoftTimer_remaining(&g_doorTimer);
+
+	if(g_doorState == DOOR_OPENING)
+	{
+		DcMotor_Rotate(MOTOR_ACW,50);
+		door_start_phase(DOOR_CLOSING, elapsed);
+		EventLog_record(DOOR_EVENT_ABORT, 0);
+	}
+	else if(g_doorState == DOOR_HOLD)
+	{
+		DcMotor_Rotate(MOTOR_ACW,50);
+		door_start_phase(DOOR_CLOSING, SOFT_TIMER_SECONDS(DOOR_CLOSE_TIME));
+		EventLog_record(DOOR_EVENT_ABORT, 0);
+	}
+	response->code = DOOR_STATUS_OK;
+}
+/*
+ * Function: acknowledge_alarm
+ * ------------------------
+ * Silences the buzzer. The lockout keeps running until ALARM_TIME has elapsed.
+ *
+ * Parameters: DoorLink_FrameType*
+ *
+ * Returns: None
+ */
+void acknowledge_alarm(DoorLink_FrameType *response)
+{
+	Buzzer_off();
+	if(g_alarmActive)
+	{
+		EventLog_record(DOOR_EVENT_ALARM_ACK, 0);
+	}
+	response->code = g_alarmActive ? DOOR_STATUS_OK : DOOR_STATUS_DENIED;
+}
+/*
+ * Function: activate_alarm_mode
+ * -----------------------------
+ * Activates the alarm mode by turning the buzzer on. The alarm is turned off
+ * by alarm_update() when the alarm timer expires, after ALARM_TIME.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void activate_alarm_mode(void)
+{
+	Buzzer_on();
+	g_alarmCount++;
+	g_countersDirty = TRUE;
+	EventLog_record(DOOR_EVENT_ALARM, 0);
+	SoftTimer_start(&g_alarmTimer, SOFT_TIMER_SECONDS(ALARM_TIME), 0);
+	g_alarmActive = TRUE;
+}
+/*
+ * Function: door_start_phase
+ * -----------------------------
+ * Starts a door phase lasting the required number of software timer ticks.
+ *
+ * Parameters: Door_StateType,uint16
+ *
+ * Returns: None
+ */
+void door_start_phase(Door_StateType state, uint16 ticks)
+{
+	g_doorState = state;
+	SoftTimer_start(&g_doorTimer, ticks, 0);
+}
+/*
+ * Function: door_update
+ * -----------------------------
+ * Called by the door timer when the current phase has elapsed, moves the
+ * door cycle to its next phase:
+ * opening (15 Secs) -> hold (3 Secs) -> closing (15 Secs) -> idle.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void door_update(void)
+{
+	switch(g_doorState)
+	{
+	case DOOR_OPENING:
 		/* Hold the door for 3 Secs */
-		g_ticks = 0;
 		DcMotor_Rotate(MOTOR_STOP,0);
-		while(g_ticks < DOOR_HOLD_TIME/3); /* waiting for the door hold time */
+		door_start_phase(DOOR_HOLD, SOFT_TIMER_SECONDS(DOOR_HOLD_TIME));
+		break;
+	case DOOR_HOLD:
 		/* Close the door for 15 Secs */
-		g_ticks = 0;
 		DcMotor_Rotate(MOTOR_ACW,50);
-		while(g_ticks < DOOR_CLOSE_TIME/3); /* waiting for the door closing time */
-
+		door_start_phase(DOOR_CLOSING, SOFT_TIMER_SECONDS(DOOR_CLOSE_TIME));
+		break;
+	default:
 		DcMotor_Rotate(MOTOR_STOP,0);
+		g_doorState = DOOR_IDLE;
+		break;
 	}
+}
+/*
+ * Function: alarm_update
+ * -----------------------------
+ * Called by the alarm timer once ALARM_TIME has elapsed, deactivates the
+ * alarm and resets the incorrect password count.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void alarm_update(void)
+{
+	Buzzer_off();
+	g_alarmActive = FALSE;
+	Trials = 0;
+}
+/*
+ * Function: remaining_seconds
+ * -----------------------------
+ * Returns the seconds left in the current door phase or alarm, rounded up.
+ *
+ * Parameters: None
+ *
+ * Returns: uint8
+ */
+uint8 remaining_seconds(void)
+{
+	uint16 remaining = 0;
 
-	else
+	if(g_doorState != DOOR_IDLE)
+	{
+		remaining = SoftTimer_remaining(&g_doorTimer);
+	}
+	else if(g_alarmActive)
 	{
-		UART_sendByte(PASSWORD_UNMATCH);
-		Trials++;
+		remaining = SoftTimer_remaining(&g_alarmTimer);
+	}
+	return (uint8)((remaining + SOFT_TIMER_SECONDS(1) - 1) / SOFT_TIMER_SECONDS(1));
+}
+/*
+ * Function: registers_update
+ * -----------------------------
+ * Executes the command written by the supervisory MCU, then refreshes the
+ * TWI slave registers with the door state and the counters, including the
+ * I2C bus recoveries (saturated at 255).
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void registers_update(void)
+{
+	DoorLink_FrameType response;
+	uint8 command = g_supervisorCommand;
+	uint16 recoveries;
 
-		if(Trials == 3)
+	if(command != CMD_NONE)
+	{
+		g_supervisorCommand = CMD_NONE;
+		if(command == CMD_CLOSE_DOOR)
 		{
-			activate_alarm_mode(); /* activating the alarm mode if the maximum number of trials has been reached */
+			abort_door(&response);
 		}
-
-		else
+		else if(command == CMD_ALARM_ACK)
 		{
-			open_door(); /* allowing the user to try again if the maximum number of trials has not been reached */
+			acknowledge_alarm(&response);
 		}
 	}
 
+	/* A supervisor reading the registers meanwhile may see them half updated, each byte stays valid */
+	g_registers[REG_DOOR_STATE] = g_doorState;
+	g_registers[REG_ALARM] = g_alarmActive;
+	g_registers[REG_TRIALS] = Trials;
+	g_registers[REG_REMAINING] = remaining_seconds();
+	g_registers[REG_OPEN_COUNT_L] = (uint8)g_openCount;
+	g_registers[REG_OPEN_COUNT_H] = (uint8)(g_openCount >> 8);
+	g_registers[REG_ALARM_COUNT] = g_alarmCount;
+	recoveries = TWI_getRecoveryCount();
+	g_registers[REG_BUS_RECOVERIES] = (recoveries > 0xFF) ? 0xFF : (uint8)recoveries;
 }
 /*
- * Function: change_password
- * ------------------------
- * Prompts the user to enter their old password and checks if it matches the
- * stored password. If the old password is correct, prompts the user to enter a
- * new password and sends it to the control unit. If the old password is not
- * correct, displays an error message and allows the user to try again up to
- * three times before activating the alarm mode.
+ * Function: Registers_CallBackFunction
+ * ----------------------------------
+ * Called from the TWI ISR when the supervisory MCU has written registers.
+ * A command is only latched here, registers_update() executes it from the
+ * task the event releases.
+ *
+ * Parameters: uint8,uint8
+ *
+ * Returns: None
+ */
+void Registers_CallBackFunction(uint8 first, uint8 count)
+{
+	(void)first;
+	(void)count;
+	if(g_registers[REG_COMMAND] != CMD_NONE)
+	{
+		g_supervisorCommand = g_registers[REG_COMMAND];
+		g_registers[REG_COMMAND] = CMD_NONE;
+		Scheduler_postEvent(EVENT_SUPERVISOR);
+	}
+}
+/*
+ * Function: uptime_update
+ * ----------------------------------
+ * Called every second by the periodic uptime timer, counts the seconds since
+ * boot.
  *
  * Parameters: None
  *
  * Returns: None
  */
-void change_password(void)
+void uptime_update(void)
 {
-	uint8 password[PASSWORD_LEGTH + 1];
-	uint8 matchCheck;
-	while(UART_receiveByte() != HMI_READY_UART);
-	UART_sendByte(CONTROL_READY_UART);
-	UART_receiveString(password);
-	matchCheck = check_saved_password(password);
-	while(UART_receiveByte() != HMI_READY_UART);
-	UART_sendByte(CONTROL_READY_UART);
-
+	g_uptime++;
+}
+/*
+ * Function: uptime_seconds
+ * ----------------------------------
+ * Returns the seconds since boot. The count is only written by the main loop,
+ * no interrupt can change it while it is read.
+ *
+ * Parameters: None
+ *
+ * Returns: uint32
+ */
+uint32 uptime_seconds(void)
+{
+	return g_uptime;
+}
+/*
+ * Function: read_log
+ * ----------------------------------
+ * Copies the number of event log records and up to DOOR_LOG_RECORDS_PER_FRAME
+ * of them, from the requested one on, to the response. The HMI walks the
+ * whole log with consecutive requests.
+ *
+ * Parameters: DoorLink_FrameType*,DoorLink_FrameType*
+ *
+ * Returns: None
+ */
+void read_log(const DoorLink_FrameType *request, DoorLink_FrameType *response)
+{
+	uint16 first;
+	uint16 count = EventLog_count();
+	uint8 i;
 
-	if(matchCheck)
+	if(request->length != 2)
 	{
-		UART_sendByte(PASSWORD_MATCH);
-		Trials = 0;
-		create_password();
+		response->code = DOOR_STATUS_UNKNOWN;
+		return;
 	}
+	first = request->payload[0] | ((uint16)request->payload[1] << 8);
 
-	else
+	response->payload[0] = (uint8)count;
+	response->payload[1] = (uint8)(count >> 8);
+	for(i = 0; i < DOOR_LOG_RECORDS_PER_FRAME && first + i < count; i++)
 	{
-
-		UART_sendByte(PASSWORD_UNMATCH);
-		Trials++;
-		if(Trials == 3)
+		if(EventLog_read(first + i, &response->payload[2 + i * DOOR_LOG_RECORD_SIZE]) == ERROR)
 		{
-			activate_alarm_mode();
+			break;
 		}
+	}
+	response->length = 2 + i * DOOR_LOG_RECORD_SIZE;
+}
+/*
+ * Function: clock_request
+ * ----------------------------------
+ * Sets the real-time clock from the reference time of the request, if any,
+ * then copies the time and the crystal calibration to the response. A
+ * reference a day or more after the previous one calibrates the crystal,
+ * and the calibration is saved to the EEPROM store.
+ *
+ * Parameters: DoorLink_FrameType*,DoorLink_FrameType*
+ *
+ * Returns: None
+ */
+void clock_request(const DoorLink_FrameType *request, DoorLink_FrameType *response)
+{
+#if RTC_TIMER != TIMER_NONE
+	RTC_TimeType time;
+	sint16 calibration;
 
-		else
+	if(request->length == DOOR_CLOCK_TIME_LENGTH)
+	{
+		time.second = request->payload[0];
+		time.minute = request->payload[1];
+		time.hour = request->payload[2];
+		time.day = request->payload[3];
+		time.month = request->payload[4];
+		time.year = request->payload[5];
+		if(RTC_calibrate(&time))
+		{
+			save_calibration();
+		}
+		else if(!RTC_setTime(&time))
 		{
-			change_password();
+			response->code = DOOR_STATUS_UNKNOWN;
+			return;
 		}
 	}
+	else if(request->length != 0)
+	{
+		response->code = DOOR_STATUS_UNKNOWN;
+		return;
+	}
 
+	RTC_getTime(&time);
+	calibration = RTC_getCalibration();
+	response->payload[0] = time.second;
+	response->payload[1] = time.minute;
+	response->payload[2] = time.hour;
+	response->payload[3] = time.day;
+	response->payload[4] = time.month;
+	response->payload[5] = time.year;
+	response->payload[6] = (uint8)calibration;
+	response->payload[7] = (uint8)((uint16)calibration >> 8);
+	response->length = DOOR_CLOCK_LENGTH;
+#else
+	/* No crystal on this board */
+	(void)request;
+	response->code = DOOR_STATUS_UNKNOWN;
+#endif
 }
 /*
- * Function: activate_alarm_mode
- * -----------------------------
- * Activates the alarm mode by displaying a message on the LCD screen and sending
- * a signal to the control unit to activate the alarm. After a specified delay,
- * sends a signal to the control unit to deactivate the alarm and resets the
- * incorrect password count.
+ * Function: isr_profile_request
+ * ----------------------------------
+ * Copies the execution time and latency stats of the requested interrupt
+ * vector to the response, in a build with ISR_PROFILE.
  *
- * Parameters: None
+ * Parameters: DoorLink_FrameType*,DoorLink_FrameType*
  *
  * Returns: None
  */
-void activate_alarm_mode(void)
+void isr_profile_request(const DoorLink_FrameType *request, DoorLink_FrameType *response)
 {
+#ifdef ISR_PROFILE
+	IsrProfile_StatsType stats;
 
-	Buzzer_on();
-	g_ticks = 0;
-	while(g_ticks < ALARM_TIME);
-
+	if(request->length != 1 || request->payload[0] >= ISR_PROFILE_VECTORS)
+	{
+		response->code = DOOR_STATUS_UNKNOWN;
+		return;
+	}
+	IsrProfile_getStats((IsrProfile_VectorType)request->payload[0], &stats);
+	DoorLink_packIsrStats(&stats, response->payload);
+	response->length = DOOR_ISR_PROFILE_LENGTH;
+#else
+	/* The ISRs are not profiled in this build */
+	(void)request;
+	response->code = DOOR_STATUS_UNKNOWN;
+#endif
 }
 /*
- * Function: timer_callback_function
+ * Function: task_stats_request
  * ----------------------------------
- * A callback function that increments a global variable `g_ticks` by one every time
- * it is called. This function is used as a timer in the system.
+ * Copies the scheduler stats of the requested task, its index in g_tasks, to
+ * the response: runs, execution time, release jitter and deadline misses.
  *
- * Parameters: None
+ * Parameters: DoorLink_FrameType*,DoorLink_FrameType*
  *
  * Returns: None
  */
-void Timer_CallBackFunction(void)
+void task_stats_request(const DoorLink_FrameType *request, DoorLink_FrameType *response)
 {
-	g_ticks++;
+	Scheduler_StatsType stats;
+	DoorLink_TaskStatsType link_stats;
+
+	if(request->length != 1 || request->payload[0] >= TASK_COUNT)
+	{
+		response->code = DOOR_STATUS_UNKNOWN;
+		return;
+	}
+	Scheduler_getStats(request->payload[0], &stats);
+	link_stats.runs = stats.runs;
+	link_stats.exec_total_us = stats.exec_total_us;
+	link_stats.exec_max_us = stats.exec_max_us;
+	link_stats.jitter_max_us = stats.jitter_max_us;
+	link_stats.deadline_misses = stats.deadline_misses;
+	DoorLink_packTaskStats(&link_stats, response->payload);
+	response->length = DOOR_TASK_STATS_LENGTH;
 }
 /*
  * Function: check_password
@@ -307,15 +985,15 @@ void Timer_CallBackFunction(void)
 uint8 check_password(uint8 *firstPassword , uint8 *secondPassword)
 {
 	uint8 matchCheck = 1;
-	uint8 i = 0;
-	while(firstPassword[i] != '\0' || secondPassword[i] != '\0')
+	uint8 i;
+	/* The digits are raw key values (0 to 9), compare the fixed length */
+	for(i = 0 ; i < PASSWORD_LEGTH ; i++)
 	{
 		if(firstPassword[i] != secondPassword[i])
 		{
 			matchCheck = FALSE;
 			break;
 		}
-		i++;
 	}
 	return matchCheck;
 }
@@ -331,72 +1009,258 @@ uint8 check_password(uint8 *firstPassword , uint8 *secondPassword)
 void save_password(uint8 *pass)
 {
 	uint8 i;
+
+	/* A new record in the EEPROM store: one page write, never on the same cells twice in a row */
+	if(KV_write(KEY_PASSWORD, pass, PASSWORD_LEGTH) != KV_OK)
+	{
+		/* The EEPROM did not take it, the next check reads the store again */
+		g_credentialValid = FALSE;
+		return;
+	}
+
+	/* Write-through: the RAM copy follows the store */
 	for(i = 0 ; i < PASSWORD_LEGTH ; i++)
 	{
-		EEPROM_writeByte(EEPROM_PASS_ADDRESS + i, *(pass + i));
-		_delay_ms(20);
+		g_credential[i] = pass[i];
 	}
+	g_credentialCrc = KV_crc8(g_credential, PASSWORD_LEGTH);
+	g_credentialValid = TRUE;
 }
 /*
- * Function: check_saved_password
- * ------------------------
+ * Function: load_credential
+ * ----------------------------------
+ * Reads the stored password into its RAM copy. The copy stays invalid if no
+ * password has been stored yet or the EEPROM does not answer.
  *
- * The function compares between the entered password and the saved password in the memory and returns true
- * if they are equal.
+ * Parameters: None
  *
- * Parameters: uint8*
+ * Returns: None
+ */
+void load_credential(void)
+{
+	uint8 length;
+
+	g_credentialValid = (KV_read(KEY_PASSWORD, g_credential, PASSWORD_LEGTH, &length) == KV_OK &&
+						 length == PASSWORD_LEGTH);
+	g_credentialCrc = KV_crc8(g_credential, PASSWORD_LEGTH);
+}
+/*
+ * Function: credential_update
+ * ----------------------------------
+ * Called every CREDENTIAL_CHECK_TIME by the periodic credential timer,
+ * re-verifies the RAM copy of the password against the EEPROM store and
+ * reloads it if they differ.
  *
- * Returns: uint8
+ * Parameters: None
+ *
+ * Returns: None
  */
-uint8 check_saved_password(uint8 *enteredPassword)
+void credential_update(void)
 {
+	uint8 stored[PASSWORD_LEGTH];
+	uint8 length;
 	uint8 i;
-	uint8 savedPassword[PASSWORD_LEGTH];
-	uint8 matchCheck = 1;
 
-	for(i = 0 ; i < PASSWORD_LEGTH ; i++)
+	if(KV_read(KEY_PASSWORD, stored, PASSWORD_LEGTH, &length) != KV_OK || length != PASSWORD_LEGTH)
 	{
-		EEPROM_readByte((EEPROM_PASS_ADDRESS + i), &savedPassword[i]);
-		_delay_ms(20);
+		return;
 	}
-
 	for(i = 0 ; i < PASSWORD_LEGTH ; i++)
 	{
-		if(savedPassword[i] != enteredPassword[i])
+		if(stored[i] != g_credential[i])
 		{
-			matchCheck = 0;
-			break;
+			load_credential();
+			return;
 		}
 	}
+}
+/*
+ * Function: load_counters
+ * ----------------------------------
+ * Restores the door opening and alarm counters from the EEPROM store.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void load_counters(void)
+{
+	uint8 counters[COUNTERS_LENGTH];
+	uint8 length;
 
-	return matchCheck;
+	if(KV_read(KEY_COUNTERS, counters, COUNTERS_LENGTH, &length) == KV_OK && length == COUNTERS_LENGTH)
+	{
+		g_openCount = counters[0] | ((uint16)counters[1] << 8);
+		g_alarmCount = counters[2];
+	}
+}
+/*
+ * Function: load_store
+ * ----------------------------------
+ * Scans the EEPROM store again after it did not answer at boot. On success
+ * the stored password is loaded, password creation is allowed if there is
+ * none, and the door openings and alarms counted since boot are added to the
+ * stored counters.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void load_store(void)
+{
+	uint16 openCount = g_openCount;
+	uint8 alarmCount = g_alarmCount;
+
+	if(KV_init() != KV_OK)
+	{
+		return;
+	}
+	g_storeReady = TRUE;
+	load_credential();
+	g_setPasswordAllowed = !g_credentialValid;
+	load_counters();
+	g_openCount += openCount;
+	g_alarmCount += alarmCount;
+	g_countersDirty = (openCount != 0 || alarmCount != 0);
+}
+/*
+ * Function: save_counters
+ * ----------------------------------
+ * Saves the door opening and alarm counters to the EEPROM store.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void save_counters(void)
+{
+	uint8 counters[COUNTERS_LENGTH];
+
+	counters[0] = (uint8)g_openCount;
+	counters[1] = (uint8)(g_openCount >> 8);
+	counters[2] = g_alarmCount;
+	KV_write(KEY_COUNTERS, counters, COUNTERS_LENGTH);
+}
+/*
+ * Function: load_calibration
+ * ----------------------------------
+ * Gives the crystal calibration saved in the EEPROM store to the real-time
+ * clock.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void load_calibration(void)
+{
+#if RTC_TIMER != TIMER_NONE
+	uint8 calibration[CALIBRATION_LENGTH];
+	uint8 length;
+
+	if(KV_read(KEY_RTC_CALIBRATION, calibration, CALIBRATION_LENGTH, &length) == KV_OK && length == CALIBRATION_LENGTH)
+	{
+		RTC_setCalibration((sint16)(calibration[0] | ((uint16)calibration[1] << 8)));
+	}
+#endif
 }
 /*
- * Function: mainMenu
+ * Function: save_calibration
  * ----------------------------------
- * Function is responsible for displaying the main menu options to the user,
- *  getting the user's input, and then directing the program flow accordingly.
+ * Saves the crystal calibration of the real-time clock to the EEPROM store.
  *
  * Parameters: None
  *
  * Returns: None
  */
-void mainMenu(){
+void save_calibration(void)
+{
+#if RTC_TIMER != TIMER_NONE
+	uint8 calibration[CALIBRATION_LENGTH];
+	uint16 ppm = (uint16)RTC_getCalibration();
+
+	calibration[0] = (uint8)ppm;
+	calibration[1] = (uint8)(ppm >> 8);
+	KV_write(KEY_RTC_CALIBRATION, calibration, CALIBRATION_LENGTH);
+#endif
+}
+/*
+ * Function: load_oscillator
+ * ----------------------------------
+ * Gives the RC oscillator setting saved in the EEPROM store to OSCCAL.
+ *
+ * Parameters: None
+ *
+ * Returns: boolean, FALSE if no setting is saved
+ */
+boolean load_oscillator(void)
+{
+	uint8 value;
+	uint8 length;
+
+	if(KV_read(KEY_OSCCAL, &value, OSCCAL_LENGTH, &length) == KV_OK && length == OSCCAL_LENGTH)
+	{
+		Osccal_setValue(value);
+		return TRUE;
+	}
+	return FALSE;
+}
+/*
+ * Function: calibrate_oscillator
+ * ----------------------------------
+ * Tunes the RC oscillator against the RTC crystal and saves the setting to
+ * the EEPROM store, so the next boots only load it. Takes up to 3 s and runs
+ * before the link is initialized: the sweep moves the clock, and a UART
+ * receiving meanwhile would sample the HMI bytes at a wrong baud rate.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void calibrate_oscillator(void)
+{
+	uint8 value;
+
+	Osccal_setTimeSource(&SoftTimer_micros);
+	if(Osccal_calibrate() == OSCCAL_OK)
+	{
+		value = Osccal_getValue();
+		KV_write(KEY_OSCCAL, &value, OSCCAL_LENGTH);
+	}
+}
+/*
+ * Function: check_saved_password
+ * ------------------------
+ *
+ * The function compares between the entered password and the RAM copy of the saved password and returns true
+ * if they are equal. The copy is read again from the EEPROM store if its CRC does not match.
+ *
+ * Parameters: uint8*
+ *
+ * Returns: uint8
+ */
+uint8 check_saved_password(uint8 *enteredPassword)
+{
+	uint8 i;
+	uint8 matchCheck = 1;
 
-	uint8 operation;
-	/* wait until the HMI is ready */
-	while(UART_receiveByte() != HMI_READY_UART);
-	/* Send a "ready" signal back to the HMI */
-	UART_sendByte(CONTROL_READY_UART);
-	/* Getting the user input */
-	operation = UART_receiveByte();
-	if(operation == '+')
+	/* A memory compare, the EEPROM is only read again if the RAM copy is not valid */
+	if(!g_credentialValid || KV_crc8(g_credential, PASSWORD_LEGTH) != g_credentialCrc)
+	{
+		load_credential();
+		if(!g_credentialValid)
 		{
-			open_door();
+			return 0;
 		}
-	else if(operation == '-')
+	}
+
+	for(i = 0 ; i < PASSWORD_LEGTH ; i++)
+	{
+		if(g_credential[i] != enteredPassword[i])
 		{
-			change_password();
+			matchCheck = 0;
+			break;
 		}
-}
+	}
 
+	return matchCheck;
+}
@@ -56,6 +56,25 @@ typedef struct{
 }UART_ConfigType;
 
 
+/*Ring buffers between the UART interrupts and the application (power of 2, at most 128)*/
+#define UART_RX_BUFFER_SIZE		32
+#define UART_TX_BUFFER_SIZE		16
+
+
+/*Link health counters, all of them count from UART_init or the last UART_resetStats*/
+typedef struct{
+ uint32 rx_bytes;				/* Bytes received on the line, including the erroneous ones */
+ uint32 tx_bytes;				/* Bytes handed to the transmitter */
+ uint16 framing_errors;			/* FE: stop bit not found */
+ uint16 overrun_errors;			/* DOR: a byte was lost before the RX interrupt could read UDR */
+ uint16 parity_errors;			/* PE: parity check failed */
+ uint16 rx_buffer_overflows;	/* Bytes dropped because the RX ring buffer was full */
+ uint8 rx_high_water;			/* Maximum bytes ever waiting in the RX ring buffer */
+ uint8 tx_high_water;			/* Maximum bytes ever waiting in the TX ring buffer */
+ uint32 max_rx_latency;			/* Longest wait from byte arrival to UART_receiveByte, in time source units */
+}UART_StatsType;
+
+
 
 /*******************************************************************************
  *                           Function Proto-types                              *
@@ -90,6 +109,14 @@ uint8 UART_receiveByte(void);
 
 
 
+/*
+ * Description :
+ * Return the number of received bytes UART_receiveByte can return without waiting.
+ */
+uint8 UART_availableBytes(void);
+
+
+
 /*
  * Description :
  * Send the required string through UART to the other UART device.
@@ -104,4 +131,31 @@ void UART_sendString(const uint8 *Str);
  */
 void UART_receiveString(uint8 *Str);
 
+
+
+/*
+ * Description :
+ * Set the time source used to stamp received bytes for the max_rx_latency counter.
+ * The function must return a free-running counter, any unit. NULL_PTR disables the measurement.
+ */
+void UART_setTimeSource(uint32(*a_ptr)(void));
+
+
+
+/*
+ * Description :
+ * Copy a consistent snapshot of the link health counters.
+ */
+void UART_getStats(UART_StatsType *Stats_Ptr);
+
+
+
+/*
+ * Description :
+ * Clear all the link health counters.
+ */
+void UART_resetStats(void);
+
+
+
 #endif /* UART_H_ */
@@ -12,6 +12,37 @@
 #include "buzzer.h"
 #include "gpio.h"
 #include "common_macros.h"
+#include "timer.h"
+#include "timer_resources.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#if TONE_TIMER != TIMER_NONE
+/* The pin toggles every half period, counted at F_CPU/64 */
+#define BUZZER_TONE_COMPARE		(F_CPU / 64UL / (2UL * BUZZER_TONE_HZ) - 1)
+#if BUZZER_TONE_COMPARE > 255
+#error "BUZZER_TONE_HZ is too low for an 8-bit timer at F_CPU/64"
+#endif
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+static volatile uint8 g_toneLevel = LOGIC_LOW;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/* Tone timer callback: one half period of the square wave */
+static void Buzzer_toggle(void)
+{
+	g_toneLevel ^= LOGIC_HIGH;
+	GPIO_writePin(BUZZER_PORT,BUZZER_PIN,g_toneLevel);
+}
+#endif
 
 /*******************************************************************************
  *                      Functions Definitions                                  *
@@ -26,10 +57,25 @@ void Buzzer_init()
 
 void Buzzer_on(void)
 {
+#if TONE_TIMER == TIMER_0
+	Timer0_ConfigType TONE_config = {0, BUZZER_TONE_COMPARE, F_CPU_64, COMPARE_MODE, OC_DISCONNECTED};
+	Timer0_setCallBack(&Buzzer_toggle);
+	Timer0_init(&TONE_config);
+#elif TONE_TIMER == TIMER_2
+	Timer2_ConfigType TONE_config = {0, BUZZER_TONE_COMPARE, TIMER2_F_CPU_64, COMPARE_MODE, OC_DISCONNECTED};
+	Timer2_setCallBack(&Buzzer_toggle);
+	Timer2_init(&TONE_config);
+#else
 	GPIO_writePin(BUZZER_PORT,BUZZER_PIN,LOGIC_HIGH);
+#endif
 }
 
 void Buzzer_off()
 {
+#if TONE_TIMER == TIMER_0
+	Timer0_deInit();
+#elif TONE_TIMER == TIMER_2
+	Timer2_deInit();
+#endif
 	GPIO_writePin(BUZZER_PORT,BUZZER_PIN,LOGIC_LOW);
 }
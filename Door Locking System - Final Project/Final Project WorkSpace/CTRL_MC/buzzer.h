@@ -21,6 +21,9 @@
 #define BUZZER_PORT		PORTC_ID
 #define BUZZER_PIN		PIN5_ID
 
+/* Square wave driving a passive buzzer, when timer_resources.h gives a TONE_TIMER */
+#define BUZZER_TONE_HZ	2000
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
@@ -0,0 +1,231 @@
+ /******************************************************************************
+ *
+ * Module: Event Log
+ *
+ * File Name: event_log.c
+ *
+ * Description: Source file for the access event log
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include "event_log.h"
+#include "kv_store.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Record layout */
+#define EVENT_LOG_SEQ_INDEX		0
+#define EVENT_LOG_EVENT_INDEX	2		/* EVENT and ARG nibbles */
+#define EVENT_LOG_TIME_INDEX	3
+#define EVENT_LOG_CRC_INDEX		(DOOR_LOG_RECORD_SIZE - 1)
+
+#define EVENT_LOG_PAGE_ADDRESS(page)	((uint16)(EVENT_LOG_ADDRESS + (uint16)(page) * EEPROM_PAGE_SIZE))
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Next page written, and the records kept in the pages before it */
+static uint8 g_headPage = 0;
+static uint16 g_committed = 0;
+
+/* Sequence number of the next record */
+static uint16 g_sequence = 0;
+
+/* Records waiting for their page write, oldest first */
+static uint8 g_buffer[EVENT_LOG_BUFFER_RECORDS][DOOR_LOG_RECORD_SIZE];
+static uint8 g_buffered = 0;
+
+static uint32 (*g_timeSourcePtr)(void) = NULL_PTR;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+static boolean EventLog_isValid(const uint8 *record)
+{
+	return (record[EVENT_LOG_EVENT_INDEX] != 0xFF &&
+			record[EVENT_LOG_CRC_INDEX] == KV_crc8(record, EVENT_LOG_CRC_INDEX));
+}
+
+static uint16 EventLog_sequence(const uint8 *record)
+{
+	return record[EVENT_LOG_SEQ_INDEX] | ((uint16)record[EVENT_LOG_SEQ_INDEX + 1] << 8);
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Scan the pages of the region for the newest one.
+ */
+void EventLog_init(void)
+{
+	uint8 page[EEPROM_PAGE_SIZE];
+	uint16 newest = 0;
+	uint16 sequence;
+	boolean found = FALSE;
+	uint8 index;
+	uint8 i;
+
+	g_headPage = 0;
+	g_committed = 0;
+	g_sequence = 0;
+	g_buffered = 0;
+
+	for(index = 0; index < EVENT_LOG_PAGES; index++)
+	{
+		if(EEPROM_readBlock(EVENT_LOG_PAGE_ADDRESS(index), page, EEPROM_PAGE_SIZE) == ERROR)
+		{
+			return;
+		}
+		for(i = 0; i < EVENT_LOG_RECORDS_PER_PAGE; i++)
+		{
+			if(!EventLog_isValid(&page[i * DOOR_LOG_RECORD_SIZE]))
+			{
+				break;
+			}
+		}
+		if(i != EVENT_LOG_RECORDS_PER_PAGE)
+		{
+			continue;
+		}
+
+		/* The last record of a page is the newest, a lap of the region spans less than 2^15 records */
+		g_committed += EVENT_LOG_RECORDS_PER_PAGE;
+		sequence = EventLog_sequence(&page[(EVENT_LOG_RECORDS_PER_PAGE - 1) * DOOR_LOG_RECORD_SIZE]);
+		if(!found || (sint16)(sequence - newest) > 0)
+		{
+			newest = sequence;
+			g_headPage = (index + 1) % EVENT_LOG_PAGES;
+			found = TRUE;
+		}
+	}
+
+	g_sequence = found ? (uint16)(newest + 1) : 0;
+}
+
+/*
+ * Description :
+ * Time stamp a record in the RAM buffer.
+ */
+void EventLog_record(uint8 event, uint8 arg)
+{
+	uint8 *record;
+	uint32 time = (g_timeSourcePtr != NULL_PTR) ? (*g_timeSourcePtr)() : 0;
+
+	if(g_buffered == EVENT_LOG_BUFFER_RECORDS)
+	{
+		return;
+	}
+
+	record = g_buffer[g_buffered];
+	record[EVENT_LOG_SEQ_INDEX] = (uint8)g_sequence;
+	record[EVENT_LOG_SEQ_INDEX + 1] = (uint8)(g_sequence >> 8);
+	if(arg > DOOR_LOG_ARG_MAX)
+	{
+		arg = DOOR_LOG_ARG_MAX;
+	}
+	record[EVENT_LOG_EVENT_INDEX] = (event & DOOR_LOG_EVENT_MASK) | (uint8)(arg << 4);
+	record[EVENT_LOG_TIME_INDEX] = (uint8)time;
+	record[EVENT_LOG_TIME_INDEX + 1] = (uint8)(time >> 8);
+	record[EVENT_LOG_TIME_INDEX + 2] = (uint8)(time >> 16);
+	record[EVENT_LOG_TIME_INDEX + 3] = (uint8)(time >> 24);
+	record[EVENT_LOG_CRC_INDEX] = KV_crc8(record, EVENT_LOG_CRC_INDEX);
+
+	g_sequence++;
+	g_buffered++;
+}
+
+/*
+ * Description :
+ * Commit the oldest full page of the RAM buffer.
+ */
+void EventLog_update(void)
+{
+	uint8 i;
+	uint8 j;
+
+	if(g_buffered < EVENT_LOG_RECORDS_PER_PAGE)
+	{
+		return;
+	}
+
+	/* The buffered records of a page are contiguous, one page write */
+	if(EEPROM_writeBlock(EVENT_LOG_PAGE_ADDRESS(g_headPage), g_buffer[0], EEPROM_PAGE_SIZE) == ERROR)
+	{
+		return;
+	}
+
+	g_headPage = (g_headPage + 1) % EVENT_LOG_PAGES;
+	if(g_committed < EVENT_LOG_CAPACITY)
+	{
+		g_committed += EVENT_LOG_RECORDS_PER_PAGE;
+	}
+
+	g_buffered -= EVENT_LOG_RECORDS_PER_PAGE;
+	for(i = 0; i < g_buffered; i++)
+	{
+		for(j = 0; j < DOOR_LOG_RECORD_SIZE; j++)
+		{
+			g_buffer[i][j] = g_buffer[i + EVENT_LOG_RECORDS_PER_PAGE][j];
+		}
+	}
+}
+
+/*
+ * Description :
+ * Return the number of records kept.
+ */
+uint16 EventLog_count(void)
+{
+	return g_committed + g_buffered;
+}
+
+/*
+ * Description :
+ * Copy one record, from the EEPROM or from the RAM buffer.
+ */
+uint8 EventLog_read(uint16 index, uint8 *record)
+{
+	uint16 page;
+	uint8 i;
+
+	if(index >= g_committed)
+	{
+		index -= g_committed;
+		if(index >= g_buffered)
+		{
+			return ERROR;
+		}
+		for(i = 0; i < DOOR_LOG_RECORD_SIZE; i++)
+		{
+			record[i] = g_buffer[index][i];
+		}
+		return SUCCESS;
+	}
+
+	/* The committed pages end just before the head page */
+	page = (g_headPage + EVENT_LOG_PAGES - g_committed / EVENT_LOG_RECORDS_PER_PAGE + index / EVENT_LOG_RECORDS_PER_PAGE) % EVENT_LOG_PAGES;
+	if(EEPROM_readBlock(EVENT_LOG_PAGE_ADDRESS(page) + (index % EVENT_LOG_RECORDS_PER_PAGE) * DOOR_LOG_RECORD_SIZE,
+						record, DOOR_LOG_RECORD_SIZE) == ERROR || !EventLog_isValid(record))
+	{
+		return ERROR;
+	}
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * Set the time source of the time stamps.
+ */
+void EventLog_setTimeSource(uint32(*a_ptr)(void))
+{
+	g_timeSourcePtr = a_ptr;
+}
@@ -0,0 +1,83 @@
+ /******************************************************************************
+ *
+ * Module: Event Log
+ *
+ * File Name: event_log.h
+ *
+ * Description: Header file for the access event log kept in the external
+ *              EEPROM. The records (door_link.h DOOR_LOG_RECORD_SIZE layout)
+ *              are buffered in RAM and committed as whole 16-byte pages from
+ *              the main loop, in a circular region: once it is full, the
+ *              oldest page is overwritten.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#ifndef EVENT_LOG_H_
+#define EVENT_LOG_H_
+
+#include "std_types.h"
+#include "external_eeprom.h"
+#include "door_link.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Reserved region, page aligned: 0x0400..0x07FF */
+#define EVENT_LOG_ADDRESS			0x0400
+#define EVENT_LOG_PAGES				64
+
+#define EVENT_LOG_RECORDS_PER_PAGE	(EEPROM_PAGE_SIZE / DOOR_LOG_RECORD_SIZE)
+#define EVENT_LOG_CAPACITY			(EVENT_LOG_PAGES * EVENT_LOG_RECORDS_PER_PAGE)
+
+/* Records waiting in RAM for their page write, a whole number of pages */
+#define EVENT_LOG_BUFFER_RECORDS	(2 * EVENT_LOG_RECORDS_PER_PAGE)
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Find the newest page of the region and count the records kept.
+ * Torn pages fail the CRC of their records and are not counted.
+ */
+void EventLog_init(void);
+
+/*
+ * Description :
+ * Add a record to the RAM buffer, time stamped with the time source. ARG is
+ * saturated at DOOR_LOG_ARG_MAX.
+ * No bus access: the pages are written by EventLog_update. If the buffer is
+ * full the record is dropped.
+ */
+void EventLog_record(uint8 event, uint8 arg);
+
+/*
+ * Description :
+ * Write one full page of buffered records, called from the main loop.
+ */
+void EventLog_update(void);
+
+/*
+ * Description :
+ * Return the number of records kept, in the EEPROM and in the RAM buffer.
+ */
+uint16 EventLog_count(void);
+
+/*
+ * Description :
+ * Copy record index (0 is the oldest one) in the DOOR_LOG_RECORD_SIZE layout.
+ * Returns ERROR if it does not exist or cannot be read.
+ */
+uint8 EventLog_read(uint16 index, uint8 *record);
+
+/*
+ * Description :
+ * Set the function returning the seconds of the time stamps, e.g. RTC_seconds.
+ */
+void EventLog_setTimeSource(uint32(*a_ptr)(void));
+
+#endif /* EVENT_LOG_H_ */
@@ -11,72 +11,138 @@
  *******************************************************************************/
 #include "external_eeprom.h"
 #include "twi.h"
+#include <util/delay.h>
+
+/* 7-bit bus address of the 24C16, A10..A8 of the memory location select one of its 256-byte blocks */
+#define EEPROM_DEVICE_ADDRESS(u16addr)	((uint8)(0x50 | (((u16addr) & 0x0700)>>8)))
+
+/* Time between two ACK polls of a busy memory */
+#define EEPROM_POLL_US					100
+
+/* A write cycle is in progress since the last write */
+static boolean g_writeInFlight = FALSE;
+
+/*
+ * Wait for the end of the last write cycle: the memory ACKs its address again
+ * once the cycle is over. An address probe takes 10 SCL periods, a few of them
+ * per write cycle are enough. Returns ERROR if the memory never answers.
+ */
+static uint8 EEPROM_waitReady(void)
+{
+	uint16 polls = (EEPROM_WRITE_CYCLE_MS * 1000UL) / EEPROM_POLL_US;
+
+	if(!g_writeInFlight)
+		return SUCCESS;
+
+	while(TWI_transfer(EEPROM_DEVICE_ADDRESS(0), NULL_PTR, 0, NULL_PTR, 0) != TWI_OK)
+	{
+		if(polls-- == 0)
+			return ERROR;
+		_delay_us(EEPROM_POLL_US);
+	}
+	g_writeInFlight = FALSE;
+	return SUCCESS;
+}
 
 uint8 EEPROM_writeByte(uint16 u16addr, uint8 u8data)
 {
-	/* Send the Start Bit */
-    TWI_start();
-    if (TWI_getStatus() != TWI_START)
-        return ERROR;
-		
-    /* Send the device address, we need to get A8 A9 A10 address bits from the
-     * memory location address and R/W=0 (write) */
-    TWI_writeByte((uint8)(0xA0 | ((u16addr & 0x0700)>>7)));
-    if (TWI_getStatus() != TWI_MT_SLA_W_ACK)
-        return ERROR; 
-		 
-    /* Send the required memory location address */
-    TWI_writeByte((uint8)(u16addr));
-    if (TWI_getStatus() != TWI_MT_DATA_ACK)
-        return ERROR;
-		
-    /* write byte to eeprom */
-    TWI_writeByte(u8data);
-    if (TWI_getStatus() != TWI_MT_DATA_ACK)
-        return ERROR;
-
-    /* Send the Stop Bit */
-    TWI_stop();
-	
+	/* The memory location address (A7..A0), then the byte to write */
+	uint8 frame[2];
+
+	frame[0] = (uint8)(u16addr);
+	frame[1] = u8data;
+
+	if(EEPROM_waitReady() == ERROR)
+		return ERROR;
+
+	/* Start, device address + W, location, data and stop in one transaction */
+	if(TWI_writeBuffer(EEPROM_DEVICE_ADDRESS(u16addr), frame, 2) != TWI_OK)
+		return ERROR;
+
+	g_writeInFlight = TRUE;
     return SUCCESS;
 }
 
 uint8 EEPROM_readByte(uint16 u16addr, uint8 *u8data)
 {
-	/* Send the Start Bit */
-    TWI_start();
-    if (TWI_getStatus() != TWI_START)
-        return ERROR;
-		
-    /* Send the device address, we need to get A8 A9 A10 address bits from the
-     * memory location address and R/W=0 (write) */
-    TWI_writeByte((uint8)((0xA0) | ((u16addr & 0x0700)>>7)));
-    if (TWI_getStatus() != TWI_MT_SLA_W_ACK)
-        return ERROR;
-		
-    /* Send the required memory location address */
-    TWI_writeByte((uint8)(u16addr));
-    if (TWI_getStatus() != TWI_MT_DATA_ACK)
-        return ERROR;
-		
-    /* Send the Repeated Start Bit */
-    TWI_start();
-    if (TWI_getStatus() != TWI_REP_START)
-        return ERROR;
-		
-    /* Send the device address, we need to get A8 A9 A10 address bits from the
-     * memory location address and R/W=1 (Read) */
-    TWI_writeByte((uint8)((0xA0) | ((u16addr & 0x0700)>>7) | 1));
-    if (TWI_getStatus() != TWI_MT_SLA_R_ACK)
-        return ERROR;
-
-    /* Read Byte from Memory without send ACK */
-    *u8data = TWI_readByteWithNACK();
-    if (TWI_getStatus() != TWI_MR_DATA_NACK)
-        return ERROR;
-
-    /* Send the Stop Bit */
-    TWI_stop();
+	uint8 location = (uint8)(u16addr);
+
+	if(EEPROM_waitReady() == ERROR)
+		return ERROR;
+
+	/* Write the memory location address, then a repeated start to read one byte without ACK */
+	if(TWI_writeThenRead(EEPROM_DEVICE_ADDRESS(u16addr), &location, 1, u8data, 1) != TWI_OK)
+		return ERROR;
+
+    return SUCCESS;
+}
+
+uint8 EEPROM_writeBlock(uint16 u16addr, const uint8 *data, uint16 length)
+{
+	/* The memory location address (A7..A0), then up to one page of data */
+	uint8 frame[1 + EEPROM_PAGE_SIZE];
+	uint8 chunk;
+	uint8 i;
+
+	while(length != 0)
+	{
+		/* Stop at the page boundary, the 24C16 would wrap to the start of the page */
+		chunk = EEPROM_PAGE_SIZE - (u16addr & (EEPROM_PAGE_SIZE - 1));
+		if(chunk > length)
+		{
+			chunk = (uint8)length;
+		}
+
+		frame[0] = (uint8)(u16addr);
+		for(i = 0; i < chunk; i++)
+		{
+			frame[1 + i] = data[i];
+		}
+
+		/* The memory does not answer until the previous page is programmed */
+		if(EEPROM_waitReady() == ERROR)
+			return ERROR;
+		if(TWI_writeBuffer(EEPROM_DEVICE_ADDRESS(u16addr), frame, 1 + chunk) != TWI_OK)
+			return ERROR;
+		g_writeInFlight = TRUE;
+
+		u16addr += chunk;
+		data += chunk;
+		length -= chunk;
+	}
+
+    return SUCCESS;
+}
+
+uint8 EEPROM_readBlock(uint16 u16addr, uint8 *data, uint16 length)
+{
+	uint8 location;
+	uint16 chunk;
+
+	if(EEPROM_waitReady() == ERROR)
+		return ERROR;
+
+	while(length != 0)
+	{
+		/* Up to the end of the block, and no more than one TWI transaction can read */
+		chunk = EEPROM_BLOCK_SIZE - (u16addr & (EEPROM_BLOCK_SIZE - 1));
+		if(chunk > length)
+		{
+			chunk = length;
+		}
+		if(chunk > 0xFF)
+		{
+			chunk = 0xFF;
+		}
+
+		location = (uint8)(u16addr);
+		if(TWI_writeThenRead(EEPROM_DEVICE_ADDRESS(u16addr), &location, 1, data, (uint8)chunk) != TWI_OK)
+			return ERROR;
+
+		u16addr += chunk;
+		data += chunk;
+		length -= chunk;
+	}
 
     return SUCCESS;
 }
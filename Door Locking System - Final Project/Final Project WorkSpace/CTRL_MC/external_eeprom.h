@@ -22,11 +22,42 @@
 #define ERROR 0
 #define SUCCESS 1
 
+/* 24C16: 2 KB in 8 blocks of 256 bytes, written by pages of 16 bytes */
+#define EEPROM_SIZE				2048
+#define EEPROM_BLOCK_SIZE		256
+#define EEPROM_PAGE_SIZE		16
+
+/*
+ * Longest write cycle of the memory after a stop condition. The memory does
+ * not answer its address meanwhile, the next access polls it for an ACK.
+ */
+#define EEPROM_WRITE_CYCLE_MS	10
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
 
 uint8 EEPROM_writeByte(uint16 u16addr,uint8 u8data);
 uint8 EEPROM_readByte(uint16 u16addr,uint8 *u8data);
+
+/*
+ * Description :
+ * Write length bytes from u16addr on, split in page aligned chunks of at most
+ * EEPROM_PAGE_SIZE bytes: one bus transaction and one write cycle per page
+ * instead of one per byte.
+ * Writes return as soon as the data is on the bus; the next access polls the
+ * memory until its write cycle has completed, so a read that follows no write
+ * never waits.
+ */
+uint8 EEPROM_writeBlock(uint16 u16addr, const uint8 *data, uint16 length);
+
+/*
+ * Description :
+ * Read length bytes from u16addr on with sequential reads: the location is
+ * written once, then the bytes stream with an ACK each and a NACK after the
+ * last one. A read within one 256-byte block is a single bus transaction; each
+ * block crossed adds one, addressed with its own A10..A8 device address bits.
+ */
+uint8 EEPROM_readBlock(uint16 u16addr, uint8 *data, uint16 length);
  
 #endif /* EXTERNAL_EEPROM_H_ */
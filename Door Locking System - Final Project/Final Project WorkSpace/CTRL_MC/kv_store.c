@@ -0,0 +1,290 @@
+ /******************************************************************************
+ *
+ * Module: KV Store
+ *
+ * File Name: kv_store.c
+ *
+ * Description: Source file for the wear-levelled key/value store
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include "kv_store.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Record layout */
+#define KV_KEY_INDEX			0
+#define KV_SEQ_INDEX			1
+#define KV_LENGTH_INDEX			3
+#define KV_VALUE_INDEX			4
+#define KV_CRC_INDEX			(KV_RECORD_SIZE - 1)
+
+/* Nonzero, so a page of zeros is not a valid record */
+#define KV_CRC_SEED				0xFF
+
+#define KV_NO_SLOT				0xFF
+#define KV_NO_KEY				0xFF
+
+#define KV_SLOT_ADDRESS(slot)	((uint16)(KV_REGION_ADDRESS + (uint16)(slot) * KV_RECORD_SIZE))
+#define KV_NEXT_SLOT(slot, n)	((uint8)(((slot) + (n)) % KV_REGION_SLOTS))
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Slot of the newest record of every key */
+static uint8 g_index[KV_MAX_KEYS];
+
+/* Next slot written, and the sequence number it gets */
+static uint8 g_head = 0;
+static uint16 g_sequence = 0;
+
+/* Set by a complete scan, the head of a failed one could overwrite live records */
+static boolean g_scanned = FALSE;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/* TRUE if the record read from a slot is complete and belongs to a key */
+static boolean KV_isValid(const uint8 *record)
+{
+	return (record[KV_KEY_INDEX] < KV_MAX_KEYS &&
+			record[KV_LENGTH_INDEX] <= KV_VALUE_MAX_LENGTH &&
+			record[KV_CRC_INDEX] == KV_crc8(record, KV_CRC_INDEX));
+}
+
+/* Key whose newest record is in the slot, KV_NO_KEY if the slot can be overwritten */
+static uint8 KV_liveKey(uint8 slot)
+{
+	uint8 key;
+
+	for(key = 0; key < KV_MAX_KEYS; key++)
+	{
+		if(g_index[key] == slot)
+		{
+			return key;
+		}
+	}
+	return KV_NO_KEY;
+}
+
+/* Overwritable slots from the head on, counted up to KV_RESERVE_SLOTS */
+static uint8 KV_freeAhead(void)
+{
+	uint8 count = 0;
+
+	while(count < KV_RESERVE_SLOTS && KV_liveKey(KV_NEXT_SLOT(g_head, count)) == KV_NO_KEY)
+	{
+		count++;
+	}
+	return count;
+}
+
+/* Write a new version of a key at the head */
+static KV_StatusType KV_append(uint8 key, const uint8 *data, uint8 length)
+{
+	uint8 record[KV_RECORD_SIZE];
+	uint8 i;
+
+	record[KV_KEY_INDEX] = key;
+	record[KV_SEQ_INDEX] = (uint8)g_sequence;
+	record[KV_SEQ_INDEX + 1] = (uint8)(g_sequence >> 8);
+	record[KV_LENGTH_INDEX] = length;
+	for(i = 0; i < KV_VALUE_MAX_LENGTH; i++)
+	{
+		/* Unused bytes stay erased */
+		record[KV_VALUE_INDEX + i] = (i < length) ? data[i] : 0xFF;
+	}
+	record[KV_CRC_INDEX] = KV_crc8(record, KV_CRC_INDEX);
+
+	if(EEPROM_writeBlock(KV_SLOT_ADDRESS(g_head), record, KV_RECORD_SIZE) == ERROR)
+	{
+		return KV_EEPROM_ERROR;
+	}
+
+	g_index[key] = g_head;
+	g_head = KV_NEXT_SLOT(g_head, 1);
+	g_sequence++;
+	return KV_OK;
+}
+
+/* Copy the live record of a slot to the head, the slot becomes free */
+static KV_StatusType KV_relocate(uint8 slot)
+{
+	uint8 record[KV_RECORD_SIZE];
+
+	if(EEPROM_readBlock(KV_SLOT_ADDRESS(slot), record, KV_RECORD_SIZE) == ERROR)
+	{
+		return KV_EEPROM_ERROR;
+	}
+	if(!KV_isValid(record))
+	{
+		/* The cells lost the record, drop the key rather than block the log */
+		g_index[KV_liveKey(slot)] = KV_NO_SLOT;
+		return KV_OK;
+	}
+	return KV_append(record[KV_KEY_INDEX], &record[KV_VALUE_INDEX], record[KV_LENGTH_INDEX]);
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Rebuild the RAM index from the records of the region.
+ */
+KV_StatusType KV_init(void)
+{
+	uint8 record[KV_RECORD_SIZE];
+	uint16 keySequence[KV_MAX_KEYS];
+	uint16 newest = 0;
+	uint16 sequence;
+	boolean found = FALSE;
+	uint8 slot;
+	uint8 key;
+
+	for(key = 0; key < KV_MAX_KEYS; key++)
+	{
+		g_index[key] = KV_NO_SLOT;
+	}
+	g_head = 0;
+	g_sequence = 0;
+	g_scanned = FALSE;
+
+	for(slot = 0; slot < KV_REGION_SLOTS; slot++)
+	{
+		if(EEPROM_readBlock(KV_SLOT_ADDRESS(slot), record, KV_RECORD_SIZE) == ERROR)
+		{
+			return KV_EEPROM_ERROR;
+		}
+		if(!KV_isValid(record))
+		{
+			continue;
+		}
+
+		/*
+		 * Every slot is rewritten once per KV_REGION_SLOTS writes, so the valid
+		 * records are close in sequence and a signed difference orders them
+		 */
+		key = record[KV_KEY_INDEX];
+		sequence = record[KV_SEQ_INDEX] | ((uint16)record[KV_SEQ_INDEX + 1] << 8);
+		if(g_index[key] == KV_NO_SLOT || (sint16)(sequence - keySequence[key]) > 0)
+		{
+			g_index[key] = slot;
+			keySequence[key] = sequence;
+		}
+		if(!found || (sint16)(sequence - newest) > 0)
+		{
+			newest = sequence;
+			g_head = KV_NEXT_SLOT(slot, 1);
+			found = TRUE;
+		}
+	}
+
+	g_sequence = found ? (uint16)(newest + 1) : 0;
+	g_scanned = TRUE;
+	return KV_OK;
+}
+
+/*
+ * Description :
+ * Copy the value of a key from its newest record.
+ */
+KV_StatusType KV_read(uint8 key, uint8 *data, uint8 max_length, uint8 *length)
+{
+	uint8 record[KV_RECORD_SIZE];
+	uint8 i;
+
+	if(key >= KV_MAX_KEYS)
+	{
+		return KV_INVALID;
+	}
+	if(g_index[key] == KV_NO_SLOT)
+	{
+		return KV_NOT_FOUND;
+	}
+	if(EEPROM_readBlock(KV_SLOT_ADDRESS(g_index[key]), record, KV_RECORD_SIZE) == ERROR ||
+	   !KV_isValid(record) || record[KV_KEY_INDEX] != key)
+	{
+		return KV_EEPROM_ERROR;
+	}
+
+	*length = record[KV_LENGTH_INDEX];
+	for(i = 0; i < *length && i < max_length; i++)
+	{
+		data[i] = record[KV_VALUE_INDEX + i];
+	}
+	return KV_OK;
+}
+
+/*
+ * Description :
+ * Append a new version of a key, after freeing the two pages the write needs
+ * if the main loop has not compacted since the last writes. Refused until a
+ * scan has completed.
+ */
+KV_StatusType KV_write(uint8 key, const uint8 *data, uint8 length)
+{
+	KV_StatusType status;
+	uint8 free;
+
+	if(key >= KV_MAX_KEYS || length > KV_VALUE_MAX_LENGTH)
+	{
+		return KV_INVALID;
+	}
+	if(!g_scanned)
+	{
+		return KV_EEPROM_ERROR;
+	}
+
+	/* The head is always free: at least one page stays free after every write */
+	while((free = KV_freeAhead()) < 2)
+	{
+		status = KV_relocate(KV_NEXT_SLOT(g_head, free));
+		if(status != KV_OK)
+		{
+			return status;
+		}
+	}
+	return KV_append(key, data, length);
+}
+
+/*
+ * Description :
+ * One step of background compaction.
+ */
+void KV_update(void)
+{
+	uint8 free = KV_freeAhead();
+
+	if(g_scanned && free < KV_RESERVE_SLOTS)
+	{
+		KV_relocate(KV_NEXT_SLOT(g_head, free));
+	}
+}
+
+/*
+ * Description :
+ * CRC-8, polynomial x^8 + x^2 + x + 1, the same as the door link.
+ */
+uint8 KV_crc8(const uint8 *data, uint8 length)
+{
+	uint8 crc = KV_CRC_SEED;
+	uint8 bit;
+
+	while(length--)
+	{
+		crc ^= *data++;
+		for(bit = 0; bit < 8; bit++)
+		{
+			crc = (crc & 0x80) ? (uint8)((crc << 1) ^ 0x07) : (uint8)(crc << 1);
+		}
+	}
+	return crc;
+}
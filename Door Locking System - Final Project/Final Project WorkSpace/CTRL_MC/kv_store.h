@@ -0,0 +1,107 @@
+ /******************************************************************************
+ *
+ * Module: KV Store
+ *
+ * File Name: kv_store.h
+ *
+ * Description: Header file for the wear-levelled key/value store kept in the
+ *              external EEPROM.
+ *
+ *              The store is a circular log of one-page records in a reserved
+ *              EEPROM region. A write appends a new version of the record at
+ *              the head, so every page of the region is written in turn
+ *              instead of the same cells for every change:
+ *
+ *              | KEY | SEQ (2) | LENGTH | VALUE (KV_VALUE_MAX_LENGTH) | CRC-8 |
+ *
+ *              KV_init rebuilds a RAM index of the newest valid record of each
+ *              key, so a read is a single page read. The pages in front of the
+ *              head are kept free by moving the live records they still hold
+ *              to the head, from KV_update in the main loop.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#ifndef KV_STORE_H_
+#define KV_STORE_H_
+
+#include "std_types.h"
+#include "external_eeprom.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Reserved region, page aligned: 0x0000..0x03FF, 64 records */
+#define KV_REGION_ADDRESS		0x0000
+#define KV_REGION_SLOTS			64
+
+/* One record per EEPROM page */
+#define KV_RECORD_SIZE			EEPROM_PAGE_SIZE
+#define KV_VALUE_MAX_LENGTH		(KV_RECORD_SIZE - 5)	/* KEY, SEQ, LENGTH and CRC */
+
+/* Keys are 0..KV_MAX_KEYS-1 */
+#define KV_MAX_KEYS				8
+
+/*
+ * Free pages kept in front of the head by KV_update. A write needs 2 of them,
+ * the others absorb writes made before the main loop compacts again.
+ */
+#define KV_RESERVE_SLOTS		4
+
+#if (KV_MAX_KEYS + KV_RESERVE_SLOTS) > KV_REGION_SLOTS
+#error "The KV region is too small for its keys"
+#endif
+
+typedef enum
+{
+	KV_OK,
+	KV_NOT_FOUND,		/* the key was never written */
+	KV_INVALID,			/* key out of range or value longer than KV_VALUE_MAX_LENGTH */
+	KV_EEPROM_ERROR		/* the EEPROM did not answer */
+}KV_StatusType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Scan the region and rebuild the RAM index: the newest record with a valid
+ * CRC of every key, and the head after the newest record. Records torn by a
+ * reset in the middle of a write fail their CRC and are ignored.
+ * The TWI interrupts must be enabled. If the EEPROM does not answer, the
+ * index stays empty and KV_write and KV_update refuse to run until a later
+ * KV_init succeeds.
+ */
+KV_StatusType KV_init(void);
+
+/*
+ * Description :
+ * Copy the value of a key to data (at most max_length bytes) and its length.
+ * One page read, whatever the number of records in the region.
+ */
+KV_StatusType KV_read(uint8 key, uint8 *data, uint8 max_length, uint8 *length);
+
+/*
+ * Description :
+ * Append a new version of a key at the head: one page write.
+ * KV_EEPROM_ERROR if the EEPROM did not answer or KV_init did not complete.
+ */
+KV_StatusType KV_write(uint8 key, const uint8 *data, uint8 length);
+
+/*
+ * Description :
+ * Background compaction, called from the main loop: move at most one live
+ * record out of the KV_RESERVE_SLOTS pages in front of the head.
+ */
+void KV_update(void);
+
+/*
+ * Description :
+ * Return the CRC-8 the records are protected with, for RAM copies of values.
+ */
+uint8 KV_crc8(const uint8 *data, uint8 length);
+
+#endif /* KV_STORE_H_ */
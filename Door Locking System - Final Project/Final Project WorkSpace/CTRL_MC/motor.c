@@ -52,5 +52,5 @@ void DcMotor_Rotate(DCMotor_State state, uint8 speed)
             break;
     }
 
-	PWM_Timer0_Start(speed);
+	PWM_start(speed);
 }
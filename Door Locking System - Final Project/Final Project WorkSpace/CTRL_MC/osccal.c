@@ -0,0 +1,197 @@
+ /******************************************************************************
+ *
+ * Module: OSCCAL
+ *
+ * File Name: osccal.c
+ *
+ * Description: Source file for the calibration of the internal RC oscillator
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include "osccal.h"
+#include <avr/io.h>
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Longest wait for one crystal step (3.9 ms), with the RC up to 2.5 times too fast */
+#define OSCCAL_STEP_TIMEOUT_US		10000UL
+
+/* Two windows in a row this close: the crystal runs steadily */
+#define OSCCAL_STABLE_US			(OSCCAL_WINDOW_US / 1000)
+
+/* Longest crystal start-up */
+#define OSCCAL_STARTUP_US			2000000UL
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+static uint32 (*g_timeSourcePtr)(void) = NULL_PTR;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/* Wait for the next step of the Timer2 count, FALSE if it did not come */
+static boolean Osccal_waitStep(void)
+{
+	uint8 count = TCNT2;
+	uint32 start = (*g_timeSourcePtr)();
+
+	while(TCNT2 == count)
+	{
+		if((*g_timeSourcePtr)() - start > OSCCAL_STEP_TIMEOUT_US)
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* Time source us during OSCCAL_WINDOW_STEPS crystal steps, 0 without the crystal */
+static uint32 Osccal_measure(void)
+{
+	uint32 start;
+	uint8 i;
+
+	/* Start on a step, the window then holds whole steps */
+	if(!Osccal_waitStep())
+	{
+		return 0;
+	}
+	start = (*g_timeSourcePtr)();
+	for(i = 0; i < OSCCAL_WINDOW_STEPS; i++)
+	{
+		if(!Osccal_waitStep())
+		{
+			return 0;
+		}
+	}
+	return (*g_timeSourcePtr)() - start;
+}
+
+static uint32 Osccal_error(uint32 window)
+{
+	return (window > OSCCAL_WINDOW_US) ? window - OSCCAL_WINDOW_US : OSCCAL_WINDOW_US - window;
+}
+
+/* The crystal takes up to about 1 s to start, and runs slow meanwhile */
+static boolean Osccal_waitCrystal(void)
+{
+	uint32 start = (*g_timeSourcePtr)();
+	uint32 previous = 0;
+	uint32 window;
+
+	while((*g_timeSourcePtr)() - start < OSCCAL_STARTUP_US)
+	{
+		window = Osccal_measure();
+		if(window != 0 && previous != 0 &&
+		   ((window > previous) ? window - previous : previous - window) <= OSCCAL_STABLE_US)
+		{
+			return TRUE;
+		}
+		previous = window;
+	}
+	return FALSE;
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Set the time source of the measurements.
+ */
+void Osccal_setTimeSource(uint32(*a_ptr)(void))
+{
+	g_timeSourcePtr = a_ptr;
+}
+
+/*
+ * Description :
+ * A setting measuring a window longer than OSCCAL_WINDOW_US runs too fast.
+ * From the MSB down, each bit is kept if the clock is still not too fast with
+ * it. The setting found and the next one are then compared, the closest one
+ * wins.
+ */
+Osccal_StatusType Osccal_calibrate(void)
+{
+	uint8 initial = OSCCAL;
+	uint8 value = 0;
+	uint8 bit;
+	uint32 window;
+	uint32 error;
+
+	if(g_timeSourcePtr == NULL_PTR || !Osccal_waitCrystal())
+	{
+		return OSCCAL_NO_REFERENCE;
+	}
+
+	for(bit = 0x80; bit != 0; bit >>= 1)
+	{
+		Osccal_setValue(value | bit);
+		window = Osccal_measure();
+		if(window == 0)
+		{
+			Osccal_setValue(initial);
+			return OSCCAL_NO_REFERENCE;
+		}
+		if(window <= OSCCAL_WINDOW_US)
+		{
+			value |= bit;
+		}
+	}
+
+	Osccal_setValue(value);
+	window = Osccal_measure();
+	error = Osccal_error(window);
+	if(value != 0xFF)
+	{
+		Osccal_setValue(value + 1);
+		window = Osccal_measure();
+		if(window != 0 && Osccal_error(window) < error)
+		{
+			value++;
+			error = Osccal_error(window);
+		}
+	}
+
+	if(window == 0 || error > OSCCAL_MAX_ERROR_US)
+	{
+		Osccal_setValue(initial);
+		return (window == 0) ? OSCCAL_NO_REFERENCE : OSCCAL_OUT_OF_RANGE;
+	}
+	Osccal_setValue(value);
+	return OSCCAL_OK;
+}
+
+/*
+ * Description :
+ * Walk OSCCAL to the value one step at a time, so the clock never jumps by
+ * more than one calibration step while the code runs.
+ */
+void Osccal_setValue(uint8 value)
+{
+	while(OSCCAL < value)
+	{
+		OSCCAL++;
+	}
+	while(OSCCAL > value)
+	{
+		OSCCAL--;
+	}
+}
+
+/*
+ * Description :
+ * Read OSCCAL.
+ */
+uint8 Osccal_getValue(void)
+{
+	return OSCCAL;
+}
@@ -0,0 +1,85 @@
+ /******************************************************************************
+ *
+ * Module: OSCCAL
+ *
+ * File Name: osccal.h
+ *
+ * Description: Header file for the calibration of the internal RC oscillator.
+ *              The UBRR, TWBR and timer values are all computed from F_CPU,
+ *              but the RC oscillator can be several % off: at reset the
+ *              ATmega32 loads the factory calibration of the 1 MHz setting
+ *              only, the 8 MHz setting runs uncalibrated.
+ *
+ *              The reference is the 32.768 kHz crystal of the RTC: Timer2 runs
+ *              on it at /128 (rtc.c), so its count steps every 3906.25 us.
+ *              The time source, counting at F_CPU, measures
+ *              OSCCAL_WINDOW_STEPS of these steps, and a binary search over
+ *              the 8 bits of OSCCAL finds the setting measuring closest to
+ *              the expected time. The application keeps the result in the
+ *              EEPROM and gives it back at boot with Osccal_setValue.
+ *
+ *              Only the MCU running this calibration is tuned: a UART link
+ *              still depends on the RC tolerance of the other end. The
+ *              calibration moves the clock, so the UART is initialized after.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#ifndef OSCCAL_H_
+#define OSCCAL_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define OSCCAL_CRYSTAL_HZ			32768UL
+#define OSCCAL_REFERENCE_PRESCALER	128UL		/* Timer2 prescaler set by RTC_init */
+
+/* 16 crystal steps, 62.5 ms: the 1 us of SoftTimer_micros is 16 ppm of it */
+#define OSCCAL_WINDOW_STEPS			16
+#define OSCCAL_WINDOW_US			(OSCCAL_WINDOW_STEPS * OSCCAL_REFERENCE_PRESCALER * 1000000UL / OSCCAL_CRYSTAL_HZ)
+
+/* A best setting further off than 2 % means the reference is wrong */
+#define OSCCAL_MAX_ERROR_US			(OSCCAL_WINDOW_US / 50)
+
+typedef enum
+{
+	OSCCAL_OK,
+	OSCCAL_NO_REFERENCE,		/* the crystal did not start or stopped, OSCCAL is unchanged */
+	OSCCAL_OUT_OF_RANGE			/* no setting is within 2 %, OSCCAL is unchanged */
+}Osccal_StatusType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Set the function returning the time in us, e.g. SoftTimer_micros.
+ */
+void Osccal_setTimeSource(uint32(*a_ptr)(void));
+
+/*
+ * Description :
+ * Wait for the crystal to run steadily, up to about 2 s after RTC_init, then
+ * search the OSCCAL setting, about 0.6 s more. The time source must keep
+ * counting over a whole window, with the interrupts enabled.
+ */
+Osccal_StatusType Osccal_calibrate(void);
+
+/*
+ * Description :
+ * Set OSCCAL, e.g. to the value of an earlier calibration.
+ */
+void Osccal_setValue(uint8 value);
+
+/*
+ * Description :
+ * Return the OSCCAL setting.
+ */
+uint8 Osccal_getValue(void);
+
+#endif /* OSCCAL_H_ */
@@ -0,0 +1,49 @@
+ /******************************************************************************
+ *
+ * Module: Power
+ *
+ * File Name: power.h
+ *
+ * Description: Header file for the wait-for-event primitive. Instead of
+ *              spinning on a flag written by an ISR, the CPU sleeps until the
+ *              next interrupt and checks the flag again.
+ *
+ *              The check and the sleep cannot race: the condition is checked
+ *              with the interrupts disabled, and SEI is immediately followed
+ *              by SLEEP. The AVR always runs the instruction after SEI before
+ *              any pending interrupt, so an interrupt arriving after the check
+ *              wakes the CPU from that SLEEP instead of being taken before it.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#ifndef POWER_H_
+#define POWER_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+
+typedef enum{
+	POWER_IDLE,					/* CPU stopped, the peripherals and their interrupts run */
+	POWER_ADC_NOISE_REDUCTION,	/* I/O clock stopped too (Timer0/1, UART, SPI), the ADC converts */
+	POWER_SAVE					/* all clocks stopped but the asynchronous Timer2 crystal */
+}Power_SleepMode;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Sleep in the given mode until condition returns TRUE, checked before the
+ * first sleep and after every wake-up. The condition is called with the
+ * interrupts disabled and must not enable them. Called with the interrupts
+ * enabled, an interrupt enabled in the mode must change the condition.
+ */
+void Power_waitFor(boolean (*condition)(void), Power_SleepMode mode);
+
+#endif /* POWER_H_ */
@@ -0,0 +1,284 @@
+ /******************************************************************************
+ *
+ * Module: RTC
+ *
+ * File Name: rtc.c
+ *
+ * Description: Source file for the real-time clock
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include "rtc.h"
+#include "timer.h"
+#include "timer_resources.h"
+#include <avr/io.h>
+
+/* A board without the crystal sets RTC_TIMER to TIMER_NONE, the module is then empty */
+#if RTC_TIMER != TIMER_NONE
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define RTC_SECONDS_PER_DAY		86400UL
+
+/* One second of error, in ppm x seconds */
+#define RTC_PPM_SECOND			1000000L
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Seconds since the epoch, counted by the Timer2 overflow */
+static volatile uint32 g_seconds = 0;
+
+/* Error not corrected yet in ppm x seconds, only used by the interrupt */
+static sint32 g_drift = 0;
+
+static volatile sint16 g_calibration = 0;
+
+/* Time given by the last RTC_setTime, the start of the next calibration */
+static uint32 g_referenceSeconds = 0;
+static boolean g_referenceValid = FALSE;
+
+static const uint8 g_monthDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+static boolean RTC_isLeapYear(uint16 year)
+{
+	return ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0);
+}
+
+static uint8 RTC_monthDays(uint8 year, uint8 month)
+{
+	return (month == 2 && RTC_isLeapYear(RTC_EPOCH_YEAR + year)) ? 29 : g_monthDays[month - 1];
+}
+
+static uint16 RTC_yearDays(uint8 year)
+{
+	return RTC_isLeapYear(RTC_EPOCH_YEAR + year) ? 366 : 365;
+}
+
+static boolean RTC_isValid(const RTC_TimeType *Time_Ptr)
+{
+	return (Time_Ptr->second < 60 && Time_Ptr->minute < 60 && Time_Ptr->hour < 24 &&
+			Time_Ptr->month >= 1 && Time_Ptr->month <= 12 && Time_Ptr->year <= 135 &&
+			Time_Ptr->day >= 1 && Time_Ptr->day <= RTC_monthDays(Time_Ptr->year, Time_Ptr->month));
+}
+
+static uint32 RTC_toSeconds(const RTC_TimeType *Time_Ptr)
+{
+	uint32 days = Time_Ptr->day - 1;
+	uint8 i;
+
+	for(i = 0; i < Time_Ptr->year; i++)
+	{
+		days += RTC_yearDays(i);
+	}
+	for(i = 1; i < Time_Ptr->month; i++)
+	{
+		days += RTC_monthDays(Time_Ptr->year, i);
+	}
+	return days * RTC_SECONDS_PER_DAY +
+		   ((uint32)Time_Ptr->hour * 60 + Time_Ptr->minute) * 60 + Time_Ptr->second;
+}
+
+static void RTC_toTime(uint32 seconds, RTC_TimeType *Time_Ptr)
+{
+	uint32 days = seconds / RTC_SECONDS_PER_DAY;
+	uint32 rest = seconds % RTC_SECONDS_PER_DAY;
+
+	Time_Ptr->second = (uint8)(rest % 60);
+	Time_Ptr->minute = (uint8)((rest / 60) % 60);
+	Time_Ptr->hour = (uint8)(rest / 3600);
+
+	Time_Ptr->year = 0;
+	while(days >= RTC_yearDays(Time_Ptr->year))
+	{
+		days -= RTC_yearDays(Time_Ptr->year);
+		Time_Ptr->year++;
+	}
+	Time_Ptr->month = 1;
+	while(days >= RTC_monthDays(Time_Ptr->year, Time_Ptr->month))
+	{
+		days -= RTC_monthDays(Time_Ptr->year, Time_Ptr->month);
+		Time_Ptr->month++;
+	}
+	Time_Ptr->day = (uint8)(days + 1);
+}
+
+/* Timer2 overflow, every second of the crystal */
+static void RTC_tick(void)
+{
+	g_drift += g_calibration;
+	if(g_drift >= RTC_PPM_SECOND)
+	{
+		/* Fast crystal: one second too many has been counted, this one is dropped */
+		g_drift -= RTC_PPM_SECOND;
+	}
+	else
+	{
+		g_seconds++;
+		if(g_drift <= -RTC_PPM_SECOND)
+		{
+			/* Slow crystal: one second is missing */
+			g_drift += RTC_PPM_SECOND;
+			g_seconds++;
+		}
+	}
+
+	/* A power-save sleep entered right after this interrupt is woken by the next one */
+	Timer2_waitAsyncUpdate();
+}
+
+/* Start a new second at the given time */
+static void RTC_store(uint32 seconds)
+{
+	uint8 sreg = SREG;
+
+	SREG &= ~(1<<7);
+	TCNT2 = 0;
+	while(ASSR & (1 << TCN2UB));
+	TIFR = (1 << TOV2);
+	g_seconds = seconds;
+	g_drift = 0;
+	SREG = sreg;
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Timer2 in normal mode on the crystal: 32768 Hz / 128 / 256 = 1 Hz.
+ */
+void RTC_init(void)
+{
+	Timer2_ConfigType RTC_config = {0, 0, TIMER2_F_CPU_128, NORMAL_MODE, OC_DISCONNECTED};
+
+	Timer2_setCallBack(&RTC_tick);
+	Timer2_initAsync(&RTC_config);
+}
+
+/*
+ * Description :
+ * Convert the date and restart the second.
+ */
+boolean RTC_setTime(const RTC_TimeType *Time_Ptr)
+{
+	if(!RTC_isValid(Time_Ptr))
+	{
+		return FALSE;
+	}
+
+	g_referenceSeconds = RTC_toSeconds(Time_Ptr);
+	g_referenceValid = TRUE;
+	RTC_store(g_referenceSeconds);
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Convert the seconds to a date.
+ */
+void RTC_getTime(RTC_TimeType *Time_Ptr)
+{
+	RTC_toTime(RTC_seconds(), Time_Ptr);
+}
+
+/*
+ * Description :
+ * Read the count with the interrupt disabled.
+ */
+uint32 RTC_seconds(void)
+{
+	uint8 sreg = SREG;
+	uint32 seconds;
+
+	SREG &= ~(1<<7);
+	seconds = g_seconds;
+	SREG = sreg;
+	return seconds;
+}
+
+/*
+ * Description :
+ * The clock already runs with the calibration, the error left since the last
+ * reference corrects it.
+ */
+boolean RTC_calibrate(const RTC_TimeType *Reference_Ptr)
+{
+	uint32 reference;
+	uint32 elapsed;
+	sint32 error;
+	sint32 ppm;
+
+	if(!g_referenceValid || !RTC_isValid(Reference_Ptr))
+	{
+		return FALSE;
+	}
+	reference = RTC_toSeconds(Reference_Ptr);
+	if(reference < g_referenceSeconds || reference - g_referenceSeconds < RTC_CALIBRATION_MIN_SECONDS)
+	{
+		return FALSE;
+	}
+	elapsed = reference - g_referenceSeconds;
+
+	/* Positive when the clock is ahead, the crystal is fast */
+	error = (sint32)(RTC_seconds() - reference);
+	ppm = g_calibration + (sint32)((sint64)error * RTC_PPM_SECOND / (sint64)elapsed);
+	if(ppm > RTC_MAX_PPM || ppm < -RTC_MAX_PPM)
+	{
+		/* Not a drift: the reference or the last time set was wrong */
+		return FALSE;
+	}
+
+	RTC_setCalibration((sint16)ppm);
+	RTC_setTime(Reference_Ptr);
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Write the calibration with the interrupt disabled, the ISR reads it.
+ */
+void RTC_setCalibration(sint16 ppm)
+{
+	uint8 sreg = SREG;
+
+	if(ppm > RTC_MAX_PPM)
+	{
+		ppm = RTC_MAX_PPM;
+	}
+	else if(ppm < -RTC_MAX_PPM)
+	{
+		ppm = -RTC_MAX_PPM;
+	}
+
+	SREG &= ~(1<<7);
+	g_calibration = ppm;
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Return the calibration.
+ */
+sint16 RTC_getCalibration(void)
+{
+	uint8 sreg = SREG;
+	sint16 ppm;
+
+	SREG &= ~(1<<7);
+	ppm = g_calibration;
+	SREG = sreg;
+	return ppm;
+}
+
+#endif /* RTC_TIMER != TIMER_NONE */
@@ -0,0 +1,111 @@
+ /******************************************************************************
+ *
+ * Module: RTC
+ *
+ * File Name: rtc.h
+ *
+ * Description: Header file for the real-time clock. Timer2 runs in
+ *              asynchronous mode on a 32.768 kHz watch crystal (TOSC1/TOSC2),
+ *              so the seconds do not depend on the RC oscillator of the CPU
+ *              and keep counting in power-save mode: the overflow interrupt
+ *              wakes the CPU every second.
+ *
+ *              The time is kept as seconds since 2000-01-01 00:00:00 and
+ *              converted to a date on request, up to year 2135. Until it is
+ *              set, the clock counts from that epoch, like an uptime.
+ *
+ *              A crystal is typically 20 ppm off, 1.7 s per day. The error
+ *              measured between two reference times is kept as a calibration
+ *              in ppm: the clock drops or adds one second every time the
+ *              corrected error adds up to a full second. The application
+ *              stores the calibration in the EEPROM and gives it back at boot.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#ifndef RTC_H_
+#define RTC_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define RTC_EPOCH_YEAR				2000
+
+/* Calibration range in ppm, a crystal further off is faulty */
+#define RTC_MAX_PPM					500
+
+/*
+ * Shortest time between two references for a calibration, 1 day: the time is
+ * set to the second, so the error is then known to 11.6 ppm
+ */
+#define RTC_CALIBRATION_MIN_SECONDS	86400UL
+
+typedef struct{
+	uint8 second;					/* 0..59 */
+	uint8 minute;					/* 0..59 */
+	uint8 hour;						/* 0..23 */
+	uint8 day;						/* 1..31 */
+	uint8 month;					/* 1..12 */
+	uint8 year;						/* years since RTC_EPOCH_YEAR, 0..135 */
+}RTC_TimeType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Start Timer2 on the crystal with a 1 s overflow, Timer2 belongs to the RTC
+ * from then on. The crystal takes about 1 s to start.
+ */
+void RTC_init(void);
+
+/*
+ * Description :
+ * Set the time, it becomes the reference of the next RTC_calibrate. Returns
+ * FALSE, and changes nothing, for an invalid date.
+ */
+boolean RTC_setTime(const RTC_TimeType *Time_Ptr);
+
+/*
+ * Description :
+ * Read the time as a date.
+ */
+void RTC_getTime(RTC_TimeType *Time_Ptr);
+
+/*
+ * Description :
+ * Return the seconds since RTC_EPOCH_YEAR, e.g. for EventLog_setTimeSource.
+ * Safe to call from any context.
+ */
+uint32 RTC_seconds(void);
+
+/*
+ * Description :
+ * Compare the clock with a reference time given at least
+ * RTC_CALIBRATION_MIN_SECONDS after the last RTC_setTime, correct the
+ * calibration with the error and set the time. Returns TRUE if the
+ * calibration has changed, to be stored. Returns FALSE and changes nothing if
+ * the last reference is too recent or the error is out of range: the time is
+ * then only to be set, with RTC_setTime.
+ */
+boolean RTC_calibrate(const RTC_TimeType *Reference_Ptr);
+
+/*
+ * Description :
+ * Set the calibration in ppm, positive for a fast crystal. Clamped to
+ * +/-RTC_MAX_PPM.
+ */
+void RTC_setCalibration(sint16 ppm);
+
+/*
+ * Description :
+ * Return the calibration in ppm.
+ */
+sint16 RTC_getCalibration(void);
+
+#endif /* RTC_H_ */
@@ -0,0 +1,484 @@
+ /******************************************************************************
+ *
+ * Module: SPI
+ *
+ * File Name: spi.c
+ *
+ * Description: Source file for the SPI driver
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include "spi.h"
+#include "isr_profile.h"
+#include "gpio.h"
+#include "timer.h"
+#include "timer_resources.h"
+#include "common_macros.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#define SPI_RX_BUFFER_MASK		(SPI_RX_BUFFER_SIZE - 1)
+
+#if SPI_GAP_TIMER != TIMER_NONE
+/* The byte gap counted at F_CPU/8, the compare matches after SPI_GAP_COMPARE + 1 counts */
+#define SPI_GAP_COMPARE			((F_CPU / 8UL) * SPI_BYTE_GAP_US / 1000000UL - 1)
+#if SPI_GAP_COMPARE < 1 || SPI_GAP_COMPARE > 255
+#error "SPI_BYTE_GAP_US does not fit the 8-bit gap timer at F_CPU/8"
+#endif
+#endif
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+static SPI_Role g_role = SPI_SLAVE;
+
+/* Block transfer in progress, moved byte by byte by the Serial Transfer Complete ISR */
+static const uint8 *volatile g_blockTx = NULL_PTR;
+static uint8 *volatile g_blockRx = NULL_PTR;
+static volatile uint8 g_blockLength = 0;
+static volatile uint8 g_blockIndex = 0;
+static volatile boolean g_blockBusy = FALSE;
+static void (*volatile g_blockDonePtr)(void) = NULL_PTR;
+
+/* Global variable to hold the address of the call back function in the application */
+static void (*volatile g_callBackPtr)(void) = NULL_PTR;
+
+/* Message layer: length bytes of the current exchange and the message to send */
+static uint8 g_headerTx = 0;
+static uint8 g_headerRx = 0;
+static uint8 g_txMessage[SPI_MESSAGE_MAX_LENGTH];
+static uint8 g_rxMessage[SPI_MESSAGE_MAX_LENGTH];
+static volatile uint8 g_txLength = 0;
+static volatile boolean g_txPending = FALSE;
+static volatile boolean g_messageLayer = FALSE;
+static volatile boolean g_slaveArmed = FALSE;	/* Slave length byte loaded, exchange not started */
+
+/* Master poll pacing */
+static uint32 (*g_timeSourcePtr)(void) = NULL_PTR;
+static uint32 g_lastPoll = 0;
+
+#if SPI_GAP_TIMER != TIMER_NONE
+/* Byte the master loads at the end of the gap */
+static volatile uint8 g_gapData = SPI_DUMMY_BYTE;
+#endif
+
+/* Received messages, each one stored as its length byte followed by its data */
+static volatile uint8 g_rxBuffer[SPI_RX_BUFFER_SIZE];
+static volatile uint8 g_rxHead = 0;
+static volatile uint8 g_rxTail = 0;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+static void SPI_headerDone(void);
+
+#if SPI_GAP_TIMER != TIMER_NONE
+/* Gap timer callback: the slave had its time, clock the byte */
+static void SPI_gapElapsed(void)
+{
+#if SPI_GAP_TIMER == TIMER_0
+	Timer0_deInit();
+#else
+	Timer2_deInit();
+#endif
+	SPDR = g_gapData;
+}
+#endif
+
+/*
+ * Load the next byte of the block. The master leaves the slave time to load
+ * its own first: the byte is clocked when the gap timer expires.
+ */
+static void SPI_loadByte(void)
+{
+	uint8 data = (g_blockTx != NULL_PTR) ? g_blockTx[g_blockIndex] : SPI_DUMMY_BYTE;
+
+#if SPI_GAP_TIMER == TIMER_0
+	Timer0_ConfigType GAP_config = {0, SPI_GAP_COMPARE, F_CPU_8, COMPARE_MODE, OC_DISCONNECTED};
+#elif SPI_GAP_TIMER == TIMER_2
+	Timer2_ConfigType GAP_config = {0, SPI_GAP_COMPARE, TIMER2_F_CPU_8, COMPARE_MODE, OC_DISCONNECTED};
+#endif
+
+#if SPI_GAP_TIMER != TIMER_NONE
+	if(g_role == SPI_MASTER)
+	{
+		g_gapData = data;
+#if SPI_GAP_TIMER == TIMER_0
+		Timer0_setCallBack(&SPI_gapElapsed);
+		Timer0_init(&GAP_config);
+#else
+		Timer2_setCallBack(&SPI_gapElapsed);
+		Timer2_init(&GAP_config);
+#endif
+		return;
+	}
+#endif
+	SPDR = data;
+}
+
+static void SPI_startBlock(const uint8 *tx_data, uint8 *rx_data, uint8 length, void(*done)(void))
+{
+	g_blockTx = tx_data;
+	g_blockRx = rx_data;
+	g_blockLength = length;
+	g_blockIndex = 0;
+	g_blockDonePtr = done;
+	g_blockBusy = TRUE;
+	SPI_loadByte();
+}
+
+/* End of a block started by SPI_transferBlock */
+static void SPI_blockDone(void)
+{
+	if(g_role == SPI_MASTER)
+	{
+		GPIO_writePin(SPI_PORT_ID, SPI_SS_PIN_ID, LOGIC_HIGH);
+	}
+	if(g_callBackPtr != NULL_PTR)
+	{
+		(*g_callBackPtr)();
+	}
+}
+
+/* Store a received message, it is dropped if the buffer has no room for it */
+static void SPI_pushMessage(const uint8 *data, uint8 length)
+{
+	uint8 room = (g_rxTail - g_rxHead - 1) & SPI_RX_BUFFER_MASK;
+	uint8 i;
+
+	if(room <= length)
+	{
+		return;
+	}
+	g_rxBuffer[g_rxHead] = length;
+	g_rxHead = (g_rxHead + 1) & SPI_RX_BUFFER_MASK;
+	for(i = 0; i < length; i++)
+	{
+		g_rxBuffer[g_rxHead] = data[i];
+		g_rxHead = (g_rxHead + 1) & SPI_RX_BUFFER_MASK;
+	}
+}
+
+/* Load the slave length byte, the pending message length or 0, for the next exchange */
+static void SPI_armSlave(void)
+{
+	g_headerTx = g_txPending ? g_txLength : 0;
+	g_slaveArmed = TRUE;
+	SPI_startBlock(&g_headerTx, &g_headerRx, 1, SPI_headerDone);
+}
+
+/* Master pulls SS low and swaps the length bytes */
+static void SPI_startExchange(void)
+{
+	GPIO_writePin(SPI_PORT_ID, SPI_SS_PIN_ID, LOGIC_LOW);
+	SPI_startBlock(&g_headerTx, &g_headerRx, 1, SPI_headerDone);
+}
+
+/* End of a message exchange, on both sides */
+static void SPI_exchangeDone(void)
+{
+	if(g_headerRx != 0 && g_headerRx <= SPI_MESSAGE_MAX_LENGTH)
+	{
+		SPI_pushMessage(g_rxMessage, g_headerRx);
+	}
+	if(g_headerTx != 0)
+	{
+		g_txPending = FALSE;
+	}
+
+	if(g_role == SPI_MASTER)
+	{
+		GPIO_writePin(SPI_PORT_ID, SPI_SS_PIN_ID, LOGIC_HIGH);
+	}
+	else
+	{
+		SPI_armSlave();
+	}
+}
+
+/* Both length bytes are known, clock the longest message in both directions */
+static void SPI_headerDone(void)
+{
+	uint8 length = (g_headerTx > g_headerRx) ? g_headerTx : g_headerRx;
+	uint8 i;
+
+	g_slaveArmed = FALSE;
+	if(length > SPI_MESSAGE_MAX_LENGTH)
+	{
+		length = SPI_MESSAGE_MAX_LENGTH;
+	}
+
+	if(length == 0)
+	{
+		SPI_exchangeDone();
+	}
+	else if(g_headerTx == 0)
+	{
+		SPI_startBlock(NULL_PTR, g_rxMessage, length, SPI_exchangeDone);
+	}
+	else
+	{
+		for(i = g_headerTx; i < length; i++)
+		{
+			g_txMessage[i] = SPI_DUMMY_BYTE;
+		}
+		SPI_startBlock(g_txMessage, g_rxMessage, length, SPI_exchangeDone);
+	}
+}
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+/* End of a byte transfer, from the interrupt */
+static void SPI_transferComplete(void)
+{
+	/* Reading SPSR before SPDR also clears a write collision flag */
+	uint8 status = SPSR;
+	uint8 data = SPDR;
+
+	(void)status;
+	if(!g_blockBusy)
+	{
+		return;
+	}
+
+	if(g_blockRx != NULL_PTR)
+	{
+		g_blockRx[g_blockIndex] = data;
+	}
+	g_blockIndex++;
+
+	if(g_blockIndex < g_blockLength)
+	{
+		SPI_loadByte();
+	}
+	else
+	{
+		g_blockBusy = FALSE;
+		if(g_blockDonePtr != NULL_PTR)
+		{
+			(*g_blockDonePtr)();
+		}
+	}
+}
+
+ISR(SPI_STC_vect)
+{
+	ISR_PROFILE_ENTER(ISR_PROFILE_SPI_STC);
+	SPI_transferComplete();
+	ISR_PROFILE_EXIT(ISR_PROFILE_SPI_STC);
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Setup the SPI pins of the selected role, the clock and the data order,
+ * then enable the SPI and its interrupt.
+ */
+void SPI_init(const SPI_ConfigType *Config_Ptr)
+{
+	g_role = Config_Ptr->role;
+	g_blockBusy = FALSE;
+	g_messageLayer = FALSE;
+	g_slaveArmed = FALSE;
+	g_txPending = FALSE;
+	g_rxHead = g_rxTail = 0;
+
+	if(g_role == SPI_MASTER)
+	{
+		/* SS is an output driven by the driver, so the SPI never falls back to slave mode */
+		GPIO_setupPinDirection(SPI_PORT_ID, SPI_SS_PIN_ID, PIN_OUTPUT);
+		GPIO_setupPinDirection(SPI_PORT_ID, SPI_MOSI_PIN_ID, PIN_OUTPUT);
+		GPIO_setupPinDirection(SPI_PORT_ID, SPI_MISO_PIN_ID, PIN_INPUT);
+		GPIO_setupPinDirection(SPI_PORT_ID, SPI_SCK_PIN_ID, PIN_OUTPUT);
+		GPIO_writePin(SPI_PORT_ID, SPI_SS_PIN_ID, LOGIC_HIGH);
+	}
+	else
+	{
+		GPIO_setupPinDirection(SPI_PORT_ID, SPI_SS_PIN_ID, PIN_INPUT);
+		GPIO_setupPinDirection(SPI_PORT_ID, SPI_MOSI_PIN_ID, PIN_INPUT);
+		GPIO_setupPinDirection(SPI_PORT_ID, SPI_MISO_PIN_ID, PIN_OUTPUT);
+		GPIO_setupPinDirection(SPI_PORT_ID, SPI_SCK_PIN_ID, PIN_INPUT);
+	}
+
+	/*
+	 * SPIE      = 1 Enable SPI Serial Transfer Complete Interrupt
+	 * SPE       = 1 SPI Enable
+	 * DORD      = Data order in Configuration structure
+	 * MSTR      = Role in Configuration structure
+	 * CPOL:CPHA = Clock mode in Configuration structure
+	 * SPR1:0    = Clock rate in Configuration structure, SPI2X in SPSR
+	 */
+	SPCR = (1<<SPIE) | (1<<SPE) | ((Config_Ptr->data_order)<<DORD) | ((Config_Ptr->role)<<MSTR)
+		 | ((Config_Ptr->clock_mode)<<CPHA) | ((Config_Ptr->clock) & 0x03);
+	SPSR = ((Config_Ptr->clock)>>2)<<SPI2X;
+}
+
+/*
+ * Description :
+ * Start a block transfer of length bytes and return immediately.
+ * The master frames the block with SS.
+ */
+void SPI_transferBlock(const uint8 *tx_data, uint8 *rx_data, uint8 length)
+{
+	while(SPI_isBusy());
+	if(length == 0)
+	{
+		return;
+	}
+	if(g_role == SPI_MASTER)
+	{
+		GPIO_writePin(SPI_PORT_ID, SPI_SS_PIN_ID, LOGIC_LOW);
+	}
+	SPI_startBlock(tx_data, rx_data, length, SPI_blockDone);
+}
+
+/*
+ * Description :
+ * Return TRUE while a block transfer or a message exchange is in progress.
+ */
+boolean SPI_isBusy(void)
+{
+	/* An armed slave waits for the master, nothing is moving yet */
+	return g_blockBusy && !g_slaveArmed;
+}
+
+/*
+ * Description :
+ * Set the function called from the ISR at the end of SPI_transferBlock.
+ */
+void SPI_setCallBack(void(*a_ptr)(void))
+{
+	g_callBackPtr = a_ptr;
+}
+
+/*
+ * Description :
+ * Queue one message. The master sends it at once, a slave sends it the next
+ * time the master clocks.
+ */
+void SPI_sendMessage(const uint8 *data, uint8 length)
+{
+	uint8 sreg;
+	uint8 i;
+
+	if(length > SPI_MESSAGE_MAX_LENGTH)
+	{
+		return;
+	}
+
+	/* Wait until the previous message has left */
+	while(g_txPending || (g_role == SPI_MASTER && g_blockBusy));
+
+	for(i = 0; i < length; i++)
+	{
+		g_txMessage[i] = data[i];
+	}
+	g_txLength = length;
+
+	if(g_role == SPI_MASTER)
+	{
+		g_txPending = TRUE;
+		g_headerTx = length;
+		SPI_startExchange();
+		return;
+	}
+
+	sreg = SREG;
+	cli();
+	g_txPending = TRUE;
+	if(!g_messageLayer)
+	{
+		g_messageLayer = TRUE;
+		SPI_armSlave();
+	}
+	else if(g_slaveArmed && g_headerTx == 0 && BIT_IS_CLEAR(SPSR, SPIF))
+	{
+		/*
+		 * Replace the empty length byte already loaded. If the master started
+		 * clocking meanwhile, the write collides and the message waits for
+		 * the next exchange. If the empty byte has already left (SPIF set,
+		 * the ISR pending), writing SPDR does not collide: the message waits
+		 * as well.
+		 */
+		SPDR = length;
+		if(BIT_IS_CLEAR(SPSR, WCOL))
+		{
+			g_headerTx = length;
+		}
+	}
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Copy a received message and its length without blocking.
+ * Return FALSE if none has been received yet.
+ */
+boolean SPI_receiveMessage(uint8 *data, uint8 *length)
+{
+	uint8 sreg;
+	uint8 i;
+
+	if(g_role == SPI_SLAVE)
+	{
+		sreg = SREG;
+		cli();
+		if(!g_messageLayer)
+		{
+			g_messageLayer = TRUE;
+			SPI_armSlave();
+		}
+		else if(!g_slaveArmed && GPIO_readPin(SPI_PORT_ID, SPI_SS_PIN_ID) == LOGIC_HIGH && BIT_IS_CLEAR(SPSR, SPIF))
+		{
+			/* The master ended the exchange before the expected length, resynchronize */
+			SPI_armSlave();
+		}
+		SREG = sreg;
+	}
+
+	if(g_rxHead == g_rxTail)
+	{
+		if(g_role == SPI_MASTER && !g_blockBusy)
+		{
+			if(g_timeSourcePtr != NULL_PTR)
+			{
+				if((*g_timeSourcePtr)() - g_lastPoll < SPI_POLL_INTERVAL_US)
+				{
+					return FALSE;
+				}
+				g_lastPoll = (*g_timeSourcePtr)();
+			}
+			/* Poll: an empty message lets the slave send its pending one */
+			g_headerTx = 0;
+			SPI_startExchange();
+		}
+		return FALSE;
+	}
+
+	*length = g_rxBuffer[g_rxTail];
+	g_rxTail = (g_rxTail + 1) & SPI_RX_BUFFER_MASK;
+	for(i = 0; i < *length; i++)
+	{
+		data[i] = g_rxBuffer[g_rxTail];
+		g_rxTail = (g_rxTail + 1) & SPI_RX_BUFFER_MASK;
+	}
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Set the micro-second time source that paces the polls of the master.
+ */
+void SPI_setTimeSource(uint32(*a_ptr)(void))
+{
+	g_timeSourcePtr = a_ptr;
+}
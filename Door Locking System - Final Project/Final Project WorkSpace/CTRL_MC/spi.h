@@ -0,0 +1,149 @@
+ /******************************************************************************
+ *
+ * Module: SPI
+ *
+ * File Name: spi.h
+ *
+ * Description: Header file for the SPI driver.
+ *              Block transfers are interrupt driven: the SPI Serial Transfer
+ *              Complete ISR moves the next byte while the application runs.
+ *
+ *              The message layer frames every exchange with the SS pin (PB4).
+ *              The master pulls SS low, both sides swap a length byte, then
+ *              the longest of the two messages is clocked in both directions:
+ *
+ *              MOSI : | master length | master message, padded with SPI_DUMMY_BYTE |
+ *              MISO : | slave length  | slave message,  padded with SPI_DUMMY_BYTE  |
+ *
+ *              A slave can only answer when the master clocks, so the master
+ *              polls with an empty message while it waits for one.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#ifndef SPI_H_
+#define SPI_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define SPI_PORT_ID				PORTB_ID
+#define SPI_SS_PIN_ID			PIN4_ID
+#define SPI_MOSI_PIN_ID			PIN5_ID
+#define SPI_MISO_PIN_ID			PIN6_ID
+#define SPI_SCK_PIN_ID			PIN7_ID
+
+#define SPI_DUMMY_BYTE			0x00
+
+/* Longest message of the message layer */
+#define SPI_MESSAGE_MAX_LENGTH	32
+
+/* Received messages waiting for SPI_receiveMessage, with their length byte (power of 2, at most 128) */
+#define SPI_RX_BUFFER_SIZE		64
+
+/*
+ * Idle time the master leaves before every byte, so the slave ISR can load
+ * the next byte into SPDR. It must cover the slave interrupt latency.
+ * The master counts it on SPI_GAP_TIMER (timer_resources.h), a one-shot
+ * compare that loads the byte from its interrupt, so no ISR waits for it.
+ */
+#define SPI_BYTE_GAP_US			20
+
+/* Shortest time between two polls of an idle master, when it has a time source */
+#ifndef SPI_POLL_INTERVAL_US
+#define SPI_POLL_INTERVAL_US	100UL
+#endif
+
+/*SCK frequency, SPI2X:SPR1:SPR0. A slave samples SCK correctly up to F_CPU/4 only*/
+typedef enum
+{
+	SPI_F_CPU_4, SPI_F_CPU_16, SPI_F_CPU_64, SPI_F_CPU_128, SPI_F_CPU_2, SPI_F_CPU_8, SPI_F_CPU_32
+}SPI_ClockRate;
+
+/*CPOL:CPHA*/
+typedef enum
+{
+	SPI_MODE_0, SPI_MODE_1, SPI_MODE_2, SPI_MODE_3
+}SPI_ClockMode;
+
+typedef enum
+{
+	SPI_MSB_FIRST, SPI_LSB_FIRST
+}SPI_DataOrder;
+
+typedef enum
+{
+	SPI_SLAVE, SPI_MASTER
+}SPI_Role;
+
+/*Configuration Structure*/
+typedef struct{
+ SPI_Role role;
+ SPI_ClockRate clock;		/* Used by the master only */
+ SPI_ClockMode clock_mode;
+ SPI_DataOrder data_order;
+}SPI_ConfigType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Setup the SPI pins of the selected role, the clock and the data order,
+ * then enable the SPI and its interrupt.
+ */
+void SPI_init(const SPI_ConfigType *Config_Ptr);
+
+/*
+ * Description :
+ * Start a block transfer of length bytes and return immediately.
+ * tx_data may be NULL_PTR to send SPI_DUMMY_BYTE, rx_data may be NULL_PTR to
+ * drop the received bytes. The master clocks the block, a slave sends it as
+ * the master clocks. Both buffers must stay valid until the call back function.
+ * The message layer must not be used at the same time.
+ */
+void SPI_transferBlock(const uint8 *tx_data, uint8 *rx_data, uint8 length);
+
+/*
+ * Description :
+ * Return TRUE while a block transfer or a message exchange is in progress.
+ */
+boolean SPI_isBusy(void);
+
+/*
+ * Description :
+ * Set the function called from the ISR at the end of SPI_transferBlock.
+ */
+void SPI_setCallBack(void(*a_ptr)(void));
+
+/*
+ * Description :
+ * Queue one message of at most SPI_MESSAGE_MAX_LENGTH bytes.
+ * The master sends it at once, a slave sends it the next time the master
+ * clocks. Waits while the previous message has not left yet.
+ */
+void SPI_sendMessage(const uint8 *data, uint8 length);
+
+/*
+ * Description :
+ * Copy a received message and its length without blocking.
+ * Return FALSE if none has been received yet. A master with nothing to
+ * return starts a poll so the slave can send its pending message, at most
+ * once every SPI_POLL_INTERVAL_US.
+ */
+boolean SPI_receiveMessage(uint8 *data, uint8 *length);
+
+/*
+ * Description :
+ * Set the micro-second time source that paces the polls of the master.
+ * The function must return a free-running counter in us. Without one
+ * (NULL_PTR), every SPI_receiveMessage without a message polls.
+ */
+void SPI_setTimeSource(uint32(*a_ptr)(void));
+
+#endif /* SPI_H_ */
@@ -4,7 +4,8 @@
  *
  * File Name: timer.h
  *
- * Description: Header file for Timer driver
+ * Description: Header file for Timer driver: Timer0, Timer1 and Timer2.
+ *              timer_resources.h tells which function each timer serves.
  *
  * Author: Ahmed Hazem
  *
@@ -33,6 +34,35 @@ typedef struct {
  Timer1_Mode mode;
 } Timer1_ConfigType;
 
+/* Timer0 has the clock selection of Timer1 and the same modes, 8-bit */
+typedef Timer1_Prescaler Timer0_Prescaler;
+
+/* Timer2 has its own prescaler, with /32 and /128 but no external clock */
+typedef enum{
+	TIMER2_NO_CLOCK,TIMER2_F_CPU_CLOCK,TIMER2_F_CPU_8,TIMER2_F_CPU_32,TIMER2_F_CPU_64,TIMER2_F_CPU_128,TIMER2_F_CPU_256,TIMER2_F_CPU_1024
+}Timer2_Prescaler;
+
+/* OC0/OC2 pin on compare match. In the PWM modes CLEAR is non-inverted, SET inverted */
+typedef enum{
+	OC_DISCONNECTED,OC_TOGGLE,OC_CLEAR,OC_SET
+}Timer_OutputMode;
+
+typedef struct {
+ uint8 initial_value;
+ uint8 compare_value; // compare mode period or PWM duty.
+ Timer0_Prescaler prescaler;
+ Timer1_Mode mode;
+ Timer_OutputMode output;
+} Timer0_ConfigType;
+
+typedef struct {
+ uint8 initial_value;
+ uint8 compare_value; // compare mode period or PWM duty.
+ Timer2_Prescaler prescaler;
+ Timer1_Mode mode;
+ Timer_OutputMode output;
+} Timer2_ConfigType;
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
@@ -51,5 +81,65 @@ void Timer1_deInit(void);
  *  Function to set the Call Back function address.
  */
 void Timer1_setCallBack(void(*a_ptr)(void));
+/*
+ * Description :
+ * Function to read the current count of Timer1.
+ */
+uint16 Timer1_getCount(void);
+/*
+ * Description :
+ * Function returning TRUE while the compare match A interrupt is pending, e.g.
+ * when the count has been read with the interrupts disabled.
+ */
+boolean Timer1_isComparePending(void);
+
+/*
+ * Description :
+ * Function responsible for Initializing Timer0. The overflow interrupt is
+ * enabled in normal mode, the compare interrupt in compare mode, none in
+ * the PWM modes.
+ */
+void Timer0_init(const Timer0_ConfigType * Config_Ptr);
+/*
+ * Description :
+ * Function responsible to disable Timer0.
+ */
+void Timer0_deInit(void);
+/*
+ * Description :
+ *  Function to set the Call Back function address of Timer0.
+ */
+void Timer0_setCallBack(void(*a_ptr)(void));
+/*
+ * Description :
+ * Function responsible for Initializing Timer2, like Timer0.
+ */
+void Timer2_init(const Timer2_ConfigType * Config_Ptr);
+/*
+ * Description :
+ * Function responsible for Initializing Timer2 in asynchronous mode, clocked
+ * by the 32.768 kHz crystal on TOSC1/TOSC2 (PC6/PC7) instead of F_CPU. The
+ * TIMER2_F_CPU_x prescalers then divide the crystal clock. Timer2 keeps
+ * counting in power-save mode and its interrupts wake the CPU.
+ */
+void Timer2_initAsync(const Timer2_ConfigType * Config_Ptr);
+/*
+ * Description :
+ * Function waiting until the asynchronous Timer2 is in step with the CPU. To
+ * be called after a Timer2 interrupt before sleeping in power-save mode: the
+ * interrupt logic is armed again one crystal cycle (30.5 us) after the
+ * interrupt only, a shorter sleep is never woken by Timer2.
+ */
+void Timer2_waitAsyncUpdate(void);
+/*
+ * Description :
+ * Function responsible to disable Timer2.
+ */
+void Timer2_deInit(void);
+/*
+ * Description :
+ *  Function to set the Call Back function address of Timer2.
+ */
+void Timer2_setCallBack(void(*a_ptr)(void));
 
 #endif /* TIMER_H_ */
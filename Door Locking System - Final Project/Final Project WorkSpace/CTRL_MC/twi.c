@@ -2,7 +2,7 @@
  *
  * Module: TWI
  *
- * File Name: twi.h
+ * File Name: twi.c
  *
  * Description: Source file for the TWI AVR driver
  *
@@ -11,85 +11,641 @@
  *******************************************************************************/
  
 #include "twi.h"
+#include "isr_profile.h"
+#include "gpio.h"
 #include "common_macros.h"
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
 
+/* TWCR values driving the transactions from the TWI ISR, TWEA keeps the slave addressable */
+#define TWI_CONTINUE		((1<<TWINT) | (1<<TWEN) | (1<<TWIE) | g_slaveAck)
+#define TWI_CONTINUE_ACK	((1<<TWINT) | (1<<TWEN) | (1<<TWIE) | (1<<TWEA))
+#define TWI_CONTINUE_NACK	((1<<TWINT) | (1<<TWEN) | (1<<TWIE))
+
+/* Answer of the slave to a read past its register map */
+#define TWI_SLAVE_FILL		0xFF
+
+/* Time between two checks of a timeout */
+#define TWI_POLL_US			10
+
+/* Half period of the recovery clock, 100 kHz */
+#define TWI_RECOVERY_HALF_US	5
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Queued transactions, the one at g_queueTail owns the bus */
+static TWI_TransactionType *volatile g_queue[TWI_QUEUE_SIZE];
+static volatile uint8 g_queueHead = 0;
+static volatile uint8 g_queueTail = 0;
+static volatile uint8 g_queueCount = 0;
+
+/* Byte index in the write or read phase of the running transaction */
+static volatile uint8 g_index = 0;
+
+/* SCL frequency achieved by TWI_init, 0 while the TWI is disabled */
+static uint32 g_sclFrequency = 0;
+
+/* Bus time of one byte and its ACK at g_sclFrequency */
+static uint16 g_byteTimeUs = 0;
+
+/* Bus recoveries since reset */
+static uint16 g_recoveryCount = 0;
+
+/* Slave register map, TWEA is set in g_slaveAck while it is installed */
+static TWI_SlaveMapType g_slaveMap = {NULL_PTR, 0, 0, NULL_PTR};
+static volatile uint8 g_slaveAck = 0;
+static volatile boolean g_slaveActive = FALSE;		/* Addressed by another master */
+static volatile boolean g_slavePointerSet = FALSE;	/* First written byte selects the register */
+static volatile uint8 g_slaveRegister = 0;
+static volatile uint8 g_slaveFirst = 0;				/* Registers written in this transaction */
+static volatile uint8 g_slaveCount = 0;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/* TWCR value while the master is idle */
+static uint8 TWI_idleControl(void)
+{
+	return (g_slaveAck != 0) ? ((1<<TWEN) | (1<<TWIE) | (1<<TWEA)) : (1<<TWEN);
+}
+
+/* Remove the running transaction from the queue */
+static TWI_TransactionType *TWI_dequeue(void)
+{
+	TWI_TransactionType *transaction = g_queue[g_queueTail];
+
+	g_queueTail = (g_queueTail + 1) % TWI_QUEUE_SIZE;
+	g_queueCount--;
+	g_index = 0;
+	return transaction;
+}
+
+static void TWI_notify(TWI_TransactionType *transaction, TWI_ResultType result)
+{
+	transaction->result = result;
+	if(transaction->callBack != NULL_PTR)
+	{
+		(*transaction->callBack)();
+	}
+}
+
+/*
+ * Complete the running transaction. The bus is released with a stop condition,
+ * or without one after a lost arbitration, and the next transaction starts as
+ * soon as the bus is free.
+ */
+static void TWI_finish(TWI_ResultType result, boolean stop)
+{
+	TWI_TransactionType *transaction = TWI_dequeue();
+	uint8 control = (1<<TWINT) | TWI_idleControl();
+
+	if(stop)
+	{
+		control |= (1<<TWSTO);
+	}
+	if(g_queueCount != 0)
+	{
+		control |= (1<<TWSTA) | (1<<TWIE);
+	}
+	TWCR = control;
+
+	TWI_notify(transaction, result);
+}
+
+/* Timeout of a transfer of the given number of bytes, in TWI_POLL_US steps */
+static uint32 TWI_timeoutPolls(uint16 bytes)
+{
+	return (2UL * bytes * g_byteTimeUs + TWI_TIMEOUT_MARGIN_US) / TWI_POLL_US;
+}
+
+/* Open-drain GPIO: a released line is pulled high by the bus pull-up resistors */
+static void TWI_releaseLine(uint8 pin)
+{
+	GPIO_setupPinDirection(TWI_PORT_ID, pin, PIN_INPUT);
+}
+
+static void TWI_pullLineLow(uint8 pin)
+{
+	GPIO_writePin(TWI_PORT_ID, pin, LOGIC_LOW);
+	GPIO_setupPinDirection(TWI_PORT_ID, pin, PIN_OUTPUT);
+}
+
+/* Release SCL and wait while a slave stretches the clock */
+static void TWI_releaseClock(void)
+{
+	uint8 polls = TWI_TIMEOUT_MARGIN_US / TWI_POLL_US;
+
+	TWI_releaseLine(TWI_SCL_PIN_ID);
+	while(GPIO_readPin(TWI_PORT_ID, TWI_SCL_PIN_ID) == LOGIC_LOW && polls-- != 0)
+	{
+		_delay_us(TWI_POLL_US);
+	}
+	_delay_us(TWI_RECOVERY_HALF_US);
+}
+
+static boolean TWI_busIsFree(void)
+{
+	return (GPIO_readPin(TWI_PORT_ID, TWI_SCL_PIN_ID) == LOGIC_HIGH &&
+			GPIO_readPin(TWI_PORT_ID, TWI_SDA_PIN_ID) == LOGIC_HIGH);
+}
+
+/* Byte sent to the master reading the register map */
+static uint8 TWI_slaveReadByte(void)
+{
+	uint8 data = TWI_SLAVE_FILL;
+
+	if(g_slaveRegister < g_slaveMap.size)
+	{
+		data = g_slaveMap.registers[g_slaveRegister];
+	}
+	g_slaveRegister++;
+	return data;
+}
+
+/* Byte received from the master writing the register map */
+static void TWI_slaveWriteByte(uint8 data)
+{
+	if(!g_slavePointerSet)
+	{
+		g_slaveRegister = data;
+		g_slavePointerSet = TRUE;
+		return;
+	}
+	if(g_slaveRegister < g_slaveMap.size && g_slaveRegister >= g_slaveMap.first_writable)
+	{
+		g_slaveMap.registers[g_slaveRegister] = data;
+		if(g_slaveCount == 0)
+		{
+			g_slaveFirst = g_slaveRegister;
+		}
+		g_slaveCount++;
+	}
+	g_slaveRegister++;
+}
+
+/* The other master is done with us, restart a queued transaction when the bus is free */
+static void TWI_slaveEnd(void)
+{
+	uint8 control = (1<<TWINT) | TWI_idleControl();
+
+	g_slaveActive = FALSE;
+	if(g_queueCount != 0)
+	{
+		control |= (1<<TWSTA) | (1<<TWIE);
+	}
+	TWCR = control;
+}
+
+/*
+ * Slave receiver and transmitter states. Addressed while sending its own
+ * address, the master lost the arbitration: the running transaction ends
+ * with TWI_ARBITRATION_LOST.
+ */
+static void TWI_slaveEvent(uint8 status)
+{
+	TWI_TransactionType *lost = NULL_PTR;
+
+	if((status == TWI_SR_ARB_LOST_SLA_W || status == TWI_ST_ARB_LOST_SLA_R) && g_queueCount != 0)
+	{
+		lost = TWI_dequeue();
+	}
+
+	switch(status)
+	{
+	case TWI_SR_SLA_W_ACK:
+	case TWI_SR_ARB_LOST_SLA_W:
+		g_slaveActive = TRUE;
+		g_slavePointerSet = FALSE;
+		g_slaveCount = 0;
+		TWCR = TWI_CONTINUE_ACK;
+		break;
+
+	case TWI_SR_DATA_ACK:
+		TWI_slaveWriteByte(TWDR);
+		TWCR = TWI_CONTINUE_ACK;
+		break;
+
+	case TWI_SR_STOP:
+		/* Stop or repeated start: the register pointer is kept for a following read */
+		if(g_slaveCount != 0 && g_slaveMap.writeCallBack != NULL_PTR)
+		{
+			(*g_slaveMap.writeCallBack)(g_slaveFirst, g_slaveCount);
+		}
+		g_slaveCount = 0;
+		TWI_slaveEnd();
+		break;
+
+	case TWI_ST_SLA_R_ACK:
+	case TWI_ST_ARB_LOST_SLA_R:
+		g_slaveActive = TRUE;
+		TWDR = TWI_slaveReadByte();
+		TWCR = TWI_CONTINUE_ACK;
+		break;
+
+	case TWI_ST_DATA_ACK:
+		TWDR = TWI_slaveReadByte();
+		TWCR = TWI_CONTINUE_ACK;
+		break;
+
+	case TWI_SR_DATA_NACK:
+	case TWI_ST_DATA_NACK:
+	case TWI_ST_LAST_DATA:
+	default:
+		/* The other master ended the transfer */
+		TWI_slaveEnd();
+		break;
+	}
+
+	if(lost != NULL_PTR)
+	{
+		TWI_notify(lost, TWI_ARBITRATION_LOST);
+	}
+}
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+/* Next step of the bus state machine, from the interrupt */
+static void TWI_interrupt(void)
+{
+	TWI_TransactionType *transaction = g_queue[g_queueTail];
+	/* Status bits of TWSR, the prescaler bits masked */
+	uint8 status = TWSR & 0xF8;
+
+	if(status >= TWI_SR_SLA_W_ACK && status <= TWI_ST_LAST_DATA)
+	{
+		TWI_slaveEvent(status);
+		return;
+	}
+
+	if(g_queueCount == 0)
+	{
+		/* Nothing queued, leave the bus alone. A stop request recovers from a bus error */
+		TWCR = (1<<TWINT) | ((status == TWI_BUS_ERROR) ? (1<<TWSTO) : 0) | TWI_idleControl();
+		return;
+	}
+
+	switch(status)
+	{
+	case TWI_START:
+		/* Write phase first, a transaction without one starts reading */
+		g_index = 0;
+		TWDR = (uint8)((transaction->address << 1) | ((transaction->tx_length == 0 && transaction->rx_length != 0) ? 1 : 0));
+		TWCR = TWI_CONTINUE;
+		break;
+
+	case TWI_REP_START:
+		g_index = 0;
+		TWDR = (uint8)((transaction->address << 1) | 1);
+		TWCR = TWI_CONTINUE;
+		break;
+
+	case TWI_MT_SLA_W_ACK:
+	case TWI_MT_DATA_ACK:
+		if(g_index < transaction->tx_length)
+		{
+			TWDR = transaction->tx_data[g_index++];
+			TWCR = TWI_CONTINUE;
+		}
+		else if(transaction->rx_length != 0)
+		{
+			TWCR = TWI_CONTINUE | (1<<TWSTA);
+		}
+		else
+		{
+			TWI_finish(TWI_OK, TRUE);
+		}
+		break;
+
+	case TWI_MT_SLA_R_ACK:
+		/* ACK every byte but the last one */
+		TWCR = (transaction->rx_length > 1) ? TWI_CONTINUE_ACK : TWI_CONTINUE_NACK;
+		break;
+
+	case TWI_MR_DATA_ACK:
+		transaction->rx_data[g_index++] = TWDR;
+		TWCR = (g_index + 1 < transaction->rx_length) ? TWI_CONTINUE_ACK : TWI_CONTINUE_NACK;
+		break;
+
+	case TWI_MR_DATA_NACK:
+		transaction->rx_data[g_index++] = TWDR;
+		TWI_finish(TWI_OK, TRUE);
+		break;
+
+	case TWI_MT_SLA_W_NACK:
+	case TWI_MR_SLA_R_NACK:
+		TWI_finish(TWI_ADDRESS_NACK, TRUE);
+		break;
+
+	case TWI_MT_DATA_NACK:
+		TWI_finish(TWI_DATA_NACK, TRUE);
+		break;
+
+	case TWI_ARB_LOST:
+		/* Not the master any more, no stop condition */
+		TWI_finish(TWI_ARBITRATION_LOST, FALSE);
+		break;
+
+	case TWI_BUS_ERROR:
+	default:
+		/* A stop request releases the SDA and SCL lines without sending anything */
+		TWI_finish(TWI_BUS_FAULT, TRUE);
+		break;
+	}
+}
+
+ISR(TWI_vect)
+{
+	ISR_PROFILE_ENTER(ISR_PROFILE_TWI);
+	TWI_interrupt();
+	ISR_PROFILE_EXIT(ISR_PROFILE_TWI);
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Setup the slave address and the TWBR/TWPS pair giving the closest SCL frequency
+ * not above the requested one, then enable the TWI.
+ */
 void TWI_init(const TWI_ConfigType * Config_Ptr){
+	uint32 frequency = Config_Ptr->scl_frequency;
+	uint8 twps;
+
+	g_queueHead = g_queueTail = g_queueCount = 0;
+	g_slaveActive = FALSE;
+	TWI_releaseLine(TWI_SCL_PIN_ID);
+	TWI_releaseLine(TWI_SDA_PIN_ID);
+	if(frequency == 0 || !TWI_SCL_IS_POSSIBLE(frequency))
+	{
+		g_sclFrequency = 0;
+		TWCR = 0; /* disable TWI */
+		return;
+	}
 
-	TWBR = Config_Ptr->bit_Rate;
-	TWSR = Config_Ptr->prescaler;
+	twps = TWI_TWPS_FOR(frequency);
+	TWBR = (uint8)TWI_TWBR_FOR(frequency);
+	TWSR = twps;
     TWAR = (Config_Ptr->address)<<1;
-	
-    TWCR = (1<<TWEN); /* enable TWI */
+	g_sclFrequency = F_CPU / (16 + 2UL * TWBR * (1UL << (2 * twps)));
+	g_byteTimeUs = (uint16)((9 * 1000000UL + g_sclFrequency - 1) / g_sclFrequency);
+
+	/* A slave reset in the middle of a read may still hold SDA low */
+	if(!TWI_busIsFree())
+	{
+		TWI_recoverBus();
+	}
+
+    TWCR = TWI_idleControl(); /* enable TWI, and the slave if a register map is installed */
 }
 
-void TWI_start(void)
+/*
+ * Description :
+ * Return the SCL frequency achieved by TWI_init in Hz.
+ */
+uint32 TWI_getFrequency(void)
 {
-    /* 
-	 * Clear the TWINT flag before sending the start bit TWINT=1
-	 * send the start bit by TWSTA=1
-	 * Enable TWI Module TWEN=1 
-	 */
-    TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN);
-    
-    /* Wait for TWINT flag set in TWCR Register (start bit is send successfully) */
-    while(BIT_IS_CLEAR(TWCR,TWINT));
+	return g_sclFrequency;
+}
+
+/*
+ * Description :
+ * Install the register map and answer the slave address given to TWI_init.
+ */
+void TWI_setSlaveMap(const TWI_SlaveMapType *Map_Ptr)
+{
+	uint8 sreg = SREG;
+
+	cli();
+	if(Map_Ptr == NULL_PTR)
+	{
+		g_slaveMap.registers = NULL_PTR;
+		g_slaveAck = 0;
+	}
+	else
+	{
+		g_slaveMap = *Map_Ptr;
+		g_slaveAck = (1<<TWEA);
+	}
+	if(!g_slaveActive && g_queueCount == 0 && g_sclFrequency != 0)
+	{
+		TWCR = TWI_idleControl();
+	}
+	SREG = sreg;
 }
 
-void TWI_stop(void)
+/*
+ * Description :
+ * Queue a transaction, the TWI ISR runs it when the bus is free and sets its result.
+ */
+TWI_ResultType TWI_submit(TWI_TransactionType *Transaction_Ptr)
 {
-    /* 
-	 * Clear the TWINT flag before sending the stop bit TWINT=1
-	 * send the stop bit by TWSTO=1
-	 * Enable TWI Module TWEN=1 
+	uint8 sreg = SREG;
+	uint32 polls;
+
+	if(g_sclFrequency == 0)
+	{
+		/* TWI_init left the TWI disabled, TWCR must stay untouched */
+		Transaction_Ptr->result = TWI_DISABLED;
+		return TWI_DISABLED;
+	}
+
+	cli();
+	if(g_queueCount == TWI_QUEUE_SIZE)
+	{
+		SREG = sreg;
+		return TWI_QUEUE_FULL;
+	}
+
+	Transaction_Ptr->result = TWI_PENDING;
+	g_queue[g_queueHead] = Transaction_Ptr;
+	g_queueHead = (g_queueHead + 1) % TWI_QUEUE_SIZE;
+	g_queueCount++;
+
+	if(g_queueCount == 1 && !g_slaveActive && BIT_IS_CLEAR(TWCR,TWINT))
+	{
+		/*
+		 * Bus idle: let the last stop condition complete, then send the start bit.
+		 * While addressed as a slave, TWI_slaveEnd starts the transaction instead.
+		 * A stop stuck behind a held SCL is left to the transaction timeout.
+		 */
+		polls = TWI_timeoutPolls(1);
+		while(BIT_IS_SET(TWCR,TWSTO) && polls-- != 0)
+		{
+			_delay_us(TWI_POLL_US);
+		}
+		g_index = 0;
+		TWCR = TWI_CONTINUE | (1<<TWSTA);
+	}
+	SREG = sreg;
+	return TWI_PENDING;
+}
+
+/*
+ * Description :
+ * Run a transaction and wait for its result.
+ */
+TWI_ResultType TWI_transfer(uint8 address, const uint8 *tx_data, uint8 tx_length, uint8 *rx_data, uint8 rx_length)
+{
+	TWI_TransactionType transaction;
+	TWI_ResultType result;
+	uint32 polls;
+
+	transaction.address = address;
+	transaction.tx_data = tx_data;
+	transaction.tx_length = tx_length;
+	transaction.rx_data = rx_data;
+	transaction.rx_length = rx_length;
+	transaction.callBack = NULL_PTR;
+
+	/*
+	 * Wait for a free place in the queue, then for the ISR to complete it, again
+	 * after a lost arbitration. The transactions queued before this one share
+	 * its timeout, the address byte and the repeated start count as bytes.
+	 * Both waits are bounded by that timeout.
 	 */
-    TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
+	do
+	{
+		polls = TWI_timeoutPolls(TWI_QUEUE_SIZE * (tx_length + rx_length + 2U));
+		while((result = TWI_submit(&transaction)) == TWI_QUEUE_FULL)
+		{
+			/* The queue did not move for a whole transaction time */
+			if(polls-- == 0)
+			{
+				return TWI_QUEUE_FULL;
+			}
+			_delay_us(TWI_POLL_US);
+		}
+		if(result != TWI_PENDING)
+		{
+			return result;
+		}
+		polls = TWI_timeoutPolls(TWI_QUEUE_SIZE * (tx_length + rx_length + 2U));
+		while(transaction.result == TWI_PENDING)
+		{
+			if(polls-- == 0)
+			{
+				/* Only the running transaction is dropped, ours may still be queued */
+				TWI_recoverBus();
+				polls = TWI_timeoutPolls(TWI_QUEUE_SIZE * (tx_length + rx_length + 2U));
+			}
+			_delay_us(TWI_POLL_US);
+		}
+	}while(transaction.result == TWI_ARBITRATION_LOST);
+
+	return transaction.result;
 }
 
-void TWI_writeByte(uint8 data)
+/*
+ * Description :
+ * Blocking burst write of length bytes in one transaction.
+ */
+TWI_ResultType TWI_writeBuffer(uint8 address, const uint8 *data, uint8 length)
 {
-    /* Put data On TWI data Register */
-    TWDR = data;
-    /* 
-	 * Clear the TWINT flag before sending the data TWINT=1
-	 * Enable TWI Module TWEN=1 
-	 */ 
-    TWCR = (1 << TWINT) | (1 << TWEN);
-    /* Wait for TWINT flag set in TWCR Register(data is send successfully) */
-    while(BIT_IS_CLEAR(TWCR,TWINT));
+	return TWI_transfer(address, data, length, NULL_PTR, 0);
 }
 
-uint8 TWI_readByteWithACK(void)
+/*
+ * Description :
+ * Blocking burst read of length bytes in one transaction.
+ */
+TWI_ResultType TWI_readBuffer(uint8 address, uint8 *data, uint8 length)
 {
-	/* 
-	 * Clear the TWINT flag before reading the data TWINT=1
-	 * Enable sending ACK after reading or receiving data TWEA=1
-	 * Enable TWI Module TWEN=1 
-	 */ 
-    TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWEA);
-    /* Wait for TWINT flag set in TWCR Register (data received successfully) */
-    while(BIT_IS_CLEAR(TWCR,TWINT));
-    /* Read Data */
-    return TWDR;
+	return TWI_transfer(address, NULL_PTR, 0, data, length);
 }
 
-uint8 TWI_readByteWithNACK(void)
+/*
+ * Description :
+ * Write then read after a repeated start, in one transaction.
+ */
+TWI_ResultType TWI_writeThenRead(uint8 address, const uint8 *tx_data, uint8 tx_length, uint8 *rx_data, uint8 rx_length)
 {
-	/* 
-	 * Clear the TWINT flag before reading the data TWINT=1
-	 * Enable TWI Module TWEN=1 
-	 */
-    TWCR = (1 << TWINT) | (1 << TWEN);
-    /* Wait for TWINT flag set in TWCR Register (data received successfully) */
-    while(BIT_IS_CLEAR(TWCR,TWINT));
-    /* Read Data */
-    return TWDR;
+	return TWI_transfer(address, tx_data, tx_length, rx_data, rx_length);
+}
+
+/*
+ * Description :
+ * Return TRUE while queued transactions have not completed.
+ */
+boolean TWI_isBusy(void)
+{
+	return (g_queueCount != 0);
 }
 
-uint8 TWI_getStatus(void)
+/*
+ * Description :
+ * Clock SCL until the slave releases SDA, then send a stop condition from the GPIO pins.
+ */
+boolean TWI_recoverBus(void)
 {
-    uint8 status;
-    /* masking to eliminate first 3 bits and get the last 5 bits (status bits) */
-    status = TWSR & 0xF8;
-    return status;
+	TWI_TransactionType *transaction = NULL_PTR;
+	uint8 sreg = SREG;
+	uint8 clock;
+	boolean free;
+
+	/* Take the pins from the TWI and drop the running transaction */
+	cli();
+	TWCR = 0;
+	g_slaveActive = FALSE;
+	if(g_queueCount != 0)
+	{
+		transaction = TWI_dequeue();
+	}
+	g_recoveryCount++;
+	SREG = sreg;
+
+	TWI_releaseLine(TWI_SDA_PIN_ID);
+	TWI_releaseClock();
+	for(clock = 0; clock < TWI_RECOVERY_CLOCKS && GPIO_readPin(TWI_PORT_ID, TWI_SDA_PIN_ID) == LOGIC_LOW; clock++)
+	{
+		TWI_pullLineLow(TWI_SCL_PIN_ID);
+		_delay_us(TWI_RECOVERY_HALF_US);
+		TWI_releaseClock();
+	}
+
+	/* Stop condition: SDA rises while SCL is high */
+	TWI_pullLineLow(TWI_SCL_PIN_ID);
+	_delay_us(TWI_RECOVERY_HALF_US);
+	TWI_pullLineLow(TWI_SDA_PIN_ID);
+	_delay_us(TWI_RECOVERY_HALF_US);
+	TWI_releaseClock();
+	TWI_releaseLine(TWI_SDA_PIN_ID);
+	_delay_us(TWI_RECOVERY_HALF_US);
+	free = TWI_busIsFree();
+
+	/* Give the pins back to the TWI and restart the queue */
+	cli();
+	if(g_sclFrequency != 0)
+	{
+		TWCR = TWI_idleControl() | ((g_queueCount != 0) ? ((1<<TWSTA) | (1<<TWIE)) : 0);
+	}
+	SREG = sreg;
+
+	if(transaction != NULL_PTR)
+	{
+		TWI_notify(transaction, TWI_TIMEOUT);
+	}
+	return free;
+}
+
+/*
+ * Description :
+ * Return the number of bus recoveries since reset.
+ */
+uint16 TWI_getRecoveryCount(void)
+{
+	uint8 sreg = SREG;
+	uint16 count;
+
+	cli();
+	count = g_recoveryCount;
+	SREG = sreg;
+	return count;
 }
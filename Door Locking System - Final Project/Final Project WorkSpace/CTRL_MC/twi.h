@@ -8,7 +8,7 @@
  *
  * Author: Ahmed Hazem
  *
- *******************************************************************************/ 
+ *******************************************************************************/
 
 #ifndef TWI_H_
 #define TWI_H_
@@ -20,34 +20,211 @@
  *******************************************************************************/
 
 /* I2C Status Bits in the TWSR Register */
+#define TWI_BUS_ERROR     0x00 /* illegal start or stop condition on the bus */
 #define TWI_START         0x08 /* start has been sent */
 #define TWI_REP_START     0x10 /* repeated start */
 #define TWI_MT_SLA_W_ACK  0x18 /* Master transmit ( slave address + Write request ) to slave + ACK received from slave. */
-#define TWI_MT_SLA_R_ACK  0x40 /* Master transmit ( slave address + Read request ) to slave + ACK received from slave. */
+#define TWI_MT_SLA_W_NACK 0x20 /* Master transmit ( slave address + Write request ) to slave + NACK received from slave. */
 #define TWI_MT_DATA_ACK   0x28 /* Master transmit data and ACK has been received from Slave. */
+#define TWI_MT_DATA_NACK  0x30 /* Master transmit data and NACK has been received from Slave. */
+#define TWI_ARB_LOST      0x38 /* Arbitration lost in slave address or data bytes. */
+#define TWI_MT_SLA_R_ACK  0x40 /* Master transmit ( slave address + Read request ) to slave + ACK received from slave. */
+#define TWI_MR_SLA_R_NACK 0x48 /* Master transmit ( slave address + Read request ) to slave + NACK received from slave. */
 #define TWI_MR_DATA_ACK   0x50 /* Master received data and send ACK to slave. */
 #define TWI_MR_DATA_NACK  0x58 /* Master received data but doesn't send ACK to slave. */
-#define TWI_SLAVE_ADDRESS 0x1
 
-typedef enum{
-	NO_PRESCALER,PRESCALER_4,PRESCALER_16,PRESCALER_64
-}TWI_PRESCALER;
+/* Slave receiver and transmitter status */
+#define TWI_SR_SLA_W_ACK       0x60 /* Own address + Write received, ACK returned */
+#define TWI_SR_ARB_LOST_SLA_W  0x68 /* Arbitration lost as master, own address + Write received */
+#define TWI_SR_DATA_ACK        0x80 /* Data received, ACK returned */
+#define TWI_SR_DATA_NACK       0x88 /* Data received, NACK returned */
+#define TWI_SR_STOP            0xA0 /* Stop or repeated start received while addressed */
+#define TWI_ST_SLA_R_ACK       0xA8 /* Own address + Read received, ACK returned */
+#define TWI_ST_ARB_LOST_SLA_R  0xB0 /* Arbitration lost as master, own address + Read received */
+#define TWI_ST_DATA_ACK        0xB8 /* Data transmitted, ACK received */
+#define TWI_ST_DATA_NACK       0xC0 /* Data transmitted, NACK received */
+#define TWI_ST_LAST_DATA       0xC8 /* Last data transmitted, ACK received */
+
+/* 7-bit slave address, 0x00..0x07 are reserved by I2C. Give every controller on a shared bus its own one */
+#ifndef TWI_SLAVE_ADDRESS
+#define TWI_SLAVE_ADDRESS 0x20
+#endif
+
+/* TWI pins, driven as GPIO to recover a hung bus */
+#define TWI_PORT_ID       PORTC_ID
+#define TWI_SCL_PIN_ID    PIN0_ID
+#define TWI_SDA_PIN_ID    PIN1_ID
+
+/*
+ * A transaction times out after twice its bus time at the achieved SCL
+ * frequency plus this margin, which covers clock stretching
+ */
+#define TWI_TIMEOUT_MARGIN_US     1000UL
+
+/* SCL pulses sent to make a slave release SDA, one byte and its ACK */
+#define TWI_RECOVERY_CLOCKS       9
+
+/* Transactions waiting for the bus, including the running one */
+#define TWI_QUEUE_SIZE    4
+
+/* Fastest SCL frequency accepted, I2C Fast-mode */
+#define TWI_MAX_SCL_HZ    400000UL
+
+/*
+ * SCL = F_CPU / (16 + 2 * TWBR * 4^TWPS)
+ * TWBR is rounded up so the SCL never runs faster than requested, and the
+ * smallest prescaler that fits TWBR in 8 bits gives the finest resolution.
+ */
+#define TWI_DIVIDER(hz)               (((F_CPU) + (hz) - 1) / (hz))
+#define TWI_TWBR_WITH(hz, prescale)   ((TWI_DIVIDER(hz) - 16 + 2 * (prescale) - 1) / (2 * (prescale)))
+#define TWI_TWPS_FOR(hz)              ((TWI_TWBR_WITH(hz, 1UL) <= 255) ? 0 : (TWI_TWBR_WITH(hz, 4UL) <= 255) ? 1 : \
+                                       (TWI_TWBR_WITH(hz, 16UL) <= 255) ? 2 : 3)
+#define TWI_TWBR_FOR(hz)              TWI_TWBR_WITH(hz, 1UL << (2 * TWI_TWPS_FOR(hz)))
+
+/* The datasheet forbids a smaller TWBR in master mode, the SDA and SCL output may be wrong */
+#define TWI_MIN_TWBR      10UL
+
+/*
+ * An SCL frequency is possible up to Fast-mode and TWBR = TWI_MIN_TWBR with
+ * 4^0, and down to TWBR = 255 with 4^3
+ */
+#define TWI_SCL_IS_POSSIBLE(hz)       ((hz) <= TWI_MAX_SCL_HZ && TWI_DIVIDER(hz) >= 16 && \
+                                       TWI_TWBR_FOR(hz) >= TWI_MIN_TWBR && TWI_TWBR_WITH(hz, 64UL) <= 255)
+
+/* Fastest possible SCL frequency, rounded up so that TWI_TWBR_FOR gives TWI_MIN_TWBR back */
+#define TWI_MIN_DIVIDER               (16 + 2 * TWI_MIN_TWBR)
+#define TWI_FASTEST_SCL_HZ            ((((F_CPU) + TWI_MIN_DIVIDER - 1) / TWI_MIN_DIVIDER) < TWI_MAX_SCL_HZ ? \
+                                       (((F_CPU) + TWI_MIN_DIVIDER - 1) / TWI_MIN_DIVIDER) : TWI_MAX_SCL_HZ)
+
+/* Constant SCL frequency for a TWI_ConfigType, an impossible one does not compile */
+#define TWI_SCL_HZ(hz)                ((hz) + 0 * sizeof(char[TWI_SCL_IS_POSSIBLE(hz) ? 1 : -1]))
 
 typedef struct{
  uint8 address;
- uint16 bit_Rate;
- TWI_PRESCALER prescaler;
+ uint32 scl_frequency;	/* Hz, use TWI_SCL_HZ() for a constant */
 }TWI_ConfigType;
 
+/* Result of a transaction */
+typedef enum{
+	TWI_OK,
+	TWI_PENDING,			/* queued or running */
+	TWI_ADDRESS_NACK,		/* no slave answered its address */
+	TWI_DATA_NACK,			/* the slave refused a data byte */
+	TWI_ARBITRATION_LOST,	/* another master won the bus, the transaction can be submitted again */
+	TWI_BUS_FAULT,			/* illegal start or stop condition, the bus was released */
+	TWI_QUEUE_FULL,			/* not accepted, TWI_QUEUE_SIZE transactions are waiting */
+	TWI_TIMEOUT,			/* the bus hung and was recovered, the transaction can be submitted again */
+	TWI_DISABLED			/* not accepted, TWI_init rejected the SCL frequency */
+}TWI_ResultType;
+
+/*
+ * One master transaction, owned by the caller until its result is not TWI_PENDING.
+ * tx_length bytes are written, then rx_length bytes are read after a repeated
+ * start: a write, a read, or a write-then-read (register or memory address first).
+ */
+typedef struct{
+ uint8 address;					/* 7-bit slave address */
+ const uint8 *tx_data;
+ uint8 tx_length;
+ uint8 *rx_data;
+ uint8 rx_length;
+ void (*callBack)(void);		/* called from the TWI ISR at completion, may be NULL_PTR */
+ volatile TWI_ResultType result;
+}TWI_TransactionType;
+
+/*
+ * Slave register map. A master writes the register number first, then the
+ * data bytes stored from that register on; a read returns the registers from
+ * the last register number written on. Reads past the map return 0xFF.
+ */
+typedef struct{
+ volatile uint8 *registers;
+ uint8 size;
+ uint8 first_writable;					/* registers below it are read-only */
+ void (*writeCallBack)(uint8 first, uint8 count);	/* called from the TWI ISR at the end of a write, may be NULL_PTR */
+}TWI_SlaveMapType;
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
+/*
+ * Description :
+ * Setup the slave address and the TWBR/TWPS pair giving the closest SCL frequency
+ * not above the requested one, then enable the TWI.
+ * A bus found stuck low (e.g. a slave interrupted by a reset mid-read) is
+ * recovered first, see TWI_recoverBus.
+ * An impossible frequency leaves the TWI disabled and TWI_getFrequency() returns 0.
+ */
 void TWI_init(const TWI_ConfigType * Config_Ptr);
-void TWI_stop(void);
-void TWI_writeByte(uint8 data);
-uint8 TWI_readByteWithACK(void);
-uint8 TWI_readByteWithNACK(void);
-uint8 TWI_getStatus(void);
 
+/*
+ * Description :
+ * Return the SCL frequency achieved by TWI_init in Hz.
+ */
+uint32 TWI_getFrequency(void);
+
+/*
+ * Description :
+ * Install the register map and answer the slave address given to TWI_init,
+ * from the TWI ISR. Queued master transactions keep working: one that loses
+ * the arbitration is run again by TWI_transfer. NULL_PTR stops answering.
+ */
+void TWI_setSlaveMap(const TWI_SlaveMapType *Map_Ptr);
+
+/*
+ * Description :
+ * Queue a transaction, the TWI ISR runs it when the bus is free and sets its result.
+ * Return TWI_PENDING, or TWI_QUEUE_FULL or TWI_DISABLED if it was not accepted.
+ */
+TWI_ResultType TWI_submit(TWI_TransactionType *Transaction_Ptr);
+
+/*
+ * Description :
+ * Run a transaction and wait for its result, it is submitted again after a lost arbitration.
+ * A transaction still pending after its timeout recovers the bus and returns TWI_TIMEOUT.
+ * A queue still full after the same timeout returns TWI_QUEUE_FULL.
+ */
+TWI_ResultType TWI_transfer(uint8 address, const uint8 *tx_data, uint8 tx_length, uint8 *rx_data, uint8 rx_length);
+
+/*
+ * Description :
+ * Blocking burst transfers, each one a single bus transaction:
+ * start, address, the data bytes (the master ACKs every read byte but the
+ * last one), stop. The status is checked after every step and the first
+ * failure is returned, TWI_OK otherwise.
+ */
+TWI_ResultType TWI_writeBuffer(uint8 address, const uint8 *data, uint8 length);
+TWI_ResultType TWI_readBuffer(uint8 address, uint8 *data, uint8 length);
+
+/*
+ * Description :
+ * Write tx_length bytes (e.g. a register or memory address), then read
+ * rx_length bytes after a repeated start, without releasing the bus.
+ */
+TWI_ResultType TWI_writeThenRead(uint8 address, const uint8 *tx_data, uint8 tx_length, uint8 *rx_data, uint8 rx_length);
+
+/*
+ * Description :
+ * Return TRUE while queued transactions have not completed.
+ */
+boolean TWI_isBusy(void);
+
+/*
+ * Description :
+ * Free a hung bus: the running transaction ends with TWI_TIMEOUT, the TWI is
+ * disabled while SCL is clocked up to TWI_RECOVERY_CLOCKS times until the
+ * slave releases SDA, and a stop condition is sent from the GPIO pins.
+ * The TWI is then enabled again and the queued transactions restart.
+ * TWI_transfer calls it when a transaction times out, a caller of
+ * TWI_submit waiting for too long may call it as well.
+ * Return TRUE if SDA and SCL are both high afterwards.
+ */
+boolean TWI_recoverBus(void);
+
+/*
+ * Description :
+ * Return the number of bus recoveries since reset.
+ */
+uint16 TWI_getRecoveryCount(void);
 
 #endif /* TWI_H_ */
@@ -11,36 +11,31 @@
  ******************************************************************************/
 
 #include <avr/io.h>
-#include <util/delay.h>
 #include "UART.h"
+#include "spi.h"
 #include "keypad.h"
 #include "lcd.h"
-#include "timer.h"
+#include "soft_timer.h"
+#include "deadline.h"
+#include "door_link.h"
+#include "isr_profile.h"
 
 /******************************************************************************
  *                           Definitions and Variables
  ******************************************************************************/
 
 /* Password-related constants */
-#define PASSWORD_LENGTH 5
-#define PASSWORD_MATCH 1
-#define PASSWORD_UNMATCH 0
-
-/* Communication-related constants */
-#define HMI_READY_UART 0x00
-#define CONTROL_READY_UART 0xFF
+#define PASSWORD_LENGTH DOOR_PASSWORD_LENGTH
 
 /* Door-related constants */
-#define DOOR_OPEN_TIME 15
-#define DOOR_HOLD_TIME 3
-#define DOOR_CLOSE_TIME 15
-
-/* Alarm-related constants */
-#define ALARM_TIME 60
+#define STATUS_POLL_TIME 100 // period of the door status requests in ms
+#define LINK_SERVICE_TIME SOFT_TIMER_TICK_MS // period of the door link service while a response is awaited in ms
+#define STOP_KEY '-' // closes the door now during the door cycle, silences the buzzer during the alarm
 
-/* Global variables */
-uint8_t volatile g_ticks; // global variable for timer
-uint8_t Trials = 0; // global variable for incorrect password count
+/* Display-related constants, the door link is serviced during these times */
+#define KEY_RELEASE_TIME 500 // time given to release a key before reading the next one in ms
+#define MESSAGE_TIME 1000 // display time of a message in ms
+#define REPORT_TIME 2000 // display time of a service report in ms
 
 /******************************************************************************
  *                           Function Prototypes
@@ -50,7 +45,17 @@ void create_password(void); // function to create a password
 void open_door(void); // function to open the door
 void change_password(void); // function to change the password
 void activate_alarm_mode(void); // function to activate the alarm mode
-void timer_callback_function(void); // callback function for timer
+void door_progress(void); // function to follow the door cycle
+void enter_password(uint8 *password); // function to read a masked password
+void show_link_stats(void); // function to display the control unit link health counters
+void link_test(void); // function to exercise the link with status requests
+void export_log(void); // function to export and summarize the control unit event log
+void show_isr_profile(void); // function to display the interrupt execution times and latencies
+void show_isr_stats(uint8 unit, uint8 vector, const IsrProfile_StatsType *stats); // function to display the stats of one vector
+void show_task_stats(void); // function to display the scheduler stats of the control unit tasks
+void show_time(uint32 time_us); // function to display a time in us, or in ms when it is long
+void link_error(void); // function to report a request without response
+void link_wait(uint32 time_ms); // function to wait while servicing the door link
 void mainMenu();
 
 /******************************************************************************
@@ -58,20 +63,39 @@ void mainMenu();
  ******************************************************************************/
 
 int main(void) {
+#ifdef DOOR_LINK_SPI
+	/* Initialize SPI as master at F_CPU/4, the fastest clock a slave can sample */
+	SPI_ConfigType spi_config = { SPI_MASTER,
+								  SPI_F_CPU_4,
+								  SPI_MODE_0,
+								  SPI_MSB_FIRST };
+#else
 	/* Initialize UART with 8bits mode, no parity bit, 1 stop bit and 9600 baud rate */
 	UART_ConfigType uart_config = { Bits_8,
 									DISABLED,
 									ONE_BIT,
 									9600 };
-	/* Initialize Timer1 with 0 initial value, 23437 compare value, prescalar of 1024 and CTC mode */
-	Timer1_ConfigType g_timer1_config = { 0,
-										  23437,
-										  F_CPU_1024,
-										  COMPARE_MODE };
+#endif
+#ifdef DOOR_LINK_SPI
+	SPI_init(&spi_config);
+#else
 	UART_init(&uart_config);
-	Timer1_init(&g_timer1_config);
-	Timer1_setCallBack(&timer_callback_function);
+	/* The max RX latency of the link stats in us */
+	UART_setTimeSource(&SoftTimer_micros);
+#endif
+	SoftTimer_init();
+#ifdef DOOR_LINK_SPI
+	/* The idle polls of the slave are paced on the micro-second count */
+	SPI_setTimeSource(&SoftTimer_micros);
+#endif
+#ifdef ISR_PROFILE
+	/* Time the ISRs on the free-running soft timer count */
+	IsrProfile_init(&Timer1_getCount, SOFT_TIMER_COMPARE_VALUE, SOFT_TIMER_US_PER_COUNT);
+#endif
 	LCD_init();
+	DoorLink_init();
+	/* Requests without response are resent, then given up */
+	DoorLink_setTimeSource(&SoftTimer_millis);
 	SREG |= (1 << 7);
 
 	/* Creating a password */
@@ -88,99 +112,95 @@ int main(void) {
  ******************************************************************************/
 
 /*
- * Function: create_password
+ * Function: enter_password
  * -------------------------
- * Prompts the user to enter a new password twice and checks if the two entries
- * match. If the entries match, sends the new password to the control unit and
- * displays a message indicating that the password has been created. If the
- * entries do not match, displays an error message and allows the user to try
- * again.
+ * Reads PASSWORD_LENGTH digits from the keypad, displaying an asterisk for
+ * each of them, then waits for the '=' key.
  *
- * Parameters: None
+ * Parameters: uint8*
  *
  * Returns: None
  */
-void create_password(void) {
-	uint8 firstPassword[PASSWORD_LENGTH + 2];
-	uint8 secondPassword[PASSWORD_LENGTH + 2];
-	uint8 matchCheck;
-	uint8 i = 0;
+void enter_password(uint8 *password) {
+	uint8 i;
 	uint8 keyPressed;
-	/* Prompting the user to enter a new password */
-	LCD_clearScreen();
-	LCD_displayString("Enter Password:");
-	LCD_moveCursor(1, 0);
-
-	for (i = 0; i < PASSWORD_LENGTH; i++) {
-		/* Getting the user input */
-		keyPressed = KEYPAD_getPressedKey();
-		/* Displaying an asterisk to mask the password */
-		if (keyPressed >= 0 && keyPressed <= 9) {
-			LCD_displayString("*");
-			firstPassword[i] = keyPressed;
-			_delay_ms(500);
-		}
-	}
-	firstPassword[PASSWORD_LENGTH] = '#';
-	firstPassword[PASSWORD_LENGTH + 1] = '\0';
-	while (KEYPAD_getPressedKey() != '=');
 
-	LCD_clearScreen();
-	_delay_ms(500);
-	/* Prompting the user to re-enter the new password */
-	LCD_displayString("Re-Enter Pass:");
-	LCD_moveCursor(1, 0);
-	/* Getting the user input */
 	for (i = 0; i < PASSWORD_LENGTH;) {
+		/* Getting the user input */
 		keyPressed = KEYPAD_getPressedKey();
-		if (keyPressed >= 0 && keyPressed <= 9) {
+		if (keyPressed <= 9) {
 			/* Displaying an asterisk to mask the password */
 			LCD_displayString("*");
-			secondPassword[i] = keyPressed;
-			_delay_ms(500);
+			password[i] = keyPressed;
+			link_wait(KEY_RELEASE_TIME);
 			i++;
 		}
 	}
-	secondPassword[PASSWORD_LENGTH] = '#';
-	secondPassword[PASSWORD_LENGTH + 1] = '\0';
 	while (KEYPAD_getPressedKey() != '=');
+}
 
-	while (UART_receiveByte() != CONTROL_READY_UART);/* waiting for a ready signal from the control unit */
-	UART_sendString(firstPassword);
-	while (UART_receiveByte() != CONTROL_READY_UART);/* waiting for a ready signal from the control unit */
-	UART_sendString(secondPassword);
-	LCD_clearScreen();
-	_delay_ms(1000);
-
-	UART_sendByte(HMI_READY_UART);	/* sending a ready signal to the control unit */
-
-	matchCheck = UART_receiveByte();
+/*
+ * Function: create_password
+ * -------------------------
+ * Prompts the user to enter a new password twice and sends both entries to
+ * the control unit which checks that they match. If the entries match, the
+ * control unit saves the password and a message indicating that the password
+ * has been created is displayed. If the entries do not match, displays an
+ * error message and allows the user to try again. If the control unit denies
+ * the creation, it already holds a password (the HMI was reset while it kept
+ * running): that password is kept and the main menu is displayed, changing
+ * it needs the old password.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void create_password(void) {
+	uint8 passwords[2 * PASSWORD_LENGTH];
+	DoorLink_FrameType response;
 
-	if (matchCheck) {
-		/* Displaying a message to indicate that the password has been created */
+	do {
+		/* Prompting the user to enter a new password */
 		LCD_clearScreen();
-		LCD_displayString("Pass Created");
-		_delay_ms(1000);
-
-	}
+		LCD_displayString("Enter Password:");
+		LCD_moveCursor(1, 0);
+		enter_password(&passwords[0]);
 
-	else {
-		/* Displaying an error message and prompting the user to enter the password again */
 		LCD_clearScreen();
-		LCD_displayString("Not matched");
-		_delay_ms(1000);
-		create_password();
-	}
+		link_wait(KEY_RELEASE_TIME);
+		/* Prompting the user to re-enter the new password */
+		LCD_displayString("Re-Enter Pass:");
+		LCD_moveCursor(1, 0);
+		enter_password(&passwords[PASSWORD_LENGTH]);
+
+		if (DoorLink_transact(DOOR_CMD_SET_PASSWORD, passwords, sizeof(passwords), &response) != DOOR_LINK_OK) {
+			link_error();
+			return;
+		}
 
+		LCD_clearScreen();
+		if (response.code == DOOR_STATUS_OK) {
+			/* Displaying a message to indicate that the password has been created */
+			LCD_displayString("Pass Created");
+		} else if (response.code == DOOR_STATUS_DENIED) {
+			/* The control unit keeps its password */
+			LCD_displayString("Pass Exists");
+		} else {
+			/* Displaying an error message and prompting the user to enter the password again */
+			LCD_displayString("Not matched");
+		}
+		link_wait(MESSAGE_TIME);
+	} while (response.code != DOOR_STATUS_OK && response.code != DOOR_STATUS_DENIED);
 }
 
 /*
  * Function: open_door
  * -------------------
- * Prompts the user to enter a password and checks if it matches the stored
- * password. If the password is correct, opens the door. If the password is
- * not correct, displays an error message and allows the user to try again
- * up to three times before activating the alarm mode.
+ * Prompts the user to enter a password and sends it to the control unit. If
+ * the password is correct, the control unit opens the door and the door cycle
+ * is followed on the LCD. If the password is not correct, displays an error
+ * message and allows the user to try again until the control unit activates
+ * the alarm mode.
  *
  * Parameters: None
  *
@@ -188,82 +208,143 @@ void create_password(void) {
  */
 
 void open_door(void) {
-	uint8 password[PASSWORD_LENGTH + 2];
-	uint8 matchCheck;
-	uint8 i;
-	uint8 keyPressed;
+	uint8 password[PASSWORD_LENGTH];
+	DoorLink_FrameType response;
 
-	/* Prompting the user to enter a new password */
+	/* Prompting the user to enter the password */
 	LCD_clearScreen();
 	LCD_displayString("Enter Password:");
 	LCD_moveCursor(1, 0);
-	for (i = 0; i < PASSWORD_LENGTH;) {
-		keyPressed = KEYPAD_getPressedKey();
-		if (keyPressed >= 0 && keyPressed <= 9) {
-			/* Displaying an asterisk to mask the password */
-			LCD_displayString("*");
-			password[i] = keyPressed;
-			_delay_ms(500);
-			i++;
-		}
-	}
-	password[PASSWORD_LENGTH] = '#';
-	password[PASSWORD_LENGTH + 1] = '\0';
-	while (KEYPAD_getPressedKey() != '=');
+	enter_password(password);
 
-	UART_sendByte(HMI_READY_UART);	/* sending a ready signal to the control unit */
-	while (UART_receiveByte() != CONTROL_READY_UART);/* waiting for a ready signal from the control unit */
+	if (DoorLink_transact(DOOR_CMD_OPEN, password, PASSWORD_LENGTH, &response) != DOOR_LINK_OK) {
+		link_error();
+		return;
+	}
 
-	UART_sendString(password); /* sending the password to the control unit */
+	if (response.code == DOOR_STATUS_OK) {
+		door_progress();
+	}
 
-	UART_sendByte(HMI_READY_UART);	/* sending a ready signal to the control unit */
-	while (UART_receiveByte() != CONTROL_READY_UART);/* waiting for a ready signal from the control unit */
+	else if (response.code == DOOR_STATUS_ALARM) {
+		activate_alarm_mode(); /* the maximum number of trials has been reached */
+	}
 
-	matchCheck = UART_receiveByte(); /* receiving the result of the password match check from the control unit */
+	else if (response.code == DOOR_STATUS_BUSY) {
+		LCD_clearScreen();
+		LCD_displayString("Door Busy");
+		link_wait(MESSAGE_TIME);
+	}
 
-		if (matchCheck) {
-			Trials = 0;
-			/* Open the door for 15 Secs */
-			g_ticks = 0;
-			LCD_clearScreen();
-			LCD_displayString("Door Opening");
-			while (g_ticks < DOOR_OPEN_TIME/3);	/* waiting for the door opening time */
-			/* Hold the door for 3 Secs */
-			g_ticks = 0;
-			LCD_clearScreen();
-			LCD_displayString("Door Open");
-			while (g_ticks < DOOR_HOLD_TIME/3);	/* waiting for the door hold time */
-			/* Close the door for 15 Secs */
-			g_ticks = 0;
-			LCD_clearScreen();
-			LCD_displayString("Door Closing");
-			while (g_ticks < DOOR_CLOSE_TIME/3); /* waiting for the door closing time */
-		}
+	else {
+		LCD_clearScreen();
+		LCD_displayString("Pass Incorrect");
+		link_wait(MESSAGE_TIME);
 
-		else {
-			LCD_clearScreen();
-			LCD_displayString("Pass Incorrect");
+		open_door(); /* allowing the user to try again */
+	}
+}
 
-			_delay_ms(1000);
+/*
+ * Function: door_progress
+ * -------------------
+ * Follows the door cycle running on the control unit. Status requests are
+ * sent every STATUS_POLL_TIME without waiting for the previous responses, up
+ * to DOOR_LINK_MAX_OUTSTANDING of them, and each response is matched by its
+ * sequence number. Until the door closes, STOP_KEY sends an abort request
+ * down the same pipeline and the control unit closes the door at once.
+ * Returns when the control unit reports the door idle, or after a link error.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void door_progress(void) {
+	uint8 pending[DOOR_LINK_MAX_OUTSTANDING];
+	uint8 count = 0;
+	uint8 i;
+	Door_StateType displayed = DOOR_OPENING;
+	boolean closeRequested = FALSE;
+	Deadline_Type poll;
+	DoorLink_FrameType response;
+	DoorLink_ResultType result;
 
-			Trials++;
+	LCD_clearScreen();
+	LCD_displayString("Door Opening");
+	LCD_displayStringRowColumn(1, 0, "- : Close Now");
+
+	/* The first status request is sent at once */
+	Deadline_start(&poll, 0);
+	while (displayed != DOOR_IDLE) {
+		/* Keep one more status request in flight every STATUS_POLL_TIME */
+		if (Deadline_isExpired(&poll)) {
+			Deadline_start(&poll, STATUS_POLL_TIME);
+			if (count < DOOR_LINK_MAX_OUTSTANDING) {
+				pending[count] = DoorLink_request(DOOR_CMD_STATUS, NULL_PTR, 0);
+				if (pending[count] != DOOR_LINK_NO_SEQ)
+					count++;
+			}
+		}
 
-			if (Trials == 3)
-				activate_alarm_mode(); /* activating the alarm mode if the maximum number of trials has been reached */
+		/*
+		 * Sleep until the next status request, or the next link service, then
+		 * scan the keypad: a key press lasts longer than STATUS_POLL_TIME
+		 */
+		if (count == 0)
+			Deadline_wait(&poll, NULL_PTR);
+		else
+			Deadline_delay(LINK_SERVICE_TIME, NULL_PTR);
+
+		/* Close the door now, its response carries no door state */
+		if (!closeRequested && displayed != DOOR_CLOSING && count < DOOR_LINK_MAX_OUTSTANDING &&
+			KEYPAD_scanKey() == STOP_KEY) {
+			pending[count] = DoorLink_request(DOOR_CMD_ABORT, NULL_PTR, 0);
+			if (pending[count] != DOOR_LINK_NO_SEQ) {
+				count++;
+				closeRequested = TRUE;
+			}
+		}
 
-			else
-				open_door(); /* allowing the user to try again if the maximum number of trials has not been reached */
+		/* Collect the responses as they arrive, in any order */
+		for (i = 0; i < count;) {
+			result = DoorLink_getResponse(pending[i], &response);
+			if (result == DOOR_LINK_TIMEOUT) {
+				/* The other requests in flight free their slots by themselves */
+				link_error();
+				return;
+			} else if (result == DOOR_LINK_OK) {
+				pending[i] = pending[--count];
+				if (response.length >= 1 && response.payload[0] != displayed) {
+					displayed = response.payload[0];
+					LCD_clearScreen();
+					if (displayed == DOOR_HOLD)
+						LCD_displayString("Door Open");
+					else if (displayed == DOOR_CLOSING)
+						LCD_displayString("Door Closing");
+					if (displayed == DOOR_HOLD && !closeRequested)
+						LCD_displayStringRowColumn(1, 0, "- : Close Now");
+				}
+			} else {
+				i++;
+			}
 		}
 	}
 
+	/* Collect the responses still in flight, answered or given up */
+	while (count != 0) {
+		if (DoorLink_getResponse(pending[count - 1], &response) != DOOR_LINK_PENDING)
+			count--;
+	}
+}
+
 /*
  * Function: change_password
  * ------------------------
- * Prompts the user to enter their old password and checks if it matches the
- * stored password. If the old password is correct, prompts the user to enter a
- * new password and sends it to the control unit. If the old password is not
- * correct, displays an error message and allows the user to try again up to
- * three times before activating the alarm mode.
+ * Prompts the user to enter their old password and sends it to the control
+ * unit. If the old password is correct, prompts the user to create a new
+ * password. If the old password is not correct, displays an error message
+ * and allows the user to try again until the control unit activates the
+ * alarm mode.
  *
  * Parameters: None
  *
@@ -271,103 +352,86 @@ void open_door(void) {
  */
 void change_password(void) {
 
-	uint8 oldPassword[PASSWORD_LENGTH + 2];
-	uint8 matchCheck;
-	uint8 i;
-	uint8 keyPressed;
+	uint8 oldPassword[PASSWORD_LENGTH];
+	DoorLink_FrameType response;
 
 	LCD_clearScreen();
 	LCD_displayString("Enter Old Pass"); /* prompting the user to enter the old password */
 	LCD_moveCursor(1, 0);
+	enter_password(oldPassword);
 
-	for (i = 0; i < PASSWORD_LENGTH;) {
-		keyPressed = KEYPAD_getPressedKey(); /* getting the key pressed by the user */
-		if (keyPressed >= 0 && keyPressed <= 9) {
-			LCD_displayString("*"); /* displaying an asterisk to mask the password */
-			oldPassword[i] = keyPressed;
-			_delay_ms(500);
-			i++;
-		}
+	if (DoorLink_transact(DOOR_CMD_VERIFY_PASSWORD, oldPassword, PASSWORD_LENGTH, &response) != DOOR_LINK_OK) {
+		link_error();
+		return;
 	}
 
-	oldPassword[PASSWORD_LENGTH] = '#';
-	oldPassword[PASSWORD_LENGTH + 1] = '\0';
-	while (KEYPAD_getPressedKey() != '=');
-
-	UART_sendByte(HMI_READY_UART); /* sending a ready signal to the control unit */
-	while (UART_receiveByte() != CONTROL_READY_UART); /* waiting for a ready signal from the control unit */
-
-	UART_sendString(oldPassword); /* sending the old password to the control unit */
-
-	UART_sendByte(HMI_READY_UART); /* sending a ready signal to the control unit */
-	while (UART_receiveByte() != CONTROL_READY_UART); /* waiting for a ready signal from the control unit */
-
-	matchCheck = UART_receiveByte(); /* receiving the result of the password match check from the control unit */
-
-	if (matchCheck) {
+	if (response.code == DOOR_STATUS_OK) {
 		LCD_clearScreen();
 		LCD_displayString("Pass Correct");
-		_delay_ms(1000);
+		link_wait(MESSAGE_TIME);
 
 		create_password(); /* prompting the user to create a new password */
 	}
 
+	else if (response.code == DOOR_STATUS_ALARM) {
+		activate_alarm_mode(); /* the maximum number of trials has been reached */
+	}
+
 	else {
 		LCD_clearScreen();
 		LCD_displayString("Pass Incorrect");
-		_delay_ms(1000);
+		link_wait(MESSAGE_TIME);
 
-		Trials++; /* incrementing the number of password change trials */
-
-		if (Trials == 3)
-			activate_alarm_mode(); /* activating the alarm mode if the maximum number of trials has been reached */
-
-		else
-			change_password(); /* allowing the user to try again if the maximum number of trials has not been reached */
+		change_password(); /* allowing the user to try again */
 	}
 }
 /*
  * Function: activate_alarm_mode
  * -----------------------------
- * Activates the alarm mode by displaying a message on the LCD screen and sending
- * a signal to the control unit to activate the alarm. After a specified delay,
- * sends a signal to the control unit to deactivate the alarm and resets the
- * incorrect password count.
+ * Displays the alarm message on the LCD screen while the control unit runs
+ * the alarm. STOP_KEY acknowledges the alarm: the control unit silences the
+ * buzzer, the lockout keeps running. The control unit is polled every
+ * MESSAGE_TIME until it ends the alarm, then the main menu is displayed again.
  *
  * Parameters: None
  *
  * Returns: None
  */
 void activate_alarm_mode(void) {
+	boolean alarmActive = TRUE;
+	boolean silenced = FALSE;
+	Deadline_Type poll;
+	DoorLink_FrameType response;
+
 	/* Displaying a message to indicate that the alarm has been activated */
 	LCD_clearScreen();
 	LCD_displayString("ALARM ACTIVATED!");
-	_delay_ms(ALARM_TIME);
-
-	/* Sending a ready signal to the control unit */
-	UART_sendByte(HMI_READY_UART);
-	while (UART_receiveByte() != CONTROL_READY_UART);
-
-	/* Sending a signal to the control unit to deactivate the alarm */
-	UART_sendByte(0xAA);
+	LCD_displayStringRowColumn(1, 0, "- : Silence");
+
+	Deadline_start(&poll, MESSAGE_TIME);
+	while (alarmActive) {
+		/* Sleep until the next tick, then scan the keypad */
+		Deadline_delay(LINK_SERVICE_TIME, NULL_PTR);
+		if (!silenced && KEYPAD_scanKey() == STOP_KEY) {
+			if (DoorLink_transact(DOOR_CMD_ALARM_ACK, NULL_PTR, 0, &response) != DOOR_LINK_OK) {
+				link_error();
+				return;
+			}
+			silenced = TRUE;
+			LCD_displayStringRowColumn(1, 0, "Buzzer Off ");
+		}
 
-	/* Resetting the incorrect password count */
-	Trials = 0;
+		if (Deadline_isExpired(&poll)) {
+			Deadline_start(&poll, MESSAGE_TIME);
+			if (DoorLink_transact(DOOR_CMD_STATUS, NULL_PTR, 0, &response) != DOOR_LINK_OK) {
+				link_error();
+				return;
+			}
+			alarmActive = (response.length >= 2 && response.payload[1] == TRUE);
+		}
+	}
 }
 
-/*
- * Function: timer_callback_function
- * ----------------------------------
- * A callback function that increments a global variable `g_ticks` by one every time
- * it is called. This function is used as a timer in the system.
- *
- * Parameters: None
- *
- * Returns: None
- */
-void timer_callback_function(void) {
-	g_ticks++;
-}
 /*
  * Function: mainMenu
  * ----------------------------------
@@ -389,14 +453,6 @@ void mainMenu(){
 			/* Getting the user input */
 			key_pressed = KEYPAD_getPressedKey();
 
-			/* Sending a ready signal to the control unit */
-			UART_sendByte(HMI_READY_UART);
-			while (UART_receiveByte() != CONTROL_READY_UART)
-				;
-
-			/* Sending the user input to the control unit */
-			UART_sendByte(key_pressed);
-
 			/* Handling the user input */
 			if (key_pressed == '+') {
 				LCD_clearScreen();
@@ -404,5 +460,380 @@ void mainMenu(){
 			} else if (key_pressed == '-') {
 				LCD_clearScreen();
 				change_password();
+			} else if (key_pressed == '*') {
+				/* Service key: link health of the control unit */
+				LCD_clearScreen();
+				show_link_stats();
+			} else if (key_pressed == '%') {
+				/* Service key: link round trip and throughput */
+				LCD_clearScreen();
+				link_test();
+			} else if (key_pressed == 13) {
+				/* Service key: access event log of the control unit */
+				LCD_clearScreen();
+				export_log();
+			} else if (key_pressed == '=') {
+				/* Service key: interrupt execution times and latencies */
+				LCD_clearScreen();
+				show_isr_profile();
+			} else if (key_pressed == 0) {
+				/* Service key: task execution times, jitter and deadline misses */
+				LCD_clearScreen();
+				show_task_stats();
+			}
+}
+/*
+ * Function: link_error
+ * ----------------------------------
+ * Reports a request given up by the door link after its resends: the control
+ * unit is not answering or the line drops every frame. The caller then goes
+ * back to the main menu.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void link_error(void) {
+	LCD_clearScreen();
+	LCD_displayString("Link Error");
+	link_wait(MESSAGE_TIME);
+}
+/*
+ * Function: link_wait
+ * ----------------------------------
+ * Waits for time_ms, the hold of a message or a report. While requests are
+ * waiting for their response the door link is serviced every
+ * LINK_SERVICE_TIME: the responses are received and the late requests
+ * resent. The CPU sleeps in between and for the rest of the time.
+ *
+ * Parameters: uint32
+ *
+ * Returns: None
+ */
+void link_wait(uint32 time_ms) {
+	Deadline_Type deadline;
+
+	Deadline_start(&deadline, time_ms);
+	while (DoorLink_outstanding() != 0 && !Deadline_isExpired(&deadline)) {
+		DoorLink_poll();
+		Deadline_delay(LINK_SERVICE_TIME, NULL_PTR);
+	}
+	Deadline_wait(&deadline, NULL_PTR);
+}
+/*
+ * Function: show_link_stats
+ * ----------------------------------
+ * Requests the UART link health counters of the control unit and displays the
+ * framing, overrun and parity error counts, the number of bytes dropped on a
+ * full receive buffer and the receive buffer high-water mark. The SPI build
+ * of the control unit has no such counters and answers DOOR_STATUS_UNKNOWN.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void show_link_stats(void) {
+	UART_StatsType stats;
+	DoorLink_FrameType response;
+
+	if (DoorLink_transact(DOOR_CMD_LINK_STATS, NULL_PTR, 0, &response) != DOOR_LINK_OK) {
+		link_error();
+		return;
+	}
+	if (response.code != DOOR_STATUS_OK || response.length != DOOR_LINK_STATS_LENGTH) {
+		/* No UART counters on this link (SPI build) */
+		LCD_displayString("No Link Stats");
+		link_wait(MESSAGE_TIME);
+		return;
+	}
+	DoorLink_unpackStats(response.payload, &stats);
+
+	LCD_displayString("FE:");
+	LCD_intgerToString(stats.framing_errors);
+	LCD_displayString(" OR:");
+	LCD_intgerToString(stats.overrun_errors);
+	LCD_displayString(" PE:");
+	LCD_intgerToString(stats.parity_errors);
+	LCD_moveCursor(1, 0);
+	LCD_displayString("OVF:");
+	LCD_intgerToString(stats.rx_buffer_overflows);
+	LCD_displayString(" HW:");
+	LCD_intgerToString(stats.rx_high_water);
+	link_wait(REPORT_TIME);
+}
+/*
+ * Function: link_test
+ * ----------------------------------
+ * Exchanges DOOR_LINK_TEST_MESSAGES status requests with the control unit one
+ * at a time, which measures the round trip, then the same number with
+ * DOOR_LINK_MAX_OUTSTANDING of them in flight, which measures the throughput.
+ * The end of each phase is shown on the LCD so it can be timed.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void link_test(void) {
+	uint8 pending[DOOR_LINK_MAX_OUTSTANDING];
+	uint8 count = 0;
+	uint8 sent = 0;
+	uint8 i;
+	DoorLink_FrameType response;
+	DoorLink_ResultType result;
+
+	LCD_displayString("Link Test");
+
+	for (i = 0; i < DOOR_LINK_TEST_MESSAGES; i++) {
+		if (DoorLink_transact(DOOR_CMD_STATUS, NULL_PTR, 0, &response) != DOOR_LINK_OK) {
+			link_error();
+			return;
+		}
+	}
+	LCD_displayStringRowColumn(1, 0, "Ping Done");
+
+	while (sent < DOOR_LINK_TEST_MESSAGES || count != 0) {
+		if (sent < DOOR_LINK_TEST_MESSAGES && count < DOOR_LINK_MAX_OUTSTANDING) {
+			pending[count] = DoorLink_request(DOOR_CMD_STATUS, NULL_PTR, 0);
+			if (pending[count] != DOOR_LINK_NO_SEQ) {
+				count++;
+				sent++;
 			}
+		}
+		for (i = 0; i < count;) {
+			result = DoorLink_getResponse(pending[i], &response);
+			if (result == DOOR_LINK_TIMEOUT) {
+				link_error();
+				return;
+			} else if (result == DOOR_LINK_OK)
+				pending[i] = pending[--count];
+			else
+				i++;
+		}
+	}
+	LCD_displayStringRowColumn(1, 0, "Burst Done");
+	link_wait(MESSAGE_TIME);
+}
+/*
+ * Function: export_log
+ * ----------------------------------
+ * Reads the whole event log of the control unit, DOOR_LOG_RECORDS_PER_FRAME
+ * records per request with DOOR_LINK_MAX_OUTSTANDING requests in flight, and
+ * displays the number of records, door openings, wrong passwords and alarms.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void export_log(void) {
+	uint8 pending[DOOR_LINK_MAX_OUTSTANDING];
+	uint8 count = 0;
+	uint16 total;
+	uint16 next;
+	uint16 opens = 0, wrong = 0, alarms = 0;
+	uint8 first[2] = { 0, 0 };
+	uint8 i, j;
+	DoorLink_FrameType response;
+	DoorLink_ResultType result;
+
+	LCD_displayString("Log Export");
+
+	/* The first response gives the number of records */
+	if (DoorLink_transact(DOOR_CMD_LOG_READ, first, 2, &response) != DOOR_LINK_OK) {
+		link_error();
+		return;
+	}
+	if (response.code != DOOR_STATUS_OK || response.length < 2)
+		return;
+	total = response.payload[0] | ((uint16) response.payload[1] << 8);
+	next = 0;
+
+	while (1) {
+		/* Count the events of the records received */
+		for (j = 2; j + DOOR_LOG_RECORD_SIZE <= response.length; j += DOOR_LOG_RECORD_SIZE) {
+			switch (response.payload[j + 2] & DOOR_LOG_EVENT_MASK) {
+			case DOOR_EVENT_OPEN: opens++; break;
+			case DOOR_EVENT_WRONG_PASSWORD: wrong++; break;
+			case DOOR_EVENT_ALARM: alarms++; break;
+			}
+		}
+
+		/* Keep DOOR_LINK_MAX_OUTSTANDING requests in flight */
+		while (next + DOOR_LOG_RECORDS_PER_FRAME < total && count < DOOR_LINK_MAX_OUTSTANDING) {
+			next += DOOR_LOG_RECORDS_PER_FRAME;
+			first[0] = (uint8) next;
+			first[1] = (uint8) (next >> 8);
+			pending[count] = DoorLink_request(DOOR_CMD_LOG_READ, first, 2);
+			if (pending[count] == DOOR_LINK_NO_SEQ) {
+				next -= DOOR_LOG_RECORDS_PER_FRAME;
+				break;
+			}
+			count++;
+		}
+		if (count == 0)
+			break;
+
+		/* Wait for any of them */
+		for (i = 0; (result = DoorLink_getResponse(pending[i], &response)) == DOOR_LINK_PENDING; i = (i + 1) % count)
+			;
+		if (result == DOOR_LINK_TIMEOUT) {
+			link_error();
+			return;
+		}
+		pending[i] = pending[--count];
+	}
+
+	LCD_clearScreen();
+	LCD_displayString("Events:");
+	LCD_intgerToString(total);
+	LCD_moveCursor(1, 0);
+	LCD_displayString("O:");
+	LCD_intgerToString(opens);
+	LCD_displayString(" W:");
+	LCD_intgerToString(wrong);
+	LCD_displayString(" A:");
+	LCD_intgerToString(alarms);
+	link_wait(REPORT_TIME);
+}
+/*
+ * Function: show_isr_profile
+ * ----------------------------------
+ * Displays, for each interrupt vector that ran, the execution time and entry
+ * latency stats of the control unit ('C'), then those of this unit ('H').
+ * The control unit answers DOOR_STATUS_UNKNOWN in a build without
+ * ISR_PROFILE, and this unit only has stats in a build with it.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void show_isr_profile(void) {
+	IsrProfile_StatsType stats;
+	DoorLink_FrameType response;
+	uint8 vector;
+
+	for (vector = 0; vector < ISR_PROFILE_VECTORS; vector++) {
+		if (DoorLink_transact(DOOR_CMD_ISR_PROFILE, &vector, 1, &response) != DOOR_LINK_OK) {
+			link_error();
+			return;
+		}
+		if (response.code == DOOR_STATUS_OK && response.length == DOOR_ISR_PROFILE_LENGTH) {
+			DoorLink_unpackIsrStats(response.payload, &stats);
+			show_isr_stats('C', vector, &stats);
+		}
+	}
+#ifdef ISR_PROFILE
+	for (vector = 0; vector < ISR_PROFILE_VECTORS; vector++) {
+		IsrProfile_getStats(vector, &stats);
+		show_isr_stats('H', vector, &stats);
+	}
+#endif
+}
+/*
+ * Function: show_isr_stats
+ * ----------------------------------
+ * Displays the name of a vector that ran with its execution time in us on the
+ * first row, min/avg/max, and its latency in us on the second row, or its
+ * number of runs when its request time is unknown.
+ *
+ * Parameters: uint8,uint8,IsrProfile_StatsType*
+ *
+ * Returns: None
+ */
+void show_isr_stats(uint8 unit, uint8 vector, const IsrProfile_StatsType *stats) {
+	static const char *const names[ISR_PROFILE_VECTORS] = { "T1CMPA", "T1OVF",
+			"T1CAPT", "T0CMP", "T0OVF", "T2CMP", "T2OVF", "RXC", "UDRE", "SPI",
+			"TWI", "ADC" };
+
+	if (stats->runs == 0)
+		return;
+
+	LCD_clearScreen();
+	LCD_displayCharacter(unit);
+	LCD_displayCharacter(' ');
+	LCD_displayString(names[vector]);
+	LCD_displayCharacter(' ');
+	LCD_intgerToString(stats->time_min_us);
+	LCD_displayCharacter('/');
+	LCD_intgerToString(stats->time_total_us / stats->runs);
+	LCD_displayCharacter('/');
+	LCD_intgerToString(stats->time_max_us);
+	LCD_moveCursor(1, 0);
+	if (stats->latency_runs != 0) {
+		LCD_displayString("Lat ");
+		LCD_intgerToString(stats->latency_min_us);
+		LCD_displayCharacter('/');
+		LCD_intgerToString(stats->latency_total_us / stats->latency_runs);
+		LCD_displayCharacter('/');
+		LCD_intgerToString(stats->latency_max_us);
+	} else if (stats->runs < 10000) {
+		LCD_displayString("Runs ");
+		LCD_intgerToString(stats->runs);
+	} else {
+		/* In thousands, the LCD shows an int */
+		LCD_displayString("Runs ");
+		LCD_intgerToString(stats->runs / 1000);
+		LCD_displayCharacter('k');
+	}
+	link_wait(REPORT_TIME);
+}
+/*
+ * Function: show_task_stats
+ * ----------------------------------
+ * Displays, for each task of the control unit scheduler that ran, its index
+ * with its execution time on the first row, average/max, and its max release
+ * jitter with its deadline misses on the second row. The control unit
+ * answers DOOR_STATUS_UNKNOWN past its last task.
+ *
+ * Parameters: None
+ *
+ * Returns: None
+ */
+void show_task_stats(void) {
+	DoorLink_TaskStatsType stats;
+	DoorLink_FrameType response;
+	uint8 task = 0;
+
+	while (1) {
+		if (DoorLink_transact(DOOR_CMD_TASK_STATS, &task, 1, &response) != DOOR_LINK_OK) {
+			link_error();
+			return;
+		}
+		if (response.code != DOOR_STATUS_OK || response.length != DOOR_TASK_STATS_LENGTH)
+			return;
+		DoorLink_unpackTaskStats(response.payload, &stats);
+		if (stats.runs != 0) {
+			LCD_clearScreen();
+			LCD_displayCharacter('T');
+			LCD_intgerToString(task);
+			LCD_displayString(" E");
+			show_time(stats.exec_total_us / stats.runs);
+			LCD_displayCharacter('/');
+			show_time(stats.exec_max_us);
+			LCD_moveCursor(1, 0);
+			LCD_displayString("J");
+			show_time(stats.jitter_max_us);
+			LCD_displayString(" Miss ");
+			LCD_intgerToString(stats.deadline_misses);
+			link_wait(REPORT_TIME);
+		}
+		task++;
+	}
+}
+/*
+ * Function: show_time
+ * ----------------------------------
+ * Displays a time in us, or in ms followed by 'm' from 10 ms on, so it fits
+ * the int of the LCD driver and the 16 columns of a row.
+ *
+ * Parameters: uint32
+ *
+ * Returns: None
+ */
+void show_time(uint32 time_us) {
+	if (time_us < 10000) {
+		LCD_intgerToString(time_us);
+	} else {
+		LCD_intgerToString(time_us / 1000);
+		LCD_displayCharacter('m');
+	}
 }
@@ -11,9 +11,103 @@
  *******************************************************************************/
 
 #include "UART.h"
+#include "isr_profile.h"
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include "common_macros.h"
 
+#define UART_RX_BUFFER_MASK		(UART_RX_BUFFER_SIZE - 1)
+#define UART_TX_BUFFER_MASK		(UART_TX_BUFFER_SIZE - 1)
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* RX ring buffer: written by the RX Complete ISR, read by UART_receiveByte */
+static volatile uint8 g_rxBuffer[UART_RX_BUFFER_SIZE];
+static volatile uint32 g_rxStamp[UART_RX_BUFFER_SIZE];
+static volatile uint8 g_rxHead = 0;
+static volatile uint8 g_rxTail = 0;
+
+/* TX ring buffer: written by UART_sendByte, read by the Data Register Empty ISR */
+static volatile uint8 g_txBuffer[UART_TX_BUFFER_SIZE];
+static volatile uint8 g_txHead = 0;
+static volatile uint8 g_txTail = 0;
+
+static volatile UART_StatsType g_stats;
+
+/* Global variable to hold the address of the time source function */
+static uint32 (*volatile g_timeSourcePtr)(void) = NULL_PTR;
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+ISR(USART_RXC_vect)
+{
+	uint8 status;
+	uint8 data;
+	uint8 next;
+	uint8 level;
+
+	ISR_PROFILE_ENTER(ISR_PROFILE_USART_RXC);
+	/* The error flags belong to the byte in UDR, so UCSRA must be read first */
+	status = UCSRA;
+	data = UDR;
+	next = (g_rxHead + 1) & UART_RX_BUFFER_MASK;
+
+	g_stats.rx_bytes++;
+	if(BIT_IS_SET(status, FE))
+	{
+		g_stats.framing_errors++;
+	}
+	if(BIT_IS_SET(status, DOR))
+	{
+		g_stats.overrun_errors++;
+	}
+	if(BIT_IS_SET(status, PE))
+	{
+		g_stats.parity_errors++;
+	}
+
+	if(next == g_rxTail)
+	{
+		g_stats.rx_buffer_overflows++;
+	}
+	else
+	{
+		g_rxBuffer[g_rxHead] = data;
+		if(g_timeSourcePtr != NULL_PTR)
+		{
+			g_rxStamp[g_rxHead] = (*g_timeSourcePtr)();
+		}
+		g_rxHead = next;
+
+		level = (g_rxHead - g_rxTail) & UART_RX_BUFFER_MASK;
+		if(level > g_stats.rx_high_water)
+		{
+			g_stats.rx_high_water = level;
+		}
+	}
+	ISR_PROFILE_EXIT(ISR_PROFILE_USART_RXC);
+}
+
+ISR(USART_UDRE_vect)
+{
+	ISR_PROFILE_ENTER(ISR_PROFILE_USART_UDRE);
+	if(g_txHead == g_txTail)
+	{
+		/* Nothing left to send, disable the Data Register Empty interrupt */
+		CLEAR_BIT(UCSRB, UDRIE);
+	}
+	else
+	{
+		UDR = g_txBuffer[g_txTail];
+		g_txTail = (g_txTail + 1) & UART_TX_BUFFER_MASK;
+	}
+	ISR_PROFILE_EXIT(ISR_PROFILE_USART_UDRE);
+}
+
 
 
 /*******************************************************************************
@@ -35,15 +129,18 @@ void UART_init(const UART_ConfigType *Config_Ptr)
 	UCSRA = (1<<U2X);
 
 	/*
-	 * RXCIE = 0 Disable USART RX Complete Interrupt Enable
+	 * RXCIE = 1 Enable USART RX Complete Interrupt Enable, bytes go to the RX ring buffer
 	 * TXCIE = 0 Disable USART Tx Complete Interrupt Enable
-	 * UDRIE = 0 Disable USART Data Register Empty Interrupt Enable
+	 * UDRIE = 0 Disable USART Data Register Empty Interrupt Enable, set while the TX ring buffer has data
 	 * RXEN  = 1 Receiver Enable
 	 * TXEN  = 1 Transmitter Enable
 	 * UCSZ2 = 0 For (5,6,7,8) bit data mode
 	 * RXB8 & TXB8 not used for (5,6,7,8) bit data mode
 	 */
-	UCSRB = (1<<RXEN) | (1<<TXEN);
+	g_rxHead = g_rxTail = 0;
+	g_txHead = g_txTail = 0;
+	UART_resetStats();
+	UCSRB = (1<<RXCIE) | (1<<RXEN) | (1<<TXEN);
 
 
 	/*
@@ -73,10 +170,24 @@ void UART_init(const UART_ConfigType *Config_Ptr)
  */
 void UART_sendByte(const uint8 data)
 {
-	/*Wait until the buffer is empty and ready to take new data frame*/
-	while(BIT_IS_CLEAR(UCSRA, UDRE));
+	uint8 next = (g_txHead + 1) & UART_TX_BUFFER_MASK;
+	uint8 level;
+
+	/*Wait until the TX ring buffer has room for the new data frame*/
+	while(next == g_txTail);
+
+	g_txBuffer[g_txHead] = data;
+	g_txHead = next;
+	g_stats.tx_bytes++;
+
+	level = (g_txHead - g_txTail) & UART_TX_BUFFER_MASK;
+	if(level > g_stats.tx_high_water)
+	{
+		g_stats.tx_high_water = level;
+	}
 
-	UDR = data;
+	/*Let the Data Register Empty interrupt move the buffer to UDR*/
+	SET_BIT(UCSRB, UDRIE);
 }
 
 
@@ -87,9 +198,34 @@ void UART_sendByte(const uint8 data)
  */
 uint8 UART_receiveByte(void)
 {
-	while(BIT_IS_CLEAR(UCSRA, RXC));
+	uint8 data;
+	uint32 latency;
+
+	/*Wait until the RX interrupt has stored a data frame*/
+	while(g_rxHead == g_rxTail);
+
+	data = g_rxBuffer[g_rxTail];
+	if(g_timeSourcePtr != NULL_PTR)
+	{
+		latency = (*g_timeSourcePtr)() - g_rxStamp[g_rxTail];
+		if(latency > g_stats.max_rx_latency)
+		{
+			g_stats.max_rx_latency = latency;
+		}
+	}
+	g_rxTail = (g_rxTail + 1) & UART_RX_BUFFER_MASK;
 
-	return UDR;
+	return data;
+}
+
+
+/*
+ * Description :
+ * Return the number of received bytes UART_receiveByte can return without waiting.
+ */
+uint8 UART_availableBytes(void)
+{
+	return (g_rxHead - g_rxTail) & UART_RX_BUFFER_MASK;
 }
 
 
@@ -131,3 +267,46 @@ void UART_receiveString(uint8 *Str)
 	/* After receiving the whole string plus the '#', replace the '#' with '\0' */
 	Str[i] = '\0';
 }
+
+
+/*
+ * Description :
+ * Set the time source used to stamp received bytes for the max_rx_latency counter.
+ */
+void UART_setTimeSource(uint32(*a_ptr)(void))
+{
+	g_timeSourcePtr = a_ptr;
+}
+
+
+/*
+ * Description :
+ * Copy a consistent snapshot of the link health counters.
+ */
+void UART_getStats(UART_StatsType *Stats_Ptr)
+{
+	uint8 sreg = SREG;
+
+	/* The RX interrupt updates the 32-bit counters, copy them atomically */
+	cli();
+	*Stats_Ptr = g_stats;
+	SREG = sreg;
+}
+
+
+/*
+ * Description :
+ * Clear all the link health counters.
+ */
+void UART_resetStats(void)
+{
+	uint8 sreg = SREG;
+	uint8 i;
+
+	cli();
+	for(i = 0; i < sizeof(UART_StatsType); i++)
+	{
+		((volatile uint8 *)&g_stats)[i] = 0;
+	}
+	SREG = sreg;
+}
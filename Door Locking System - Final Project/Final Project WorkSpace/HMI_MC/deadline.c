@@ -0,0 +1,96 @@
+ /******************************************************************************
+ *
+ * Module: Deadline
+ *
+ * File Name: deadline.c
+ *
+ * Description: Source file for the deadline service
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include "deadline.h"
+#include "soft_timer.h"
+#include "power.h"
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Deadline of the sleeping wait, the Power_waitFor condition has no argument */
+static const Deadline_Type *g_sleepingDeadline = NULL_PTR;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+static boolean Deadline_sleepingExpired(void)
+{
+	return Deadline_isExpired(g_sleepingDeadline);
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Keep the expiry time, it wraps with the clock.
+ */
+void Deadline_start(Deadline_Type *deadline, uint32 timeout_ms)
+{
+	deadline->expiry = SoftTimer_millis() + timeout_ms;
+}
+
+/*
+ * Description :
+ * Compare with the clock through the difference, correct across its wrap.
+ */
+boolean Deadline_isExpired(const Deadline_Type *deadline)
+{
+	return ((sint32)(SoftTimer_millis() - deadline->expiry) >= 0);
+}
+
+/*
+ * Description :
+ * Difference between the expiry and the clock.
+ */
+uint32 Deadline_remaining(const Deadline_Type *deadline)
+{
+	sint32 remaining = (sint32)(deadline->expiry - SoftTimer_millis());
+
+	return (remaining > 0) ? (uint32)remaining : 0;
+}
+
+/*
+ * Description :
+ * Call yield until the expiry, or sleep until the tick interrupt that
+ * reaches it.
+ */
+void Deadline_wait(const Deadline_Type *deadline, void(*yield)(void))
+{
+	if(yield == NULL_PTR)
+	{
+		g_sleepingDeadline = deadline;
+		Power_waitFor(&Deadline_sleepingExpired, POWER_IDLE);
+		return;
+	}
+
+	while(!Deadline_isExpired(deadline))
+	{
+		(*yield)();
+	}
+}
+
+/*
+ * Description :
+ * Start a deadline on the stack and wait for it.
+ */
+void Deadline_delay(uint32 timeout_ms, void(*yield)(void))
+{
+	Deadline_Type deadline;
+
+	Deadline_start(&deadline, timeout_ms);
+	Deadline_wait(&deadline, yield);
+}
@@ -0,0 +1,76 @@
+ /******************************************************************************
+ *
+ * Module: Deadline
+ *
+ * File Name: deadline.h
+ *
+ * Description: Header file for the deadline service, the replacement of the
+ *              _delay_ms loops. A deadline is started with a timeout on the
+ *              SoftTimer_millis clock, then:
+ *              - polled with Deadline_isExpired by a loop doing other work,
+ *              - or waited for with Deadline_wait, which calls a yield
+ *                function until it expires or, without one, sleeps in idle
+ *                mode. The interrupts run meanwhile: the UART keeps receiving
+ *                and the CPU is stopped instead of counting cycles.
+ *
+ *              A sleeping wait is woken by the soft timer tick, it may end up
+ *              to SOFT_TIMER_TICK_MS late. The sub-ms waits of the drivers
+ *              (LCD strobes, bus polling) stay on _delay_us.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#ifndef DEADLINE_H_
+#define DEADLINE_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+
+typedef struct{
+	uint32 expiry;					/* SoftTimer_millis at the expiry */
+}Deadline_Type;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Start the deadline: it expires timeout_ms from now, less than 24 days.
+ * SoftTimer_init must have been called.
+ */
+void Deadline_start(Deadline_Type *deadline, uint32 timeout_ms);
+
+/*
+ * Description :
+ * Return TRUE once the deadline has expired. Safe with the interrupts
+ * disabled.
+ */
+boolean Deadline_isExpired(const Deadline_Type *deadline);
+
+/*
+ * Description :
+ * Return the ms left before the expiry, 0 once it has expired.
+ */
+uint32 Deadline_remaining(const Deadline_Type *deadline);
+
+/*
+ * Description :
+ * Return when the deadline has expired. yield is called until then, it may
+ * do any work but no wait of its own. If yield is NULL_PTR the CPU sleeps in
+ * idle mode, the interrupts must be enabled.
+ */
+void Deadline_wait(const Deadline_Type *deadline, void(*yield)(void));
+
+/*
+ * Description :
+ * Start a deadline of timeout_ms and wait for it, the replacement of
+ * _delay_ms.
+ */
+void Deadline_delay(uint32 timeout_ms, void(*yield)(void));
+
+#endif /* DEADLINE_H_ */
@@ -0,0 +1,495 @@
+ /******************************************************************************
+ *
+ * Module: Door Link
+ *
+ * File Name: door_link.c
+ *
+ * Description: Source file for the HMI <-> CTRL request/response protocol
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include "door_link.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+typedef enum
+{
+	RX_WAIT_SOF, RX_SEQ, RX_CODE, RX_LENGTH, RX_PAYLOAD, RX_CRC
+}DoorLink_RxState;
+
+typedef struct
+{
+	uint8 seq;					/* DOOR_LINK_NO_SEQ when the slot is free */
+	boolean done;				/* Response received */
+	uint8 resends;				/* Times the request was sent again */
+	uint32 time;				/* Last send of the request, or arrival of the response */
+	DoorLink_FrameType frame;	/* The request until done, then the response */
+}DoorLink_Outstanding;
+
+typedef struct
+{
+	uint8 code;					/* Request answered, its seq is in the response */
+	uint32 time;				/* Time the response was sent */
+	DoorLink_FrameType response;	/* seq DOOR_LINK_NO_SEQ when empty */
+}DoorLink_Reply;
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Frame parser */
+static DoorLink_RxState g_rxState = RX_WAIT_SOF;
+static DoorLink_FrameType g_rxFrame;
+static uint8 g_rxIndex = 0;
+static uint8 g_rxCrc = 0;
+
+/* Requests waiting for their response (HMI side) */
+static DoorLink_Outstanding g_outstanding[DOOR_LINK_MAX_OUTSTANDING];
+static uint8 g_nextSeq = 1;
+
+/* Last responses sent, for the resent requests (CTRL side) */
+static DoorLink_Reply g_replies[DOOR_LINK_MAX_OUTSTANDING];
+static uint8 g_nextReply = 0;
+
+static uint32 (*g_timeSourcePtr)(void) = NULL_PTR;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/* CRC-8, polynomial x^8 + x^2 + x + 1 */
+static uint8 DoorLink_crc8(uint8 crc, uint8 data)
+{
+	uint8 bit;
+	crc ^= data;
+	for(bit = 0; bit < 8; bit++)
+	{
+		crc = (crc & 0x80) ? (uint8)((crc << 1) ^ 0x07) : (uint8)(crc << 1);
+	}
+	return crc;
+}
+
+/* Feed one received byte to the frame parser, return TRUE when g_rxFrame is complete and valid */
+static boolean DoorLink_parseByte(uint8 data)
+{
+	switch(g_rxState)
+	{
+	case RX_WAIT_SOF:
+		if(data == DOOR_LINK_SOF)
+		{
+			g_rxCrc = 0;
+			g_rxState = RX_SEQ;
+		}
+		break;
+	case RX_SEQ:
+		g_rxFrame.seq = data;
+		g_rxCrc = DoorLink_crc8(g_rxCrc, data);
+		g_rxState = RX_CODE;
+		break;
+	case RX_CODE:
+		g_rxFrame.code = data;
+		g_rxCrc = DoorLink_crc8(g_rxCrc, data);
+		g_rxState = RX_LENGTH;
+		break;
+	case RX_LENGTH:
+		g_rxFrame.length = data;
+		g_rxCrc = DoorLink_crc8(g_rxCrc, data);
+		g_rxIndex = 0;
+		if(data > DOOR_LINK_MAX_PAYLOAD)
+		{
+			/* Corrupted header, hunt for the next start of frame */
+			g_rxState = RX_WAIT_SOF;
+		}
+		else
+		{
+			g_rxState = (data == 0) ? RX_CRC : RX_PAYLOAD;
+		}
+		break;
+	case RX_PAYLOAD:
+		g_rxFrame.payload[g_rxIndex++] = data;
+		g_rxCrc = DoorLink_crc8(g_rxCrc, data);
+		if(g_rxIndex == g_rxFrame.length)
+		{
+			g_rxState = RX_CRC;
+		}
+		break;
+	case RX_CRC:
+		g_rxState = RX_WAIT_SOF;
+		return (data == g_rxCrc);
+	}
+	return FALSE;
+}
+
+/* Store a received response in the slot of its request, unknown ones are dropped */
+static void DoorLink_dispatch(const DoorLink_FrameType *Frame_Ptr)
+{
+	uint8 i;
+	for(i = 0; i < DOOR_LINK_MAX_OUTSTANDING; i++)
+	{
+		if(g_outstanding[i].seq == Frame_Ptr->seq && !g_outstanding[i].done)
+		{
+			g_outstanding[i].frame = *Frame_Ptr;
+			g_outstanding[i].done = TRUE;
+			if(g_timeSourcePtr != NULL_PTR)
+			{
+				g_outstanding[i].time = (*g_timeSourcePtr)();
+			}
+			return;
+		}
+	}
+}
+
+static void DoorLink_put32(uint8 *payload, uint32 value)
+{
+	payload[0] = (uint8)value;
+	payload[1] = (uint8)(value >> 8);
+	payload[2] = (uint8)(value >> 16);
+	payload[3] = (uint8)(value >> 24);
+}
+
+static uint32 DoorLink_get32(const uint8 *payload)
+{
+	return (uint32)payload[0] | ((uint32)payload[1] << 8) | ((uint32)payload[2] << 16) | ((uint32)payload[3] << 24);
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+void DoorLink_init(void)
+{
+	uint8 i;
+	g_rxState = RX_WAIT_SOF;
+	for(i = 0; i < DOOR_LINK_MAX_OUTSTANDING; i++)
+	{
+		g_outstanding[i].seq = DOOR_LINK_NO_SEQ;
+		g_outstanding[i].done = FALSE;
+		g_replies[i].response.seq = DOOR_LINK_NO_SEQ;
+	}
+	g_nextReply = 0;
+}
+
+void DoorLink_setTimeSource(uint32(*a_ptr)(void))
+{
+	g_timeSourcePtr = a_ptr;
+}
+
+void DoorLink_sendFrame(const DoorLink_FrameType *Frame_Ptr)
+{
+	uint8 frame[DOOR_LINK_MAX_PAYLOAD + DOOR_LINK_FRAME_OVERHEAD];
+	uint8 crc = 0;
+	uint8 length = 0;
+	uint8 i;
+
+	frame[length++] = DOOR_LINK_SOF;
+	frame[length++] = Frame_Ptr->seq;
+	frame[length++] = Frame_Ptr->code;
+	frame[length++] = Frame_Ptr->length;
+	for(i = 0; i < Frame_Ptr->length; i++)
+	{
+		frame[length++] = Frame_Ptr->payload[i];
+	}
+	for(i = 1; i < length; i++)
+	{
+		crc = DoorLink_crc8(crc, frame[i]);
+	}
+	frame[length++] = crc;
+
+#ifdef DOOR_LINK_SPI
+	SPI_sendMessage(frame, length);
+#else
+	for(i = 0; i < length; i++)
+	{
+		UART_sendByte(frame[i]);
+	}
+#endif
+}
+
+boolean DoorLink_receiveFrame(DoorLink_FrameType *Frame_Ptr)
+{
+#ifdef DOOR_LINK_SPI
+	uint8 message[SPI_MESSAGE_MAX_LENGTH];
+	uint8 length;
+	uint8 i;
+
+	/* One frame per message, the parser still checks it */
+	while(SPI_receiveMessage(message, &length))
+	{
+		for(i = 0; i < length; i++)
+		{
+			if(DoorLink_parseByte(message[i]))
+			{
+				*Frame_Ptr = g_rxFrame;
+				return TRUE;
+			}
+		}
+	}
+#else
+	while(UART_availableBytes() != 0)
+	{
+		if(DoorLink_parseByte(UART_receiveByte()))
+		{
+			*Frame_Ptr = g_rxFrame;
+			return TRUE;
+		}
+	}
+#endif
+	return FALSE;
+}
+
+void DoorLink_sendResponse(const DoorLink_FrameType *Request_Ptr, const DoorLink_FrameType *Response_Ptr)
+{
+	DoorLink_Reply *reply = &g_replies[g_nextReply];
+
+	reply->code = Request_Ptr->code;
+	reply->response = *Response_Ptr;
+	reply->time = (g_timeSourcePtr != NULL_PTR) ? (*g_timeSourcePtr)() : 0;
+	g_nextReply = (g_nextReply + 1) % DOOR_LINK_MAX_OUTSTANDING;
+	DoorLink_sendFrame(Response_Ptr);
+}
+
+boolean DoorLink_replay(const DoorLink_FrameType *Request_Ptr)
+{
+	uint8 i;
+
+	for(i = 0; i < DOOR_LINK_MAX_OUTSTANDING; i++)
+	{
+		if(g_replies[i].response.seq == Request_Ptr->seq && Request_Ptr->seq != DOOR_LINK_NO_SEQ &&
+		   g_replies[i].code == Request_Ptr->code &&
+		   (g_timeSourcePtr == NULL_PTR || (*g_timeSourcePtr)() - g_replies[i].time < DOOR_LINK_REQUEST_LIFETIME_MS))
+		{
+			DoorLink_sendFrame(&g_replies[i].response);
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+uint8 DoorLink_request(uint8 command, const uint8 *payload, uint8 length)
+{
+	DoorLink_Outstanding *slot;
+	uint8 i;
+
+	for(i = 0; i < DOOR_LINK_MAX_OUTSTANDING; i++)
+	{
+		if(g_outstanding[i].seq == DOOR_LINK_NO_SEQ)
+		{
+			break;
+		}
+	}
+	if(i == DOOR_LINK_MAX_OUTSTANDING || length > DOOR_LINK_MAX_PAYLOAD)
+	{
+		return DOOR_LINK_NO_SEQ;
+	}
+
+	/* The slot keeps the request for the resends */
+	slot = &g_outstanding[i];
+	slot->frame.seq = g_nextSeq;
+	slot->frame.code = command;
+	slot->frame.length = length;
+	for(i = 0; i < length; i++)
+	{
+		slot->frame.payload[i] = payload[i];
+	}
+
+	g_nextSeq++;
+	if(g_nextSeq == DOOR_LINK_NO_SEQ)
+	{
+		g_nextSeq = 1;
+	}
+
+	slot->seq = slot->frame.seq;
+	slot->done = FALSE;
+	slot->resends = 0;
+	slot->time = (g_timeSourcePtr != NULL_PTR) ? (*g_timeSourcePtr)() : 0;
+	DoorLink_sendFrame(&slot->frame);
+	return slot->seq;
+}
+
+void DoorLink_poll(void)
+{
+	DoorLink_FrameType frame;
+	DoorLink_Outstanding *slot;
+	uint32 now;
+	uint8 i;
+
+	while(DoorLink_receiveFrame(&frame))
+	{
+		DoorLink_dispatch(&frame);
+	}
+
+	if(g_timeSourcePtr == NULL_PTR)
+	{
+		return;
+	}
+	now = (*g_timeSourcePtr)();
+	for(i = 0; i < DOOR_LINK_MAX_OUTSTANDING; i++)
+	{
+		slot = &g_outstanding[i];
+		if(slot->seq == DOOR_LINK_NO_SEQ)
+		{
+			continue;
+		}
+		if(slot->done)
+		{
+			/* Response abandoned by its caller */
+			if(now - slot->time >= DOOR_LINK_REQUEST_LIFETIME_MS)
+			{
+				slot->seq = DOOR_LINK_NO_SEQ;
+				slot->done = FALSE;
+			}
+		}
+		else if(now - slot->time >= DOOR_LINK_RESPONSE_TIMEOUT_MS)
+		{
+			if(slot->resends < DOOR_LINK_MAX_RESENDS)
+			{
+				/* Request or response lost, the CTRL replays an answered request */
+				slot->resends++;
+				slot->time = now;
+				DoorLink_sendFrame(&slot->frame);
+			}
+			else
+			{
+				slot->seq = DOOR_LINK_NO_SEQ;
+			}
+		}
+	}
+}
+
+DoorLink_ResultType DoorLink_getResponse(uint8 seq, DoorLink_FrameType *Response_Ptr)
+{
+	uint8 i;
+
+	DoorLink_poll();
+
+	for(i = 0; i < DOOR_LINK_MAX_OUTSTANDING; i++)
+	{
+		if(g_outstanding[i].seq == seq && seq != DOOR_LINK_NO_SEQ)
+		{
+			if(!g_outstanding[i].done)
+			{
+				return DOOR_LINK_PENDING;
+			}
+			*Response_Ptr = g_outstanding[i].frame;
+			g_outstanding[i].seq = DOOR_LINK_NO_SEQ;
+			g_outstanding[i].done = FALSE;
+			return DOOR_LINK_OK;
+		}
+	}
+	/* Given up and freed by DoorLink_poll */
+	return DOOR_LINK_TIMEOUT;
+}
+
+uint8 DoorLink_outstanding(void)
+{
+	uint8 i;
+	uint8 count = 0;
+	for(i = 0; i < DOOR_LINK_MAX_OUTSTANDING; i++)
+	{
+		if(g_outstanding[i].seq != DOOR_LINK_NO_SEQ)
+		{
+			count++;
+		}
+	}
+	return count;
+}
+
+DoorLink_ResultType DoorLink_transact(uint8 command, const uint8 *payload, uint8 length, DoorLink_FrameType *Response_Ptr)
+{
+	DoorLink_ResultType result;
+	uint8 seq;
+
+	if(length > DOOR_LINK_MAX_PAYLOAD)
+	{
+		return DOOR_LINK_TIMEOUT;
+	}
+	/* Wait for a free slot, every slot frees itself within its lifetime */
+	while((seq = DoorLink_request(command, payload, length)) == DOOR_LINK_NO_SEQ)
+	{
+		DoorLink_poll();
+	}
+	/* Then for the matching response, or the end of the resends */
+	while((result = DoorLink_getResponse(seq, Response_Ptr)) == DOOR_LINK_PENDING);
+	return result;
+}
+
+void DoorLink_packStats(const UART_StatsType *Stats_Ptr, uint8 *payload)
+{
+	DoorLink_put32(&payload[0], Stats_Ptr->rx_bytes);
+	DoorLink_put32(&payload[4], Stats_Ptr->tx_bytes);
+	payload[8] = (uint8)Stats_Ptr->framing_errors;
+	payload[9] = (uint8)(Stats_Ptr->framing_errors >> 8);
+	payload[10] = (uint8)Stats_Ptr->overrun_errors;
+	payload[11] = (uint8)(Stats_Ptr->overrun_errors >> 8);
+	payload[12] = (uint8)Stats_Ptr->parity_errors;
+	payload[13] = (uint8)(Stats_Ptr->parity_errors >> 8);
+	payload[14] = (uint8)Stats_Ptr->rx_buffer_overflows;
+	payload[15] = (uint8)(Stats_Ptr->rx_buffer_overflows >> 8);
+	payload[16] = Stats_Ptr->rx_high_water;
+	payload[17] = Stats_Ptr->tx_high_water;
+	DoorLink_put32(&payload[18], Stats_Ptr->max_rx_latency);
+}
+
+void DoorLink_unpackStats(const uint8 *payload, UART_StatsType *Stats_Ptr)
+{
+	Stats_Ptr->rx_bytes = DoorLink_get32(&payload[0]);
+	Stats_Ptr->tx_bytes = DoorLink_get32(&payload[4]);
+	Stats_Ptr->framing_errors = payload[8] | (payload[9] << 8);
+	Stats_Ptr->overrun_errors = payload[10] | (payload[11] << 8);
+	Stats_Ptr->parity_errors = payload[12] | (payload[13] << 8);
+	Stats_Ptr->rx_buffer_overflows = payload[14] | (payload[15] << 8);
+	Stats_Ptr->rx_high_water = payload[16];
+	Stats_Ptr->tx_high_water = payload[17];
+	Stats_Ptr->max_rx_latency = DoorLink_get32(&payload[18]);
+}
+
+void DoorLink_packIsrStats(const IsrProfile_StatsType *Stats_Ptr, uint8 *payload)
+{
+	DoorLink_put32(&payload[0], Stats_Ptr->runs);
+	DoorLink_put32(&payload[4], Stats_Ptr->time_total_us);
+	payload[8] = (uint8)Stats_Ptr->time_min_us;
+	payload[9] = (uint8)(Stats_Ptr->time_min_us >> 8);
+	payload[10] = (uint8)Stats_Ptr->time_max_us;
+	payload[11] = (uint8)(Stats_Ptr->time_max_us >> 8);
+	DoorLink_put32(&payload[12], Stats_Ptr->latency_runs);
+	DoorLink_put32(&payload[16], Stats_Ptr->latency_total_us);
+	payload[20] = (uint8)Stats_Ptr->latency_min_us;
+	payload[21] = (uint8)(Stats_Ptr->latency_min_us >> 8);
+	payload[22] = (uint8)Stats_Ptr->latency_max_us;
+	payload[23] = (uint8)(Stats_Ptr->latency_max_us >> 8);
+}
+
+void DoorLink_unpackIsrStats(const uint8 *payload, IsrProfile_StatsType *Stats_Ptr)
+{
+	Stats_Ptr->runs = DoorLink_get32(&payload[0]);
+	Stats_Ptr->time_total_us = DoorLink_get32(&payload[4]);
+	Stats_Ptr->time_min_us = payload[8] | (payload[9] << 8);
+	Stats_Ptr->time_max_us = payload[10] | (payload[11] << 8);
+	Stats_Ptr->latency_runs = DoorLink_get32(&payload[12]);
+	Stats_Ptr->latency_total_us = DoorLink_get32(&payload[16]);
+	Stats_Ptr->latency_min_us = payload[20] | (payload[21] << 8);
+	Stats_Ptr->latency_max_us = payload[22] | (payload[23] << 8);
+}
+
+void DoorLink_packTaskStats(const DoorLink_TaskStatsType *Stats_Ptr, uint8 *payload)
+{
+	DoorLink_put32(&payload[0], Stats_Ptr->runs);
+	DoorLink_put32(&payload[4], Stats_Ptr->exec_total_us);
+	DoorLink_put32(&payload[8], Stats_Ptr->exec_max_us);
+	DoorLink_put32(&payload[12], Stats_Ptr->jitter_max_us);
+	payload[16] = (uint8)Stats_Ptr->deadline_misses;
+	payload[17] = (uint8)(Stats_Ptr->deadline_misses >> 8);
+}
+
+void DoorLink_unpackTaskStats(const uint8 *payload, DoorLink_TaskStatsType *Stats_Ptr)
+{
+	Stats_Ptr->runs = DoorLink_get32(&payload[0]);
+	Stats_Ptr->exec_total_us = DoorLink_get32(&payload[4]);
+	Stats_Ptr->exec_max_us = DoorLink_get32(&payload[8]);
+	Stats_Ptr->jitter_max_us = DoorLink_get32(&payload[12]);
+	Stats_Ptr->deadline_misses = payload[16] | (payload[17] << 8);
+}
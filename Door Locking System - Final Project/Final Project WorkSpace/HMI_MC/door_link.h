@@ -0,0 +1,315 @@
+ /******************************************************************************
+ *
+ * Module: Door Link
+ *
+ * File Name: door_link.h
+ *
+ * Description: Header file for the HMI <-> CTRL request/response protocol.
+ *              Every request carries a sequence number which the CTRL echoes
+ *              in its response, so the HMI can keep several requests
+ *              outstanding while a door or alarm action runs in the background.
+ *
+ *              Frame: | SOF | SEQ | CODE | LENGTH | PAYLOAD (LENGTH bytes) | CRC-8 |
+ *              CODE is a DOOR_CMD_xxx in a request and a DOOR_STATUS_xxx in
+ *              a response. The CRC-8 (poly 0x07) covers SEQ up to the payload.
+ *
+ *              The frames travel on the UART by default. Building both MCUs
+ *              with DOOR_LINK_SPI defined carries them on the SPI instead, one
+ *              frame per message, with the HMI as master and the CTRL as slave.
+ *
+ *              A frame lost on the line (bad CRC, framing error, overrun) is
+ *              recovered by the HMI: a request without response after
+ *              DOOR_LINK_RESPONSE_TIMEOUT_MS is sent again on the same
+ *              sequence number, up to DOOR_LINK_MAX_RESENDS times, then given
+ *              up and its slot freed. The CTRL keeps its last responses and
+ *              sends the same one again for a resent request, so a request
+ *              whose response was lost is never executed twice.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#ifndef DOOR_LINK_H_
+#define DOOR_LINK_H_
+
+#include "std_types.h"
+#include "UART.h"
+#include "isr_profile.h"
+#ifdef DOOR_LINK_SPI
+#include "spi.h"
+#endif
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define DOOR_LINK_SOF				0x7E
+#define DOOR_LINK_MAX_PAYLOAD		24
+#define DOOR_LINK_MAX_OUTSTANDING	4		/* Requests the HMI may have in flight */
+#define DOOR_LINK_NO_SEQ			0		/* Never used as a sequence number */
+
+#define DOOR_LINK_FRAME_OVERHEAD	5		/* SOF, SEQ, CODE, LENGTH and CRC */
+
+#ifdef DOOR_LINK_SPI
+#if (DOOR_LINK_MAX_PAYLOAD + DOOR_LINK_FRAME_OVERHEAD) > SPI_MESSAGE_MAX_LENGTH
+#error "A door link frame does not fit in one SPI message"
+#endif
+#endif
+
+/*
+ * Response timeout on the time source of DoorLink_setTimeSource (ms). The
+ * longest CTRL request, an EEPROM save with its write cycles, plus two frames
+ * at 9600 baud take well below it. The host simulation scales it with its
+ * clock.
+ */
+#ifndef DOOR_LINK_RESPONSE_TIMEOUT_MS
+#define DOOR_LINK_RESPONSE_TIMEOUT_MS	250UL
+#endif
+#define DOOR_LINK_MAX_RESENDS		3
+
+/* A request is given up, and a kept response forgotten, after this time */
+#define DOOR_LINK_REQUEST_LIFETIME_MS	(DOOR_LINK_RESPONSE_TIMEOUT_MS * (DOOR_LINK_MAX_RESENDS + 1))
+
+#define DOOR_PASSWORD_LENGTH		5
+
+/* STATUS requests exchanged by the HMI link test ('%' service key) */
+#define DOOR_LINK_TEST_MESSAGES		100
+
+/* Requests (HMI -> CTRL) */
+#define DOOR_CMD_SET_PASSWORD		0x01	/* payload: new password, confirmation */
+#define DOOR_CMD_VERIFY_PASSWORD	0x02	/* payload: password, grants one SET_PASSWORD */
+#define DOOR_CMD_OPEN				0x03	/* payload: password, starts the door cycle */
+#define DOOR_CMD_STATUS				0x04	/* response payload: Door_StatusType fields */
+#define DOOR_CMD_ABORT				0x05	/* close the door now */
+#define DOOR_CMD_ALARM_ACK			0x06	/* silence the buzzer, the lockout keeps running */
+#define DOOR_CMD_LINK_STATS			0x07	/* response payload: packed UART_StatsType */
+#define DOOR_CMD_LOG_READ			0x08	/* payload: first record (2), response: see below */
+#define DOOR_CMD_CLOCK				0x09	/* payload: none or a reference time, response: see below */
+#define DOOR_CMD_ISR_PROFILE		0x0A	/* payload: IsrProfile_VectorType (1), response: see below */
+#define DOOR_CMD_TASK_STATS			0x0B	/* payload: task index (1), response: see below */
+
+/* Response codes (CTRL -> HMI) */
+#define DOOR_STATUS_OK				0x00
+#define DOOR_STATUS_WRONG_PASSWORD	0x01
+#define DOOR_STATUS_MISMATCH		0x02	/* password and confirmation differ */
+#define DOOR_STATUS_ALARM			0x03	/* too many wrong passwords, alarm is running */
+#define DOOR_STATUS_BUSY			0x04	/* door cycle in progress */
+#define DOOR_STATUS_DENIED			0x05	/* SET_PASSWORD without a verified password */
+#define DOOR_STATUS_UNKNOWN			0x06	/* unknown command or bad payload */
+
+/* Size of the packed UART_StatsType payload */
+#define DOOR_LINK_STATS_LENGTH		22
+
+/*
+ * Interrupt profile of the CTRL, read with DOOR_CMD_ISR_PROFILE.
+ * Request payload : | VECTOR |
+ * Response payload: | RUNS (4) | TIME TOTAL (4) | TIME MIN (2) | TIME MAX (2) |
+ *                   | LATENCY RUNS (4) | LATENCY TOTAL (4) | LATENCY MIN (2) |
+ *                   | LATENCY MAX (2) |, the IsrProfile_StatsType fields in us.
+ *                   DOOR_STATUS_UNKNOWN for an unknown vector or in a build
+ *                   without ISR_PROFILE.
+ * Every field is little-endian.
+ */
+#define DOOR_ISR_PROFILE_LENGTH		24
+
+/*
+ * Scheduler stats of one CTRL task, read with DOOR_CMD_TASK_STATS.
+ * Request payload : | TASK |, the index in the CTRL task table
+ * Response payload: | RUNS (4) | EXEC TOTAL (4) | EXEC MAX (4) | JITTER MAX (4) |
+ *                   | DEADLINE MISSES (2) |, the times in us.
+ *                   DOOR_STATUS_UNKNOWN past the last task.
+ * Every field is little-endian.
+ */
+#define DOOR_TASK_STATS_LENGTH		18
+
+/*
+ * Access event log of the CTRL, exported with DOOR_CMD_LOG_READ.
+ * Request payload : | FIRST (2) |, record 0 is the oldest one kept
+ * Response payload: | COUNT (2) | up to DOOR_LOG_RECORDS_PER_FRAME records from FIRST on |
+ * Record          : | SEQ (2) | EVENT + (ARG << 4) | TIME (4) | CRC-8 |
+ * TIME is in seconds since 2000-01-01 00:00:00 on the CTRL real-time clock,
+ * since boot until the clock is set or on a board without the clock.
+ * Every field is little-endian.
+ */
+#define DOOR_LOG_RECORD_SIZE		8
+#define DOOR_LOG_RECORDS_PER_FRAME	((DOOR_LINK_MAX_PAYLOAD - 2) / DOOR_LOG_RECORD_SIZE)
+#define DOOR_LOG_EVENT_MASK			0x0F	/* EVENT in the low nibble, ARG in the high one */
+#define DOOR_LOG_ARG_MAX			0x0F
+
+/*
+ * Real-time clock of the CTRL, read or set with DOOR_CMD_CLOCK.
+ * Request payload : none to read the clock, or a reference time to set it:
+ *                   | SECOND | MINUTE | HOUR | DAY | MONTH | YEAR (since 2000) |
+ *                   A reference a day or more after the previous one also
+ *                   calibrates the crystal, the calibration is stored.
+ * Response payload: | time as above | CALIBRATION (2, signed ppm) |
+ *                   DOOR_STATUS_UNKNOWN for an invalid time or without a clock.
+ */
+#define DOOR_CLOCK_TIME_LENGTH		6
+#define DOOR_CLOCK_LENGTH			(DOOR_CLOCK_TIME_LENGTH + 2)
+
+/* Events, ARG in brackets */
+#define DOOR_EVENT_BOOT				0x01
+#define DOOR_EVENT_PASSWORD_SET		0x02
+#define DOOR_EVENT_OPEN				0x03
+#define DOOR_EVENT_WRONG_PASSWORD	0x04	/* (wrong passwords in a row) */
+#define DOOR_EVENT_ALARM			0x05
+#define DOOR_EVENT_ALARM_ACK		0x06
+#define DOOR_EVENT_ABORT			0x07
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+
+typedef enum
+{
+	DOOR_IDLE, DOOR_OPENING, DOOR_HOLD, DOOR_CLOSING
+}Door_StateType;
+
+/* DOOR_CMD_STATUS response payload, one byte per field */
+typedef struct
+{
+	Door_StateType door;
+	uint8 alarm;				/* TRUE while the alarm lockout runs */
+	uint8 trials;				/* Wrong passwords in a row */
+	uint8 remaining;			/* Seconds left in the current door phase or alarm */
+}Door_StatusType;
+
+typedef struct
+{
+	uint8 seq;
+	uint8 code;
+	uint8 length;
+	uint8 payload[DOOR_LINK_MAX_PAYLOAD];
+}DoorLink_FrameType;
+
+/* DOOR_CMD_TASK_STATS response payload, the fields of Scheduler_StatsType */
+typedef struct
+{
+	uint32 runs;
+	uint32 exec_total_us;
+	uint32 exec_max_us;
+	uint32 jitter_max_us;
+	uint16 deadline_misses;
+}DoorLink_TaskStatsType;
+
+typedef enum
+{
+	DOOR_LINK_PENDING,			/* no response yet, the request is still in flight */
+	DOOR_LINK_OK,				/* response copied, the slot is free again */
+	DOOR_LINK_TIMEOUT			/* no response after the resends, the slot is free again */
+}DoorLink_ResultType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Reset the frame receiver and the table of outstanding requests.
+ * The UART, or the SPI with DOOR_LINK_SPI, must be initialized before.
+ */
+void DoorLink_init(void);
+
+/*
+ * Description :
+ * Set the function returning the time in ms, e.g. SoftTimer_millis. Without
+ * it the requests never time out and the responses are kept for a replay
+ * until they are overwritten.
+ */
+void DoorLink_setTimeSource(uint32(*a_ptr)(void));
+
+/*
+ * Description :
+ * Send one frame.
+ */
+void DoorLink_sendFrame(const DoorLink_FrameType *Frame_Ptr);
+
+/*
+ * Description :
+ * Feed the received bytes to the frame parser without blocking.
+ * Return TRUE when a complete frame with a valid CRC is copied to Frame_Ptr.
+ */
+boolean DoorLink_receiveFrame(DoorLink_FrameType *Frame_Ptr);
+
+/*
+ * Description :
+ * Send the response to a request and keep it, DoorLink_replay sends it again
+ * if the same request comes back (CTRL side).
+ */
+void DoorLink_sendResponse(const DoorLink_FrameType *Request_Ptr, const DoorLink_FrameType *Response_Ptr);
+
+/*
+ * Description :
+ * If the request is a resend of one answered less than
+ * DOOR_LINK_REQUEST_LIFETIME_MS ago, same sequence number and code, send the
+ * kept response again and return TRUE: the request must not be executed.
+ */
+boolean DoorLink_replay(const DoorLink_FrameType *Request_Ptr);
+
+/*
+ * Description :
+ * Send a request and register it as outstanding.
+ * Return its sequence number, or DOOR_LINK_NO_SEQ if DOOR_LINK_MAX_OUTSTANDING
+ * requests are already waiting for their response.
+ */
+uint8 DoorLink_request(uint8 command, const uint8 *payload, uint8 length);
+
+/*
+ * Description :
+ * Process the received responses and the response timeouts without blocking:
+ * resend the requests whose response is late, free the slots of the requests
+ * given up and of the responses nobody fetched within
+ * DOOR_LINK_REQUEST_LIFETIME_MS.
+ */
+void DoorLink_poll(void);
+
+/*
+ * Description :
+ * DoorLink_poll, then look for the request of the sequence number:
+ * DOOR_LINK_OK when its response has arrived (copied to Response_Ptr, the
+ * slot is released), DOOR_LINK_PENDING while it is in flight and
+ * DOOR_LINK_TIMEOUT once it has been given up.
+ */
+DoorLink_ResultType DoorLink_getResponse(uint8 seq, DoorLink_FrameType *Response_Ptr);
+
+/*
+ * Description :
+ * Return the number of requests waiting for their response.
+ */
+uint8 DoorLink_outstanding(void);
+
+/*
+ * Description :
+ * Send a request and wait for its response, at most about
+ * DOOR_LINK_REQUEST_LIFETIME_MS for a free slot plus as much for the
+ * response. Return DOOR_LINK_OK or DOOR_LINK_TIMEOUT, which the caller must
+ * handle. A time source must be set.
+ */
+DoorLink_ResultType DoorLink_transact(uint8 command, const uint8 *payload, uint8 length, DoorLink_FrameType *Response_Ptr);
+
+/*
+ * Description :
+ * Pack / unpack the link health counters as a little-endian
+ * DOOR_LINK_STATS_LENGTH bytes payload.
+ */
+void DoorLink_packStats(const UART_StatsType *Stats_Ptr, uint8 *payload);
+void DoorLink_unpackStats(const uint8 *payload, UART_StatsType *Stats_Ptr);
+
+/*
+ * Description :
+ * Pack / unpack the stats of one interrupt vector as a little-endian
+ * DOOR_ISR_PROFILE_LENGTH bytes payload.
+ */
+void DoorLink_packIsrStats(const IsrProfile_StatsType *Stats_Ptr, uint8 *payload);
+void DoorLink_unpackIsrStats(const uint8 *payload, IsrProfile_StatsType *Stats_Ptr);
+
+/*
+ * Description :
+ * Pack / unpack the scheduler stats of one task as a little-endian
+ * DOOR_TASK_STATS_LENGTH bytes payload.
+ */
+void DoorLink_packTaskStats(const DoorLink_TaskStatsType *Stats_Ptr, uint8 *payload);
+void DoorLink_unpackTaskStats(const uint8 *payload, DoorLink_TaskStatsType *Stats_Ptr);
+
+#endif /* DOOR_LINK_H_ */
@@ -0,0 +1,183 @@
+ /******************************************************************************
+ *
+ * Module: ISR Profile
+ *
+ * File Name: isr_profile.c
+ *
+ * Description: Source file for the optional interrupt profiler
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include "isr_profile.h"
+#include <avr/io.h>
+
+/* Only a profiling build carries the stats */
+#ifdef ISR_PROFILE
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define ISR_PROFILE_NO_MIN		0xFFFF
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+static uint16 (*volatile g_countPtr)(void) = NULL_PTR;
+static uint16 g_top = 0xFFFF;
+static uint8 g_usPerCount = 1;
+
+/* Stats in counts, only written by the ISRs */
+static IsrProfile_StatsType g_stats[ISR_PROFILE_VECTORS];
+static uint16 g_entry[ISR_PROFILE_VECTORS];
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/* Counts from one reading to a later one, across at most one wrap */
+static uint16 IsrProfile_elapsed(uint16 from, uint16 to)
+{
+	return (to >= from) ? (uint16)(to - from) : (uint16)(to + (g_top - from) + 1);
+}
+
+static uint16 IsrProfile_toUs(uint16 counts)
+{
+	uint32 us = (uint32)counts * g_usPerCount;
+
+	return (counts == ISR_PROFILE_NO_MIN || us > 0xFFFF) ? ISR_PROFILE_NO_MIN : (uint16)us;
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Keep the count and clear the stats, with the interrupts disabled.
+ */
+void IsrProfile_init(uint16(*a_ptr)(void), uint16 top, uint8 us_per_count)
+{
+	uint8 sreg = SREG;
+
+	SREG &= ~(1<<7);
+	g_top = top;
+	g_usPerCount = us_per_count;
+	g_countPtr = a_ptr;
+	IsrProfile_resetStats();
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Keep the entry count, called with the interrupts disabled.
+ */
+void IsrProfile_enter(IsrProfile_VectorType vector)
+{
+	if(g_countPtr != NULL_PTR)
+	{
+		g_entry[vector] = (*g_countPtr)();
+	}
+}
+
+/*
+ * Description :
+ * Keep the entry count and add its distance from the request to the latency.
+ */
+void IsrProfile_enterAt(IsrProfile_VectorType vector, uint16 request)
+{
+	IsrProfile_StatsType *stats = &g_stats[vector];
+	uint16 latency;
+
+	if(g_countPtr == NULL_PTR)
+	{
+		return;
+	}
+	g_entry[vector] = (*g_countPtr)();
+
+	latency = IsrProfile_elapsed(request, g_entry[vector]);
+	stats->latency_runs++;
+	stats->latency_total_us += latency;
+	if(latency < stats->latency_min_us)
+	{
+		stats->latency_min_us = latency;
+	}
+	if(latency > stats->latency_max_us)
+	{
+		stats->latency_max_us = latency;
+	}
+}
+
+/*
+ * Description :
+ * Add the counts since the entry to the execution time.
+ */
+void IsrProfile_exit(IsrProfile_VectorType vector)
+{
+	IsrProfile_StatsType *stats = &g_stats[vector];
+	uint16 time;
+
+	if(g_countPtr == NULL_PTR)
+	{
+		return;
+	}
+	time = IsrProfile_elapsed(g_entry[vector], (*g_countPtr)());
+
+	stats->runs++;
+	stats->time_total_us += time;
+	if(time < stats->time_min_us)
+	{
+		stats->time_min_us = time;
+	}
+	if(time > stats->time_max_us)
+	{
+		stats->time_max_us = time;
+	}
+}
+
+/*
+ * Description :
+ * Copy the stats with the interrupts disabled, then scale the counts to us.
+ */
+void IsrProfile_getStats(IsrProfile_VectorType vector, IsrProfile_StatsType *Stats_Ptr)
+{
+	uint8 sreg = SREG;
+
+	if(vector >= ISR_PROFILE_VECTORS)
+	{
+		return;
+	}
+	SREG &= ~(1<<7);
+	*Stats_Ptr = g_stats[vector];
+	SREG = sreg;
+
+	Stats_Ptr->time_total_us *= g_usPerCount;
+	Stats_Ptr->time_min_us = IsrProfile_toUs(Stats_Ptr->time_min_us);
+	Stats_Ptr->time_max_us = IsrProfile_toUs(Stats_Ptr->time_max_us);
+	Stats_Ptr->latency_total_us *= g_usPerCount;
+	Stats_Ptr->latency_min_us = IsrProfile_toUs(Stats_Ptr->latency_min_us);
+	Stats_Ptr->latency_max_us = IsrProfile_toUs(Stats_Ptr->latency_max_us);
+}
+
+/*
+ * Description :
+ * Clear the stats of every vector.
+ */
+void IsrProfile_resetStats(void)
+{
+	IsrProfile_StatsType cleared = {0, 0, ISR_PROFILE_NO_MIN, 0, 0, 0, ISR_PROFILE_NO_MIN, 0};
+	uint8 sreg = SREG;
+	uint8 i;
+
+	SREG &= ~(1<<7);
+	for(i = 0; i < ISR_PROFILE_VECTORS; i++)
+	{
+		g_stats[i] = cleared;
+	}
+	SREG = sreg;
+}
+
+#endif /* ISR_PROFILE */
@@ -20,8 +20,12 @@
 #define KEYPAD_NUM_COLS                  4
 #define KEYPAD_NUM_ROWS                  4
 
-/* Keypad Port Configurations */
+/* Keypad Port Configurations, PORTB carries the SPI link when DOOR_LINK_SPI is defined */
+#ifdef DOOR_LINK_SPI
+#define KEYPAD_PORT_ID                   PORTA_ID
+#else
 #define KEYPAD_PORT_ID                   PORTB_ID
+#endif
 
 #define KEYPAD_FIRST_ROW_PIN_ID           PIN0_ID
 #define KEYPAD_FIRST_COLUMN_PIN_ID        PIN4_ID
@@ -30,6 +34,9 @@
 #define KEYPAD_BUTTON_PRESSED            LOGIC_LOW
 #define KEYPAD_BUTTON_RELEASED           LOGIC_HIGH
 
+/* Returned by KEYPAD_scanKey when no button is pressed */
+#define KEYPAD_NO_KEY                    0xFF
+
 /*******************************************************************************
  *                      	Functions Prototypes                               *
  *******************************************************************************/
@@ -40,5 +47,11 @@
  */
 uint8 KEYPAD_getPressedKey(void);
 
+/*
+ * Description :
+ * Scan the Keypad once, return the pressed button or KEYPAD_NO_KEY
+ */
+uint8 KEYPAD_scanKey(void);
+
 #endif /* KEYPAD_H_ */
 
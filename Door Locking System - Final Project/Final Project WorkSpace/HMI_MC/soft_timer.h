@@ -0,0 +1,154 @@
+ /******************************************************************************
+ *
+ * Module: Software Timer
+ *
+ * File Name: soft_timer.h
+ *
+ * Description: Header file for the software timer service. Timer1 gives a
+ *              SOFT_TIMER_TICK_MS tick and any number of one-shot or periodic
+ *              timers run on it.
+ *
+ *              The running timers are kept in a delta list sorted by expiry:
+ *              each one holds its ticks after the previous one, so only the
+ *              head is compared with the time. The tick interrupt only counts
+ *              the tick, whatever the number of timers. SoftTimer_update,
+ *              called from the main loop, calls the callbacks of the expired
+ *              timers in their expiry order, so a callback may use any driver
+ *              and start or stop timers. A periodic timer is re-armed from its
+ *              expiry time, a late main loop does not make it drift.
+ *
+ *              The tick count and the Timer1 count also give a free-running
+ *              clock: SoftTimer_millis and SoftTimer_micros, for time stamps
+ *              and latency measurements in any driver or application.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#ifndef SOFT_TIMER_H_
+#define SOFT_TIMER_H_
+
+#include "std_types.h"
+#include "timer.h"
+#include "timer_resources.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define SOFT_TIMER_TICK_MS			10
+
+/*
+ * Timer1 in CTC mode at 1 MHz: F_CPU/8 at 8 MHz, F_CPU at 1 MHz. A count is
+ * 1 us, fine enough to time an ISR (isr_profile.h)
+ */
+#if F_CPU == 8000000UL
+#define SOFT_TIMER_PRESCALER		F_CPU_8
+#define SOFT_TIMER_DIVIDER			8UL
+#elif F_CPU == 1000000UL
+#define SOFT_TIMER_PRESCALER		F_CPU_CLOCK
+#define SOFT_TIMER_DIVIDER			1UL
+#else
+#error "The soft timer counts at 1 MHz, from F_CPU = 1 or 8 MHz"
+#endif
+#define SOFT_TIMER_COMPARE_VALUE	((uint16)((F_CPU / SOFT_TIMER_DIVIDER) * SOFT_TIMER_TICK_MS / 1000UL - 1))
+
+/* Timer1 counts per ms and us per count: 1000 and 1 at 1 MHz */
+#define SOFT_TIMER_COUNTS_PER_MS	((uint16)(F_CPU / SOFT_TIMER_DIVIDER / 1000UL))
+#define SOFT_TIMER_US_PER_COUNT		((uint8)(SOFT_TIMER_DIVIDER * 1000000UL / F_CPU))
+
+/* Ticks for a time in ms or in seconds, rounded up */
+#define SOFT_TIMER_MS(ms)			((uint16)(((ms) + SOFT_TIMER_TICK_MS - 1) / SOFT_TIMER_TICK_MS))
+#define SOFT_TIMER_SECONDS(s)		SOFT_TIMER_MS((s) * 1000UL)
+
+/* Longest delay or period, 327 s: the main loop must run more often than that */
+#define SOFT_TIMER_MAX_TICKS		0x7FFF
+
+typedef struct SoftTimer{
+	struct SoftTimer *next;			/* next timer to expire */
+	uint16 delta;					/* ticks after the previous timer of the list */
+	uint16 delay;					/* ticks of the last start, for SoftTimer_restart */
+	uint16 period;					/* 0 for a one-shot timer */
+	boolean running;
+	void (*callBack)(void);
+}SoftTimer_Type;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Start Timer1 with the SOFT_TIMER_TICK_MS tick, Timer1 belongs to the
+ * service from then on. Interrupts have to be enabled by the application.
+ */
+void SoftTimer_init(void);
+
+/*
+ * Description :
+ * Set a function called from the tick interrupt, every SOFT_TIMER_TICK_MS,
+ * e.g. to post the scheduler event of the SoftTimer_update task. It runs in
+ * the ISR: it must be short.
+ */
+void SoftTimer_setTickCallBack(void(*a_ptr)(void));
+
+/*
+ * Description :
+ * Set the function called when the timer expires. To be done once, before
+ * the first start.
+ */
+void SoftTimer_setCallBack(SoftTimer_Type *timer, void(*a_ptr)(void));
+
+/*
+ * Description :
+ * Start the timer: it expires delay ticks from now, then every period ticks
+ * if period is not 0. A running timer is started again.
+ */
+void SoftTimer_start(SoftTimer_Type *timer, uint16 delay, uint16 period);
+
+/*
+ * Description :
+ * Start the timer again with the delay and period of its last start.
+ */
+void SoftTimer_restart(SoftTimer_Type *timer);
+
+/*
+ * Description :
+ * Stop the timer, its callback is not called. Nothing if it is not running.
+ */
+void SoftTimer_stop(SoftTimer_Type *timer);
+
+/*
+ * Description :
+ * Return TRUE until a one-shot timer has expired or the timer is stopped.
+ */
+boolean SoftTimer_isRunning(const SoftTimer_Type *timer);
+
+/*
+ * Description :
+ * Return the ticks left before the timer expires, 0 if it is not running.
+ */
+uint16 SoftTimer_remaining(const SoftTimer_Type *timer);
+
+/*
+ * Description :
+ * Call the callbacks of the expired timers, called from the main loop.
+ */
+void SoftTimer_update(void);
+
+/*
+ * Description :
+ * Return the ms since SoftTimer_init, wraps after 49.7 days. Safe to call from
+ * any context, interrupts are disabled for a few cycles only.
+ */
+uint32 SoftTimer_millis(void);
+
+/*
+ * Description :
+ * Return the us since SoftTimer_init with a SOFT_TIMER_US_PER_COUNT
+ * resolution, wraps after 71 minutes. Safe to call from any context, it can
+ * be given to UART_setTimeSource.
+ */
+uint32 SoftTimer_micros(void);
+
+#endif /* SOFT_TIMER_H_ */
@@ -4,13 +4,14 @@
  *
  * File Name: timer.c
  *
- * Description: Source file for Timer driver
+ * Description: Source file for Timer driver: Timer0, Timer1 and Timer2
  *
  * Author: Ahmed Hazem
  *
  *******************************************************************************/
 
 #include "timer.h"
+#include "isr_profile.h"
 #include <avr/interrupt.h>
 #include <avr/io.h>
 
@@ -19,6 +20,8 @@
  *******************************************************************************/
 /* Global variable to store the address of the callback function */
 static volatile void (*g_callBackPtr)(void) = NULL_PTR;
+static void (*volatile g_timer0CallBackPtr)(void) = NULL_PTR;
+static void (*volatile g_timer2CallBackPtr)(void) = NULL_PTR;
 
 /*******************************************************************************
  *                      	Functions Definitions                              *
@@ -26,20 +29,23 @@ static volatile void (*g_callBackPtr)(void) = NULL_PTR;
 /* Timer 1 Compare Mode Interrupt ISR */
 ISR(TIMER1_COMPA_vect)
 {
+	/* The request came at the match with OCR1A, the latency is the count since */
+	ISR_PROFILE_ENTER_AT(ISR_PROFILE_TIMER1_COMPA, OCR1A);
 	/*Increment the ticks of the program*/
 	if(g_callBackPtr != NULL_PTR){
 		(*g_callBackPtr)();
 	}
+	ISR_PROFILE_EXIT(ISR_PROFILE_TIMER1_COMPA);
 }
 
 
 /* Timer 1 Normal Mode Interrupt ISR */
 ISR(TIMER1_OVF_vect)
 {
-
+	ISR_PROFILE_ENTER(ISR_PROFILE_TIMER1_OVF);
 	/*Increment the ticks of the program*/
 	(*g_callBackPtr)();
-
+	ISR_PROFILE_EXIT(ISR_PROFILE_TIMER1_OVF);
 }
 void Timer1_init(const Timer1_ConfigType * Config_Ptr)
 {
@@ -98,3 +104,186 @@ void Timer1_setCallBack(void(*a_ptr)(void))
 	/* Assign the address of the callback function to the global variable */
 	g_callBackPtr = a_ptr;
 }
+
+uint16 Timer1_getCount(void)
+{
+	/* The 16-bit read takes the high byte from TEMP, latched with the low one */
+	return TCNT1;
+}
+
+boolean Timer1_isComparePending(void)
+{
+	return (TIFR & (1 << OCF1A)) ? TRUE : FALSE;
+}
+
+/* Timer 0 Compare Mode Interrupt ISR */
+ISR(TIMER0_COMP_vect)
+{
+	ISR_PROFILE_ENTER(ISR_PROFILE_TIMER0_COMP);
+	if(g_timer0CallBackPtr != NULL_PTR){
+		(*g_timer0CallBackPtr)();
+	}
+	ISR_PROFILE_EXIT(ISR_PROFILE_TIMER0_COMP);
+}
+
+/* Timer 0 Normal Mode Interrupt ISR */
+ISR(TIMER0_OVF_vect)
+{
+	ISR_PROFILE_ENTER(ISR_PROFILE_TIMER0_OVF);
+	if(g_timer0CallBackPtr != NULL_PTR){
+		(*g_timer0CallBackPtr)();
+	}
+	ISR_PROFILE_EXIT(ISR_PROFILE_TIMER0_OVF);
+}
+
+void Timer0_init(const Timer0_ConfigType * Config_Ptr)
+{
+	TCCR0 = 0; // Stop the timer
+	TIMSK &= ~(1 << OCIE0) & ~(1 << TOIE0);
+	TCNT0 = Config_Ptr->initial_value;	/* Set timer0 initial value */
+	OCR0 = Config_Ptr->compare_value;	/* Set timer0 compare value */
+
+	if(Config_Ptr->mode == NORMAL_MODE)
+	{
+		/* Normal Mode WGM01=0 WGM00=0, overflow interrupt */
+		TIMSK |= (1 << TOIE0);
+	}
+	else if(Config_Ptr->mode == PWM_MODE)
+	{
+		/* Phase Correct PWM Mode WGM00=1 */
+		TCCR0 |= (1 << WGM00);
+	}
+	else if(Config_Ptr->mode == COMPARE_MODE)
+	{
+		/* CTC Mode WGM01=1, compare interrupt */
+		TCCR0 |= (1 << WGM01);
+		TIMSK |= (1 << OCIE0);
+	}
+	else if(Config_Ptr->mode == FAST_PWM_MODE)
+	{
+		/* Fast PWM Mode WGM01=1 WGM00=1 */
+		TCCR0 |= (1 << WGM01) | (1 << WGM00);
+	}
+
+	/* OC0 behaviour COM01:COM00, then the clock starts the timer */
+	TCCR0 |= ((Config_Ptr->output & 0x03) << COM00);
+	TCCR0 |= (Config_Ptr->prescaler & 0x07);
+}
+
+void Timer0_deInit(void)
+{
+	/* Stop timer0 and clear its registers */
+	TCCR0 = 0;
+	TCNT0 = 0;
+	TIMSK &= ~(1 << OCIE0) & ~(1 << TOIE0);
+}
+
+void Timer0_setCallBack(void(*a_ptr)(void))
+{
+	g_timer0CallBackPtr = a_ptr;
+}
+
+/* Timer 2 Compare Mode Interrupt ISR */
+ISR(TIMER2_COMP_vect)
+{
+	ISR_PROFILE_ENTER(ISR_PROFILE_TIMER2_COMP);
+	if(g_timer2CallBackPtr != NULL_PTR){
+		(*g_timer2CallBackPtr)();
+	}
+	ISR_PROFILE_EXIT(ISR_PROFILE_TIMER2_COMP);
+}
+
+/* Timer 2 Normal Mode Interrupt ISR */
+ISR(TIMER2_OVF_vect)
+{
+	ISR_PROFILE_ENTER(ISR_PROFILE_TIMER2_OVF);
+	if(g_timer2CallBackPtr != NULL_PTR){
+		(*g_timer2CallBackPtr)();
+	}
+	ISR_PROFILE_EXIT(ISR_PROFILE_TIMER2_OVF);
+}
+
+/* TCCR2 value and TIMSK interrupt bits of a configuration, TCCR2 is written once */
+static uint8 Timer2_control(const Timer2_ConfigType * Config_Ptr, uint8 *interrupts)
+{
+	uint8 control = 0;
+
+	*interrupts = 0;
+	if(Config_Ptr->mode == NORMAL_MODE)
+	{
+		/* Normal Mode WGM21=0 WGM20=0, overflow interrupt */
+		*interrupts = (1 << TOIE2);
+	}
+	else if(Config_Ptr->mode == PWM_MODE)
+	{
+		/* Phase Correct PWM Mode WGM20=1 */
+		control |= (1 << WGM20);
+	}
+	else if(Config_Ptr->mode == COMPARE_MODE)
+	{
+		/* CTC Mode WGM21=1, compare interrupt */
+		control |= (1 << WGM21);
+		*interrupts = (1 << OCIE2);
+	}
+	else if(Config_Ptr->mode == FAST_PWM_MODE)
+	{
+		/* Fast PWM Mode WGM21=1 WGM20=1 */
+		control |= (1 << WGM21) | (1 << WGM20);
+	}
+
+	/* OC2 behaviour COM21:COM20, then the clock starts the timer */
+	control |= ((Config_Ptr->output & 0x03) << COM20);
+	control |= (Config_Ptr->prescaler & 0x07);
+	return control;
+}
+
+void Timer2_init(const Timer2_ConfigType * Config_Ptr)
+{
+	uint8 interrupts;
+	uint8 control = Timer2_control(Config_Ptr, &interrupts);
+
+	TCCR2 = 0; // Stop the timer
+	TIMSK &= ~(1 << OCIE2) & ~(1 << TOIE2);
+	TCNT2 = Config_Ptr->initial_value;	/* Set timer2 initial value */
+	OCR2 = Config_Ptr->compare_value;	/* Set timer2 compare value */
+	TIMSK |= interrupts;
+	TCCR2 = control;
+}
+
+void Timer2_initAsync(const Timer2_ConfigType * Config_Ptr)
+{
+	uint8 interrupts;
+	uint8 control = Timer2_control(Config_Ptr, &interrupts);
+
+	/* The clock source changes with the interrupts off, then each register is written once */
+	TIMSK &= ~(1 << OCIE2) & ~(1 << TOIE2);
+	ASSR |= (1 << AS2);
+	TCNT2 = Config_Ptr->initial_value;
+	OCR2 = Config_Ptr->compare_value;
+	TCCR2 = control;
+	while(ASSR & ((1 << TCN2UB) | (1 << OCR2UB) | (1 << TCR2UB)));
+
+	/* The switch may have set the flags */
+	TIFR = (1 << OCF2) | (1 << TOV2);
+	TIMSK |= interrupts;
+}
+
+void Timer2_waitAsyncUpdate(void)
+{
+	/* The write is latched on the crystal clock, as the interrupt logic is reset */
+	OCR2 = OCR2;
+	while(ASSR & ((1 << TCN2UB) | (1 << OCR2UB) | (1 << TCR2UB)));
+}
+
+void Timer2_deInit(void)
+{
+	/* Stop timer2 and clear its registers */
+	TCCR2 = 0;
+	TCNT2 = 0;
+	TIMSK &= ~(1 << OCIE2) & ~(1 << TOIE2);
+}
+
+void Timer2_setCallBack(void(*a_ptr)(void))
+{
+	g_timer2CallBackPtr = a_ptr;
+}
@@ -0,0 +1,96 @@
+ /******************************************************************************
+ *
+ * Module: Timer Resources
+ *
+ * File Name: timer_resources.h
+ *
+ * Description: Build-time assignment of the ATmega32 timers to the functions
+ *              of this MCU. Every driver using a timer takes it from here
+ *              instead of assuming it owns one, and an assignment that gives
+ *              a timer to two functions, or a function to a timer without the
+ *              required hardware, stops the build.
+ *
+ *              | Function    | Driver       | Possible timers                    |
+ *              |-------------|--------------|------------------------------------|
+ *              | System tick | soft_timer.c | Timer1 (16-bit count for micros)   |
+ *              | PWM         | pwm.c        | Timer0 (OC0/PB3), Timer2 (OC2/PD7) |
+ *              | Tone        | buzzer.c     | Timer0, Timer2                     |
+ *              | ICU         | -            | Timer1 (ICP1/PD6)                  |
+ *              | SPI gap     | spi.c        | Timer0, Timer2 (SPI master only)   |
+ *
+ *              Any of them can be set on the compiler command line, e.g.
+ *              -DPWM_TIMER=TIMER_2.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#ifndef TIMER_RESOURCES_H_
+#define TIMER_RESOURCES_H_
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* One bit per timer, so the claims can be checked by the preprocessor */
+#define TIMER_NONE			0x00
+#define TIMER_0				0x01
+#define TIMER_1				0x02
+#define TIMER_2				0x04
+
+/* Assignment of the HMI board */
+#ifndef SYSTEM_TICK_TIMER
+#define SYSTEM_TICK_TIMER	TIMER_1
+#endif
+
+/* No PWM output on this board */
+#ifndef PWM_TIMER
+#define PWM_TIMER			TIMER_NONE
+#endif
+
+/* No buzzer on this board */
+#ifndef TONE_TIMER
+#define TONE_TIMER			TIMER_NONE
+#endif
+
+/* No input capture on this board */
+#ifndef ICU_TIMER
+#define ICU_TIMER			TIMER_NONE
+#endif
+
+/* Byte gap of the SPI master, used by the DOOR_LINK_SPI build */
+#ifndef SPI_GAP_TIMER
+#define SPI_GAP_TIMER		TIMER_0
+#endif
+
+/*******************************************************************************
+ *                                 Checks                                      *
+ *******************************************************************************/
+
+/* Distinct bits add up to their OR, a timer claimed twice does not */
+#if (SYSTEM_TICK_TIMER + PWM_TIMER + TONE_TIMER + ICU_TIMER + SPI_GAP_TIMER) != \
+	(SYSTEM_TICK_TIMER | PWM_TIMER | TONE_TIMER | ICU_TIMER | SPI_GAP_TIMER)
+#error "A timer is assigned to two functions in timer_resources.h"
+#endif
+
+#if SYSTEM_TICK_TIMER != TIMER_1
+#error "The system tick needs the 16-bit Timer1"
+#endif
+
+#if PWM_TIMER != TIMER_NONE && PWM_TIMER != TIMER_0 && PWM_TIMER != TIMER_2
+#error "PWM runs on Timer0 (OC0) or Timer2 (OC2)"
+#endif
+
+#if TONE_TIMER != TIMER_NONE && TONE_TIMER != TIMER_0 && TONE_TIMER != TIMER_2
+#error "The tone runs on Timer0 or Timer2"
+#endif
+
+#if ICU_TIMER != TIMER_NONE && ICU_TIMER != TIMER_1
+#error "Input capture exists on Timer1 only"
+#endif
+
+#if SPI_GAP_TIMER != TIMER_NONE && SPI_GAP_TIMER != TIMER_0 && SPI_GAP_TIMER != TIMER_2
+#error "The SPI byte gap runs on Timer0 or Timer2"
+#endif
+
+#endif /* TIMER_RESOURCES_H_ */
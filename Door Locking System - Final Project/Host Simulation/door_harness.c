@@ -0,0 +1,475 @@
+ /******************************************************************************
+ *
+ * Module: Host Simulation - Harness
+ *
+ * File Name: door_harness.c
+ *
+ * Description: Load test of the door protocol. Starts the CTRL and HMI
+ *              firmwares as two processes joined by an emulated UART line,
+ *              creates the password, then repeats "+ <password> =" open-door
+ *              transactions and reports throughput and tail latency.
+ *
+ *              unlock latency : '=' pressed on the HMI -> "Door Opening" shown
+ *              cycle latency  : '+' pressed -> main menu shown again
+ *
+ *              With -d the CTRL link health counters are requested with the
+ *              '*' service key at the end of the run and printed, then the
+ *              scheduler stats of every CTRL task with the '0' service key.
+ *
+ *              With -t the '%' service key runs the HMI link test at the end
+ *              of the run: DOOR_LINK_TEST_MESSAGES status requests one at a
+ *              time (round trip), then pipelined (messages per second).
+ *              With -e the ON/C service key exports the CTRL event log at the
+ *              end of the run and the HMI summary is printed.
+ *              With -E the CTRL 24C16 is kept in a file across the runs and
+ *              its wear is printed at the end: write cycles, cycles of the most
+ *              written cell, and addresses refused while a cycle was running.
+ *              -C and -H select other firmware builds, e.g. the SPI ones.
+ *              -x n loses every n-th byte sent on the UART line, the door
+ *              link then recovers the lost frames with its resends.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include "sim.h"
+#include "door_link.h"
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define HARNESS_EVENT_TIMEOUT_MS    30000
+#define HARNESS_MENU_SCREEN         "+ : Open Door"
+#define HARNESS_MENU_END_SCREEN     "- : Change Pass"	/* second row, the menu is complete */
+#define HARNESS_CREATED_SCREEN      "Pass Created"
+#define HARNESS_EXISTS_SCREEN       "Pass Exists"	/* -E file from an earlier run */
+#define HARNESS_OPENING_SCREEN      "Door Opening"
+#define HARNESS_STATS_SCREEN        "HW:"
+#define HARNESS_NO_STATS_SCREEN     "No Link Stats"
+#define HARNESS_TEST_SCREEN         "Link Test"
+#define HARNESS_PING_SCREEN         "Ping Done"
+#define HARNESS_BURST_SCREEN        "Burst Done"
+#define HARNESS_EXPORT_SCREEN       "Log Export"
+#define HARNESS_EVENTS_SCREEN       "Events:"
+#define HARNESS_LOG_KEY             "\r"		/* ON/C, key code 13 */
+
+typedef struct
+{
+	uint32 transactions;
+	sint32 baud;
+	sint32 latency_us;
+	sint32 time_scale;
+	sint32 drop;
+	boolean dump_stats;
+	boolean link_test;
+	boolean export_log;
+	const char *password;
+	const char *ctrl_path;
+	const char *hmi_path;
+	const char *eeprom_path;
+}Harness_ConfigType;
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+static int g_eventFd;
+static int g_keypadFd;
+static pid_t g_ctrlPid;
+static pid_t g_hmiPid;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+static pid_t Harness_spawn(const char *path, char *const env[])
+{
+	pid_t pid = fork();
+	if(pid == 0)
+	{
+		int i;
+		for(i = 0; env[i] != NULL; i++)
+		{
+			putenv(env[i]);
+		}
+		execl(path, path, (char *)NULL);
+		perror(path);
+		_exit(EXIT_FAILURE);
+	}
+	return pid;
+}
+
+static void Harness_stop(void)
+{
+	if(g_hmiPid > 0)
+	{
+		kill(g_hmiPid, SIGTERM);
+		waitpid(g_hmiPid, NULL, 0);
+	}
+	if(g_ctrlPid > 0)
+	{
+		kill(g_ctrlPid, SIGTERM);
+		waitpid(g_ctrlPid, NULL, 0);
+	}
+}
+
+/*
+ * Read events until one contains the required text, return its time stamp.
+ * The matching line is copied to line_out if it is not NULL.
+ */
+static uint64 Harness_waitEvent(const char *text, char *line_out, size_t size)
+{
+	static char buffer[512];
+	static size_t used = 0;
+	struct pollfd pfd;
+	char *newline;
+	ssize_t count;
+
+	pfd.fd = g_eventFd;
+	pfd.events = POLLIN;
+
+	while(1)
+	{
+		/* Consume every complete line already received */
+		while((newline = memchr(buffer, '\n', used)) != NULL)
+		{
+			uint64 stamp = 0;
+			boolean match;
+
+			*newline = '\0';
+			match = (strstr(buffer, text) != NULL);
+			if(match)
+			{
+				stamp = strtoull(buffer, NULL, 10);
+				if(line_out != NULL && size > 0)
+				{
+					size_t length = strlen(buffer);
+					length = (length < size) ? length : size - 1;
+					memcpy(line_out, buffer, length);
+					line_out[length] = '\0';
+				}
+			}
+			used -= (newline + 1) - buffer;
+			memmove(buffer, newline + 1, used);
+			if(match)
+			{
+				return stamp;
+			}
+		}
+
+		if(poll(&pfd, 1, HARNESS_EVENT_TIMEOUT_MS) <= 0)
+		{
+			fprintf(stderr, "timeout waiting for \"%s\"\n", text);
+			Harness_stop();
+			exit(EXIT_FAILURE);
+		}
+		count = read(g_eventFd, buffer + used, sizeof(buffer) - used);
+		if(count <= 0)
+		{
+			fprintf(stderr, "firmware exited while waiting for \"%s\"\n", text);
+			Harness_stop();
+			exit(EXIT_FAILURE);
+		}
+		used += count;
+	}
+}
+
+/*
+ * Press the keys of a script: digits map to their numeric key codes.
+ */
+static void Harness_pressKeys(const char *keys)
+{
+	uint8 key;
+	while(*keys != '\0')
+	{
+		key = (*keys >= '0' && *keys <= '9') ? (uint8)(*keys - '0') : (uint8)*keys;
+		if(write(g_keypadFd, &key, 1) != 1)
+		{
+			perror("keypad");
+			exit(EXIT_FAILURE);
+		}
+		keys++;
+	}
+}
+
+static int Harness_compare(const void *a, const void *b)
+{
+	uint64 x = *(const uint64 *)a;
+	uint64 y = *(const uint64 *)b;
+	return (x > y) - (x < y);
+}
+
+static void Harness_report(const char *name, uint64 *samples, uint32 count)
+{
+	qsort(samples, count, sizeof(uint64), Harness_compare);
+	printf("%-16s p50 %9.3f ms  p90 %9.3f ms  p99 %9.3f ms  max %9.3f ms\n", name,
+		   samples[count * 50 / 100] / 1e6,
+		   samples[count * 90 / 100] / 1e6,
+		   samples[count * 99 / 100] / 1e6,
+		   samples[count - 1] / 1e6);
+}
+
+/*
+ * Print the wear of the emulated EEPROM from its file, all the runs included.
+ */
+static void Harness_reportEeprom(const char *path)
+{
+	const Sim_EepromFileType *device;
+	uint64 total = 0;
+	uint32 worst = 0;
+	uint16 used = 0;
+	uint16 i;
+	int fd = open(path, O_RDONLY);
+
+	device = (fd < 0) ? MAP_FAILED : mmap(NULL, sizeof(Sim_EepromFileType), PROT_READ, MAP_SHARED, fd, 0);
+	if(fd >= 0)
+	{
+		close(fd);
+	}
+	if(device == MAP_FAILED)
+	{
+		perror(path);
+		return;
+	}
+
+	for(i = 0; i < SIM_EEPROM_SIZE; i++)
+	{
+		total += device->cell_writes[i];
+		used += (device->cell_writes[i] != 0);
+		if(device->cell_writes[i] > device->cell_writes[worst])
+		{
+			worst = i;
+		}
+	}
+	printf("eeprom           %lu write cycles, %lu busy NACKs, %lu transactions\n",
+		   (unsigned long)device->write_cycles, (unsigned long)device->busy_nacks,
+		   (unsigned long)device->transactions);
+	printf("eeprom wear      max %lu cycles at 0x%03X, mean %.2f over %u written cells\n",
+		   (unsigned long)device->cell_writes[worst], (unsigned)worst,
+		   (used != 0) ? (double)total / used : 0.0, (unsigned)used);
+	munmap((void *)device, sizeof(Sim_EepromFileType));
+}
+
+static void Harness_usage(const char *name)
+{
+	fprintf(stderr,
+			"usage: %s [-n transactions] [-b baud|0] [-l latency-us] [-s time-scale] [-p password] [-d] [-t] [-e]\n"
+			"          [-x drop-period] [-E eeprom-file] [-C ctrl-firmware] [-H hmi-firmware]\n"
+			"  -b 0 runs the link unthrottled, -b 9600 emulates the firmware line rate\n"
+			"     (the SPI builds shape the bus at their SCK rate for any value but 0)\n"
+			"  -d dumps the CTRL link health counters and task stats at the end of the run\n"
+			"  -t runs the HMI link test at the end of the run\n"
+			"  -e exports the CTRL event log at the end of the run\n"
+			"  -x n loses every n-th byte sent on the UART line (UART builds)\n"
+			"  -E keeps the CTRL EEPROM in a file and prints its wear\n",
+			name);
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+	Harness_ConfigType config = {20, 0, 0, 1000, 0, FALSE, FALSE, FALSE, "12345", "./ctrl_sim", "./hmi_sim", NULL};
+	int uart[2], keypad[2], events[2];
+	char env_line[8][48];
+	char *ctrl_env[7], *hmi_env[8];
+	char *eeprom_line = NULL;
+	char keys[32];
+	char line[160];
+	uint64 *unlock, *cycle, start, begin, end;
+	uint32 i;
+	int opt;
+
+	while((opt = getopt(argc, argv, "n:b:l:s:p:dtex:E:C:H:")) != -1)
+	{
+		switch(opt)
+		{
+		case 'n': config.transactions = strtoul(optarg, NULL, 0); break;
+		case 'b': config.baud = strtol(optarg, NULL, 0); break;
+		case 'l': config.latency_us = strtol(optarg, NULL, 0); break;
+		case 's': config.time_scale = strtol(optarg, NULL, 0); break;
+		case 'p': config.password = optarg; break;
+		case 'd': config.dump_stats = TRUE; break;
+		case 't': config.link_test = TRUE; break;
+		case 'e': config.export_log = TRUE; break;
+		case 'x': config.drop = strtol(optarg, NULL, 0); break;
+		case 'E': config.eeprom_path = optarg; break;
+		case 'C': config.ctrl_path = optarg; break;
+		case 'H': config.hmi_path = optarg; break;
+		default: Harness_usage(argv[0]);
+		}
+	}
+	if(config.transactions == 0 || strlen(config.password) != 5)
+	{
+		Harness_usage(argv[0]);
+	}
+
+	if(socketpair(AF_UNIX, SOCK_STREAM, 0, uart) != 0 || pipe(keypad) != 0 || pipe(events) != 0)
+	{
+		perror("harness");
+		return EXIT_FAILURE;
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	/* Both MCUs share the link and time settings, each owns one end of the line */
+	snprintf(env_line[0], sizeof(env_line[0]), "%s=%ld", SIM_ENV_LINK_BAUD, (long)config.baud);
+	snprintf(env_line[1], sizeof(env_line[1]), "%s=%ld", SIM_ENV_LINK_LATENCY, (long)config.latency_us);
+	snprintf(env_line[2], sizeof(env_line[2]), "%s=%ld", SIM_ENV_TIME_SCALE, (long)config.time_scale);
+	snprintf(env_line[3], sizeof(env_line[3]), "%s=%d", SIM_ENV_UART_FD, uart[0]);
+	snprintf(env_line[4], sizeof(env_line[4]), "%s=%d", SIM_ENV_UART_FD, uart[1]);
+	snprintf(env_line[5], sizeof(env_line[5]), "%s=%d", SIM_ENV_KEYPAD_FD, keypad[0]);
+	snprintf(env_line[6], sizeof(env_line[6]), "%s=%d", SIM_ENV_EVENT_FD, events[1]);
+	snprintf(env_line[7], sizeof(env_line[7]), "%s=%ld", SIM_ENV_LINK_DROP, (long)config.drop);
+
+	ctrl_env[0] = env_line[0];
+	ctrl_env[1] = env_line[1];
+	ctrl_env[2] = env_line[2];
+	ctrl_env[3] = env_line[3];
+	ctrl_env[4] = env_line[7];
+	ctrl_env[5] = NULL;
+	if(config.eeprom_path != NULL)
+	{
+		/* Any path length */
+		eeprom_line = malloc(strlen(SIM_ENV_EEPROM_FILE) + strlen(config.eeprom_path) + 2);
+		sprintf(eeprom_line, "%s=%s", SIM_ENV_EEPROM_FILE, config.eeprom_path);
+		ctrl_env[5] = eeprom_line;
+		ctrl_env[6] = NULL;
+	}
+	g_ctrlPid = Harness_spawn(config.ctrl_path, ctrl_env);
+
+	hmi_env[0] = env_line[0];
+	hmi_env[1] = env_line[1];
+	hmi_env[2] = env_line[2];
+	hmi_env[3] = env_line[4];
+	hmi_env[4] = env_line[5];
+	hmi_env[5] = env_line[6];
+	hmi_env[6] = env_line[7];
+	hmi_env[7] = NULL;
+	g_hmiPid = Harness_spawn(config.hmi_path, hmi_env);
+
+	close(uart[0]);
+	close(uart[1]);
+	close(keypad[0]);
+	close(events[1]);
+	g_keypadFd = keypad[1];
+	g_eventFd = events[0];
+
+	unlock = malloc(config.transactions * sizeof(uint64));
+	cycle = malloc(config.transactions * sizeof(uint64));
+
+	/* Create the password: enter it, confirm it. A CTRL EEPROM kept by -E already holds it */
+	snprintf(keys, sizeof(keys), "%s=%s=", config.password, config.password);
+	Harness_pressKeys(keys);
+	do
+	{
+		Harness_waitEvent("LCD ", line, sizeof(line));
+	}while(strstr(line, HARNESS_CREATED_SCREEN) == NULL && strstr(line, HARNESS_EXISTS_SCREEN) == NULL);
+	Harness_waitEvent(HARNESS_MENU_SCREEN, NULL, 0);
+
+	snprintf(keys, sizeof(keys), "+%s=", config.password);
+	begin = Sim_nowNs();
+	for(i = 0; i < config.transactions; i++)
+	{
+		start = Sim_nowNs();
+		Harness_pressKeys(keys);
+		unlock[i] = Harness_waitEvent("KEY =", NULL, 0);
+		unlock[i] = Harness_waitEvent(HARNESS_OPENING_SCREEN, NULL, 0) - unlock[i];
+		cycle[i] = Harness_waitEvent(HARNESS_MENU_SCREEN, NULL, 0) - start;
+	}
+	end = Sim_nowNs();
+
+	printf("%s + %s, link %s, latency %ld us, time scale x%ld\n", config.hmi_path, config.ctrl_path,
+		   (config.baud > 0) ? "shaped" : "unthrottled", (long)config.latency_us, (long)config.time_scale);
+	if(config.drop > 0)
+	{
+		printf("1 UART byte in %ld lost\n", (long)config.drop);
+	}
+	if(config.baud > 0)
+	{
+		printf("baud %ld (UART builds)\n", (long)config.baud);
+	}
+	printf("transactions     %lu in %.3f s = %.2f tx/s\n", (unsigned long)config.transactions,
+		   (end - begin) / 1e9, config.transactions / ((end - begin) / 1e9));
+	Harness_report("unlock latency", unlock, config.transactions);
+	Harness_report("cycle latency", cycle, config.transactions);
+
+	if(config.dump_stats)
+	{
+		char previous[160];
+		Harness_pressKeys("*");
+		/* The SPI builds have no UART counters to show */
+		do
+		{
+			Harness_waitEvent("LCD ", line, sizeof(line));
+		}while(strstr(line, HARNESS_STATS_SCREEN) == NULL && strstr(line, HARNESS_NO_STATS_SCREEN) == NULL);
+		if(strstr(line, HARNESS_STATS_SCREEN) != NULL)
+		{
+			/* The high-water value is written right after its label */
+			Harness_waitEvent("LCD ", line, sizeof(line));
+			printf("CTRL link stats  %s\n", strstr(line, "LCD ") + 4);
+		}
+		else
+		{
+			printf("CTRL link stats  none on this link\n");
+		}
+
+		/* A task screen is complete when the LCD is cleared for the next one or the menu */
+		Harness_waitEvent(HARNESS_MENU_END_SCREEN, NULL, 0);
+		Harness_pressKeys("0");
+		line[0] = '\0';
+		do
+		{
+			strcpy(previous, line);
+			Harness_waitEvent("LCD ", line, sizeof(line));
+			if(strstr(previous, "LCD T") != NULL && strstr(line, "LCD T") == NULL)
+			{
+				printf("CTRL task stats  %s\n", strstr(previous, "LCD ") + 4);
+			}
+		}while(strstr(line, HARNESS_MENU_END_SCREEN) == NULL);
+	}
+
+	if(config.link_test)
+	{
+		uint64 ping, burst;
+		Harness_pressKeys("%");
+		start = Harness_waitEvent(HARNESS_TEST_SCREEN, NULL, 0);
+		ping = Harness_waitEvent(HARNESS_PING_SCREEN, NULL, 0);
+		burst = Harness_waitEvent(HARNESS_BURST_SCREEN, NULL, 0);
+		printf("link round trip  %9.3f ms (%d requests one at a time)\n",
+			   (ping - start) / 1e6 / DOOR_LINK_TEST_MESSAGES, DOOR_LINK_TEST_MESSAGES);
+		printf("link throughput  %9.1f msg/s (%d requests in flight)\n",
+			   DOOR_LINK_TEST_MESSAGES / ((burst - ping) / 1e9), DOOR_LINK_MAX_OUTSTANDING);
+	}
+
+	if(config.export_log)
+	{
+		uint64 export_end;
+		Harness_pressKeys(HARNESS_LOG_KEY);
+		start = Harness_waitEvent(HARNESS_EXPORT_SCREEN, NULL, 0);
+		export_end = Harness_waitEvent(HARNESS_EVENTS_SCREEN, NULL, 0);
+		/* The alarm count is written last on the second row */
+		Harness_waitEvent(" A:", NULL, 0);
+		Harness_waitEvent("LCD ", line, sizeof(line));
+		printf("event log export %9.3f ms, HMI shows %s\n", (export_end - start) / 1e6, strstr(line, "LCD ") + 4);
+	}
+
+	Harness_stop();
+	if(config.eeprom_path != NULL)
+	{
+		Harness_reportEeprom(config.eeprom_path);
+	}
+	free(eeprom_line);
+	free(unlock);
+	free(cycle);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,23 @@
+ /******************************************************************************
+ *
+ * Module: Host Simulation
+ *
+ * File Name: avr/interrupt.h
+ *
+ * Description: Host stand-in for <avr/interrupt.h>. Interrupt handlers become
+ *              ordinary functions which the simulated peripherals call from
+ *              their own threads.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#ifndef SIM_AVR_INTERRUPT_H_
+#define SIM_AVR_INTERRUPT_H_
+
+#define ISR(vector)     void vector(void)
+
+#define sei()
+#define cli()
+
+#endif /* SIM_AVR_INTERRUPT_H_ */
@@ -0,0 +1,64 @@
+ /******************************************************************************
+ *
+ * Module: Host Simulation
+ *
+ * File Name: avr/io.h
+ *
+ * Description: Host stand-in for <avr/io.h>. The ATmega32 I/O registers used
+ *              by the drivers that are compiled unchanged for the host are
+ *              plain memory variables defined in sim_io.c.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#ifndef SIM_AVR_IO_H_
+#define SIM_AVR_IO_H_
+
+#include <stdint.h>
+
+/*******************************************************************************
+ *                            Emulated Registers                               *
+ *******************************************************************************/
+
+extern volatile uint8_t SREG;
+
+extern volatile uint8_t DDRA, PORTA, PINA;
+extern volatile uint8_t DDRB, PORTB, PINB;
+extern volatile uint8_t DDRC, PORTC, PINC;
+extern volatile uint8_t DDRD, PORTD, PIND;
+
+/* Timer0 (settings kept by sim_timer.c) */
+extern volatile uint8_t TCCR0, TCNT0, OCR0;
+
+/* Timer2 in asynchronous mode (rtc.c), the update busy flags of ASSR stay clear */
+extern volatile uint8_t TCNT2, ASSR, TIFR;
+
+/* RC oscillator calibration (osccal.c), no effect on the host clock */
+extern volatile uint8_t OSCCAL;
+
+/*******************************************************************************
+ *                               Register Bits                                 *
+ *******************************************************************************/
+
+/* TCCR0 */
+#define FOC0    7
+#define WGM00   6
+#define COM01   5
+#define COM00   4
+#define WGM01   3
+#define CS02    2
+#define CS01    1
+#define CS00    0
+
+/* ASSR */
+#define AS2     3
+#define TCN2UB  2
+#define OCR2UB  1
+#define TCR2UB  0
+
+/* TIFR */
+#define OCF2    7
+#define TOV2    6
+
+#endif /* SIM_AVR_IO_H_ */
@@ -0,0 +1,20 @@
+ /******************************************************************************
+ *
+ * Module: Host Simulation
+ *
+ * File Name: util/delay.h
+ *
+ * Description: Host stand-in for <util/delay.h>. The delays sleep instead of
+ *              burning cycles and are divided by SIM_TIME_SCALE (sim_clock.c).
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#ifndef SIM_UTIL_DELAY_H_
+#define SIM_UTIL_DELAY_H_
+
+void _delay_ms(double ms);
+void _delay_us(double us);
+
+#endif /* SIM_UTIL_DELAY_H_ */
@@ -0,0 +1,100 @@
+ /******************************************************************************
+ *
+ * Module: Host Simulation
+ *
+ * File Name: sim.h
+ *
+ * Description: Common services of the host simulation: clock, time scaling,
+ *              environment configuration and the event channel to the harness.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Environment variables set by the harness for every firmware process:
+ * SIM_UART_FD      : socket carrying the emulated UART line (one end per MCU).
+ * SIM_KEYPAD_FD    : pipe the scripted key presses are read from (HMI only).
+ * SIM_EVENT_FD     : pipe the LCD and keypad events are reported on (HMI only).
+ * SIM_LINK_BAUD    : line rate emulated by the shaper, 0 runs unthrottled.
+ * SIM_LINK_LATENCY : one-way propagation delay added to every byte in us.
+ * SIM_LINK_DROP    : every SIM_LINK_DROP-th byte sent on the UART is lost on
+ *                    the line, as after a framing error. 0 loses none.
+ * SIM_TIME_SCALE   : speed-up applied to timers and _delay_ms(), 1 is real time.
+ * SIM_EEPROM_FILE  : file backing the CTRL 24C16 (Sim_EepromFileType), kept
+ *                    between runs. Without it the memory starts erased.
+ */
+#define SIM_ENV_UART_FD         "SIM_UART_FD"
+#define SIM_ENV_KEYPAD_FD       "SIM_KEYPAD_FD"
+#define SIM_ENV_EVENT_FD        "SIM_EVENT_FD"
+#define SIM_ENV_LINK_BAUD       "SIM_LINK_BAUD"
+#define SIM_ENV_LINK_LATENCY    "SIM_LINK_LATENCY"
+#define SIM_ENV_LINK_DROP       "SIM_LINK_DROP"
+#define SIM_ENV_TIME_SCALE      "SIM_TIME_SCALE"
+#define SIM_ENV_EEPROM_FILE     "SIM_EEPROM_FILE"
+
+#define SIM_NO_FD               (-1)
+
+/* 24C16 emulated on the CTRL TWI bus */
+#define SIM_EEPROM_SIZE         2048
+#define SIM_EEPROM_PAGE_SIZE    16
+#define SIM_EEPROM_WRITE_NS     5000000ULL	/* write cycle, divided by SIM_TIME_SCALE */
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+
+/* Layout of SIM_EEPROM_FILE, the counters add up over the runs */
+typedef struct
+{
+	uint8 memory[SIM_EEPROM_SIZE];
+	uint32 cell_writes[SIM_EEPROM_SIZE];	/* write cycles of every cell */
+	uint32 write_cycles;					/* byte or page writes */
+	uint32 busy_nacks;						/* addresses refused during a write cycle */
+	uint32 transactions;
+}Sim_EepromFileType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Return the host monotonic clock in nano-seconds.
+ */
+uint64 Sim_nowNs(void);
+
+/*
+ * Description :
+ * Sleep until the monotonic clock reaches the required time stamp.
+ */
+void Sim_sleepUntilNs(uint64 deadline);
+
+/*
+ * Description :
+ * Read a numeric environment variable, return the default value if it is not set.
+ */
+sint32 Sim_getEnv(const char *name, sint32 default_value);
+
+/*
+ * Description :
+ * Return the firmware time speed-up factor (SIM_TIME_SCALE, at least 1).
+ */
+uint32 Sim_timeScale(void);
+
+/*
+ * Description :
+ * Report one event line "<time-ns> <text>" to the harness, if it listens.
+ */
+void Sim_event(const char *format, ...);
+
+#endif /* SIM_H_ */
@@ -0,0 +1,113 @@
+ /******************************************************************************
+ *
+ * Module: Host Simulation
+ *
+ * File Name: sim_clock.c
+ *
+ * Description: Clock, time scaling, configuration and event services of the
+ *              host simulation, plus the <util/delay.h> replacements.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include "sim.h"
+#include <util/delay.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+static pthread_mutex_t g_eventLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+uint64 Sim_nowNs(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64)now.tv_sec * 1000000000ULL + (uint64)now.tv_nsec;
+}
+
+void Sim_sleepUntilNs(uint64 deadline)
+{
+	struct timespec until;
+	until.tv_sec = deadline / 1000000000ULL;
+	until.tv_nsec = deadline % 1000000000ULL;
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) != 0);
+}
+
+sint32 Sim_getEnv(const char *name, sint32 default_value)
+{
+	const char *value = getenv(name);
+	if(value == NULL || *value == '\0')
+	{
+		return default_value;
+	}
+	return (sint32)strtol(value, NULL, 0);
+}
+
+uint32 Sim_timeScale(void)
+{
+	static uint32 scale = 0;
+	if(scale == 0)
+	{
+		sint32 value = Sim_getEnv(SIM_ENV_TIME_SCALE, 1);
+		scale = (value < 1) ? 1 : (uint32)value;
+	}
+	return scale;
+}
+
+void Sim_event(const char *format, ...)
+{
+	static int fd = -2;
+	char line[128];
+	int length;
+	va_list args;
+
+	if(fd == -2)
+	{
+		fd = Sim_getEnv(SIM_ENV_EVENT_FD, SIM_NO_FD);
+	}
+	if(fd == SIM_NO_FD)
+	{
+		return;
+	}
+
+	length = snprintf(line, sizeof(line), "%llu ", (unsigned long long)Sim_nowNs());
+	va_start(args, format);
+	length += vsnprintf(line + length, sizeof(line) - length - 1, format, args);
+	va_end(args);
+	if(length > (int)sizeof(line) - 2)
+	{
+		length = sizeof(line) - 2;
+	}
+	line[length++] = '\n';
+
+	/* One write per line, so lines from different threads never interleave */
+	pthread_mutex_lock(&g_eventLock);
+	if(write(fd, line, length) < 0)
+	{
+		fd = SIM_NO_FD;
+	}
+	pthread_mutex_unlock(&g_eventLock);
+}
+
+void _delay_ms(double ms)
+{
+	Sim_sleepUntilNs(Sim_nowNs() + (uint64)(ms * 1000000.0) / Sim_timeScale());
+}
+
+void _delay_us(double us)
+{
+	Sim_sleepUntilNs(Sim_nowNs() + (uint64)(us * 1000.0) / Sim_timeScale());
+}
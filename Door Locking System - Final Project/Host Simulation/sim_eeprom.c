@@ -0,0 +1,202 @@
+ /******************************************************************************
+ *
+ * Module: Host Simulation - External EEPROM
+ *
+ * File Name: sim_eeprom.c
+ *
+ * Description: Host implementation of the twi.h master API with a 24C16 on
+ *              the bus, so the CTRL external_eeprom.c runs unchanged. The
+ *              memory is a memory-mapped SIM_EEPROM_FILE, or an erased RAM
+ *              copy without it. Like the device:
+ *              - the 8 blocks of 256 bytes answer at 0x50..0x57,
+ *              - a write wraps at the end of its 16-byte page,
+ *              - a read rolls over from the last byte to the first,
+ *              - the address is refused (NACK) during the write cycle that
+ *                follows a write.
+ *              Every transaction takes its bus time at the SCL frequency given
+ *              to TWI_init; bus and write cycle times are divided by
+ *              SIM_TIME_SCALE like the firmware delays. The file counts the
+ *              write cycles of every cell. No supervisory MCU reads the slave
+ *              registers on the host.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include "twi.h"
+#include "sim.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define SIM_EEPROM_BUS_ADDRESS	0x50	/* A2..A0 of the 7-bit address select the block */
+#define SIM_EEPROM_BLOCK_MASK	0x07
+
+/* SCL periods of a start, an address or data byte with its ACK, and a stop */
+#define SIM_TWI_START_BITS		1
+#define SIM_TWI_BYTE_BITS		9
+#define SIM_TWI_STOP_BITS		1
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+static Sim_EepromFileType *g_device = NULL;
+static uint32 g_sclFrequency = 0;
+static uint16 g_pointer = 0;		/* Internal address counter */
+static uint64 g_busyUntil = 0;		/* End of the write cycle */
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/* Map SIM_EEPROM_FILE, a new file starts erased. Without the file the memory is private */
+static void Sim_eepromOpen(void)
+{
+	const char *path = getenv(SIM_ENV_EEPROM_FILE);
+	struct stat info;
+	boolean fresh = TRUE;
+	int fd;
+
+	if(path != NULL && *path != '\0')
+	{
+		fd = open(path, O_RDWR | O_CREAT, 0644);
+		if(fd < 0 || fstat(fd, &info) != 0)
+		{
+			exit(EXIT_FAILURE);
+		}
+		fresh = (info.st_size != (off_t)sizeof(Sim_EepromFileType));
+		if(fresh && ftruncate(fd, sizeof(Sim_EepromFileType)) != 0)
+		{
+			exit(EXIT_FAILURE);
+		}
+		g_device = mmap(NULL, sizeof(Sim_EepromFileType), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+	}
+	else
+	{
+		g_device = mmap(NULL, sizeof(Sim_EepromFileType), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	}
+	if(g_device == MAP_FAILED)
+	{
+		exit(EXIT_FAILURE);
+	}
+
+	if(fresh)
+	{
+		/* The cells of a new 24C16 read 0xFF */
+		memset(g_device, 0, sizeof(Sim_EepromFileType));
+		memset(g_device->memory, 0xFF, SIM_EEPROM_SIZE);
+	}
+}
+
+/* Occupy the bus for the given number of SCL periods */
+static void Sim_twiBusTime(uint32 bits)
+{
+	Sim_sleepUntilNs(Sim_nowNs() + (bits * 1000000000ULL / g_sclFrequency) / Sim_timeScale());
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+void TWI_init(const TWI_ConfigType * Config_Ptr)
+{
+	g_sclFrequency = (Config_Ptr->scl_frequency != 0 && TWI_SCL_IS_POSSIBLE(Config_Ptr->scl_frequency)) ?
+					 Config_Ptr->scl_frequency : 0;
+	if(g_device == NULL)
+	{
+		Sim_eepromOpen();
+	}
+}
+
+uint32 TWI_getFrequency(void)
+{
+	return g_sclFrequency;
+}
+
+void TWI_setSlaveMap(const TWI_SlaveMapType *Map_Ptr)
+{
+	(void)Map_Ptr;
+}
+
+uint16 TWI_getRecoveryCount(void)
+{
+	/* The emulated bus never hangs */
+	return 0;
+}
+
+TWI_ResultType TWI_transfer(uint8 address, const uint8 *tx_data, uint8 tx_length, uint8 *rx_data, uint8 rx_length)
+{
+	uint16 page;
+	uint8 i;
+
+	if(g_sclFrequency == 0)
+	{
+		return TWI_BUS_FAULT;
+	}
+	g_device->transactions++;
+
+	/* Nobody else on the bus, and the memory ignores its address during a write cycle */
+	if((address & ~SIM_EEPROM_BLOCK_MASK) != SIM_EEPROM_BUS_ADDRESS || Sim_nowNs() < g_busyUntil)
+	{
+		if((address & ~SIM_EEPROM_BLOCK_MASK) == SIM_EEPROM_BUS_ADDRESS)
+		{
+			g_device->busy_nacks++;
+		}
+		Sim_twiBusTime(SIM_TWI_START_BITS + SIM_TWI_BYTE_BITS + SIM_TWI_STOP_BITS);
+		return TWI_ADDRESS_NACK;
+	}
+
+	if(tx_length != 0)
+	{
+		/* The word address, then the data bytes wrap inside the page */
+		g_pointer = ((uint16)(address & SIM_EEPROM_BLOCK_MASK) << 8) | tx_data[0];
+		page = g_pointer & ~(SIM_EEPROM_PAGE_SIZE - 1);
+		for(i = 1; i < tx_length; i++)
+		{
+			g_device->memory[g_pointer] = tx_data[i];
+			g_device->cell_writes[g_pointer]++;
+			g_pointer = page | ((g_pointer + 1) & (SIM_EEPROM_PAGE_SIZE - 1));
+		}
+	}
+	for(i = 0; i < rx_length; i++)
+	{
+		rx_data[i] = g_device->memory[g_pointer];
+		g_pointer = (g_pointer + 1) % SIM_EEPROM_SIZE;
+	}
+
+	Sim_twiBusTime(SIM_TWI_START_BITS + SIM_TWI_BYTE_BITS * (1 + tx_length) +
+				   ((rx_length != 0 && tx_length != 0) ? SIM_TWI_START_BITS + SIM_TWI_BYTE_BITS : 0) +
+				   SIM_TWI_BYTE_BITS * rx_length + SIM_TWI_STOP_BITS);
+
+	/* Data written: the write cycle starts at the stop condition */
+	if(tx_length > 1)
+	{
+		g_device->write_cycles++;
+		g_busyUntil = Sim_nowNs() + SIM_EEPROM_WRITE_NS / Sim_timeScale();
+	}
+	return TWI_OK;
+}
+
+TWI_ResultType TWI_writeBuffer(uint8 address, const uint8 *data, uint8 length)
+{
+	return TWI_transfer(address, data, length, NULL_PTR, 0);
+}
+
+TWI_ResultType TWI_readBuffer(uint8 address, uint8 *data, uint8 length)
+{
+	return TWI_transfer(address, NULL_PTR, 0, data, length);
+}
+
+TWI_ResultType TWI_writeThenRead(uint8 address, const uint8 *tx_data, uint8 tx_length, uint8 *rx_data, uint8 rx_length)
+{
+	return TWI_transfer(address, tx_data, tx_length, rx_data, rx_length);
+}
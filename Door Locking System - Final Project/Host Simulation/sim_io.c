@@ -0,0 +1,30 @@
+ /******************************************************************************
+ *
+ * Module: Host Simulation
+ *
+ * File Name: sim_io.c
+ *
+ * Description: Storage of the emulated ATmega32 I/O registers (see avr/io.h).
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include <avr/io.h>
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+volatile uint8_t SREG;
+
+volatile uint8_t DDRA, PORTA, PINA;
+volatile uint8_t DDRB, PORTB, PINB;
+volatile uint8_t DDRC, PORTC, PINC;
+volatile uint8_t DDRD, PORTD, PIND;
+
+volatile uint8_t TCCR0, TCNT0, OCR0;
+
+volatile uint8_t TCNT2, ASSR, TIFR;
+
+volatile uint8_t OSCCAL;
@@ -0,0 +1,76 @@
+ /******************************************************************************
+ *
+ * Module: Host Simulation - Keypad
+ *
+ * File Name: sim_keypad.c
+ *
+ * Description: Host implementation of the keypad.h API. Key presses are read
+ *              from the harness script pipe and reported back as events.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include "keypad.h"
+#include "sim.h"
+#include <stdlib.h>
+#include <unistd.h>
+#include <poll.h>
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/* Read one key, a blocking read unless wait is FALSE; KEYPAD_NO_KEY if none is ready */
+static uint8 KEYPAD_readKey(boolean wait)
+{
+	static int fd = -2;
+	struct pollfd pfd;
+	uint8 key;
+
+	if(fd == -2)
+	{
+		fd = Sim_getEnv(SIM_ENV_KEYPAD_FD, SIM_NO_FD);
+	}
+
+	if(!wait && fd != SIM_NO_FD)
+	{
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		if(poll(&pfd, 1, 0) <= 0)
+		{
+			return KEYPAD_NO_KEY;
+		}
+	}
+
+	/* End of the script ends the firmware */
+	if(fd == SIM_NO_FD || read(fd, &key, 1) != 1)
+	{
+		exit(EXIT_SUCCESS);
+	}
+
+	if(key <= 9)
+	{
+		Sim_event("KEY %u", key);
+	}
+	else
+	{
+		Sim_event("KEY %c", key);
+	}
+	return key;
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+uint8 KEYPAD_getPressedKey(void)
+{
+	return KEYPAD_readKey(TRUE);
+}
+
+/* A key the script has already sent counts as pressed */
+uint8 KEYPAD_scanKey(void)
+{
+	return KEYPAD_readKey(FALSE);
+}
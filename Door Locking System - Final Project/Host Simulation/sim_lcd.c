@@ -0,0 +1,114 @@
+ /******************************************************************************
+ *
+ * Module: Host Simulation - LCD
+ *
+ * File Name: sim_lcd.c
+ *
+ * Description: Host implementation of the lcd.h API. A 2x16 character buffer
+ *              is kept and reported to the harness as "LCD <row0>|<row1>"
+ *              after every visible change.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include "lcd.h"
+#include "sim.h"
+#include <stdio.h>
+#include <string.h>
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define SIM_LCD_ROWS    2
+#define SIM_LCD_COLS    16
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+static char g_screen[SIM_LCD_ROWS][SIM_LCD_COLS + 1];
+static uint8 g_row = 0;
+static uint8 g_col = 0;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+static void LCD_putCharacter(uint8 data)
+{
+	if(g_row < SIM_LCD_ROWS && g_col < SIM_LCD_COLS)
+	{
+		g_screen[g_row][g_col] = (char)data;
+	}
+	g_col++;
+}
+
+static void LCD_report(void)
+{
+	Sim_event("LCD %s|%s", g_screen[0], g_screen[1]);
+}
+
+void LCD_init(void)
+{
+	LCD_clearScreen();
+}
+
+void LCD_sendCommand(uint8 command)
+{
+	if(command == LCD_CLEAR_COMMAND)
+	{
+		memset(g_screen, ' ', sizeof(g_screen));
+		g_screen[0][SIM_LCD_COLS] = '\0';
+		g_screen[1][SIM_LCD_COLS] = '\0';
+		g_row = 0;
+		g_col = 0;
+		LCD_report();
+	}
+	else if(command & LCD_SET_CURSOR_LOCATION)
+	{
+		g_row = (command & 0x40) ? 1 : 0;
+		g_col = command & 0x0F;
+	}
+}
+
+void LCD_displayCharacter(uint8 data)
+{
+	LCD_putCharacter(data);
+	LCD_report();
+}
+
+void LCD_displayString(const char *Str)
+{
+	while(*Str != '\0')
+	{
+		LCD_putCharacter(*Str);
+		Str++;
+	}
+	LCD_report();
+}
+
+void LCD_moveCursor(uint8 row,uint8 col)
+{
+	g_row = row & 0x01;
+	g_col = col;
+}
+
+void LCD_displayStringRowColumn(uint8 row,uint8 col,const char *Str)
+{
+	LCD_moveCursor(row,col);
+	LCD_displayString(Str);
+}
+
+void LCD_intgerToString(int data)
+{
+	char buff[16];
+	snprintf(buff, sizeof(buff), "%d", data);
+	LCD_displayString(buff);
+}
+
+void LCD_clearScreen(void)
+{
+	LCD_sendCommand(LCD_CLEAR_COMMAND);
+}
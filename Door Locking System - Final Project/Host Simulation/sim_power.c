@@ -0,0 +1,86 @@
+ /******************************************************************************
+ *
+ * Module: Host Simulation - Power
+ *
+ * File Name: sim_power.c
+ *
+ * Description: Host implementation of the power.h API. There is no sleep
+ *              instruction: the firmware gives the CPU to the other MCU until
+ *              the condition holds, as the polling loops do. The time spent
+ *              waiting is the time the MCU would sleep, reported on stderr at
+ *              the end of the run. It is a lower bound: the host runs the
+ *              firmware code itself slower than the scaled clock.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#define _GNU_SOURCE				/* program_invocation_short_name */
+#include "power.h"
+#include "sim.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <sched.h>
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+static uint64 g_startNs = 0;		/* First wait, the firmware is initialized */
+static uint64 g_sleepNs[3] = {0, 0, 0};	/* Waiting time in each Power_SleepMode */
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+static void Power_report(void)
+{
+	uint64 total = Sim_nowNs() - g_startNs;
+
+	if(total != 0)
+	{
+		/* Both firmwares report, each with its program name */
+		fprintf(stderr, "power %-12s idle %5.1f %%  ADC noise reduction %5.1f %%  power-save %5.1f %%  of %.3f s\n",
+				program_invocation_short_name,
+				100.0 * g_sleepNs[POWER_IDLE] / total,
+				100.0 * g_sleepNs[POWER_ADC_NOISE_REDUCTION] / total,
+				100.0 * g_sleepNs[POWER_SAVE] / total,
+				total * Sim_timeScale() / 1e9);
+	}
+}
+
+/* The harness ends the firmware with SIGTERM */
+static void Power_terminate(int signal)
+{
+	(void)signal;
+	exit(EXIT_SUCCESS);
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+void Power_waitFor(boolean (*condition)(void), Power_SleepMode mode)
+{
+	uint64 start;
+
+	if(g_startNs == 0)
+	{
+		g_startNs = Sim_nowNs();
+		atexit(&Power_report);
+		signal(SIGTERM, &Power_terminate);
+	}
+
+	if((*condition)())
+	{
+		return;
+	}
+	start = Sim_nowNs();
+	do
+	{
+		sched_yield();
+	}while(!(*condition)());
+	g_sleepNs[mode] += Sim_nowNs() - start;
+}
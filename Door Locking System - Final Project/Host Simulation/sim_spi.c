@@ -0,0 +1,179 @@
+ /******************************************************************************
+ *
+ * Module: Host Simulation - SPI
+ *
+ * File Name: sim_spi.c
+ *
+ * Description: Host implementation of the spi.h message layer, used when the
+ *              firmwares are built with DOOR_LINK_SPI. The messages travel on
+ *              the same socket pair as the UART line. With the shaper on
+ *              (SIM_LINK_BAUD not 0) every exchange occupies the bus for its
+ *              length byte and message at the configured SCK rate, plus the
+ *              SPI_BYTE_GAP_US the master leaves before every byte.
+ *              Block transfers have no peer on the host: they complete at once
+ *              with SPI_DUMMY_BYTE received. The master polls are not
+ *              emulated, a slave message is delivered without waiting for
+ *              the next poll, so SPI_setTimeSource has nothing to pace.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include "spi.h"
+#include "sim.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/socket.h>
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Messages received from the socket (power of 2) */
+#define SIM_SPI_QUEUE_SIZE		16
+#define SIM_SPI_QUEUE_MASK		(SIM_SPI_QUEUE_SIZE - 1)
+
+/* One message exchange on the emulated bus */
+typedef struct
+{
+	uint64 deliver_at;	/* Monotonic time the exchange ends */
+	uint8 length;
+	uint8 data[SPI_MESSAGE_MAX_LENGTH];
+}Sim_SpiMessage;
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+static int g_lineFd = SIM_NO_FD;
+static uint64 g_byteTimeNs = 0;		/* 0 means unthrottled */
+static uint64 g_latencyNs = 0;
+static uint64 g_busyUntil = 0;		/* End of the last exchange on the bus */
+static void (*g_callBackPtr)(void) = NULL_PTR;
+static Sim_SpiMessage g_rxQueue[SIM_SPI_QUEUE_SIZE];
+static uint8 g_rxHead = 0;
+static uint8 g_rxTail = 0;
+
+/* SCK divider for every SPI_ClockRate value */
+static const uint8 g_clockDivider[] = {4, 16, 64, 128, 2, 8, 32};
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+void SPI_init(const SPI_ConfigType *Config_Ptr)
+{
+	g_lineFd = Sim_getEnv(SIM_ENV_UART_FD, SIM_NO_FD);
+	if(g_lineFd == SIM_NO_FD)
+	{
+		exit(EXIT_FAILURE);
+	}
+
+	if(Sim_getEnv(SIM_ENV_LINK_BAUD, 0) > 0)
+	{
+		g_byteTimeNs = (8ULL * g_clockDivider[Config_Ptr->clock] * 1000000000ULL) / F_CPU + SPI_BYTE_GAP_US * 1000ULL;
+	}
+	g_latencyNs = (uint64)Sim_getEnv(SIM_ENV_LINK_LATENCY, 0) * 1000ULL;
+}
+
+void SPI_transferBlock(const uint8 *tx_data, uint8 *rx_data, uint8 length)
+{
+	(void)tx_data;
+	if(rx_data != NULL_PTR)
+	{
+		memset(rx_data, SPI_DUMMY_BYTE, length);
+	}
+	if(g_callBackPtr != NULL_PTR)
+	{
+		(*g_callBackPtr)();
+	}
+}
+
+boolean SPI_isBusy(void)
+{
+	return Sim_nowNs() < g_busyUntil;
+}
+
+void SPI_setCallBack(void(*a_ptr)(void))
+{
+	g_callBackPtr = a_ptr;
+}
+
+void SPI_setTimeSource(uint32(*a_ptr)(void))
+{
+	(void)a_ptr;
+}
+
+void SPI_sendMessage(const uint8 *data, uint8 length)
+{
+	Sim_SpiMessage message;
+	uint64 now;
+
+	if(length > SPI_MESSAGE_MAX_LENGTH)
+	{
+		return;
+	}
+
+	/* Wait until the previous exchange has ended */
+	if(g_byteTimeNs != 0 && Sim_nowNs() < g_busyUntil)
+	{
+		Sim_sleepUntilNs(g_busyUntil);
+	}
+
+	/* The length byte, then the message */
+	now = Sim_nowNs();
+	g_busyUntil = now + (1 + length) * g_byteTimeNs;
+
+	memset(&message, 0, sizeof(message));
+	message.deliver_at = g_busyUntil + g_latencyNs;
+	message.length = length;
+	memcpy(message.data, data, length);
+	if(write(g_lineFd, &message, sizeof(message)) != sizeof(message))
+	{
+		/* The other MCU is gone, the harness ends the run */
+		exit(EXIT_SUCCESS);
+	}
+}
+
+boolean SPI_receiveMessage(uint8 *data, uint8 *length)
+{
+	Sim_SpiMessage *message;
+	ssize_t count;
+
+	/* Take the messages already complete on the socket */
+	while(((g_rxHead + 1) & SIM_SPI_QUEUE_MASK) != g_rxTail)
+	{
+		message = &g_rxQueue[g_rxHead];
+		count = recv(g_lineFd, message, sizeof(Sim_SpiMessage), MSG_DONTWAIT | MSG_PEEK);
+		if(count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			break;
+		}
+		if(count > 0 && count < (ssize_t)sizeof(Sim_SpiMessage))
+		{
+			break;
+		}
+		if(recv(g_lineFd, message, sizeof(Sim_SpiMessage), MSG_WAITALL) != sizeof(Sim_SpiMessage))
+		{
+			/* The other MCU is gone, the harness ends the run */
+			exit(EXIT_SUCCESS);
+		}
+		g_rxHead = (g_rxHead + 1) & SIM_SPI_QUEUE_MASK;
+	}
+
+	if(g_rxHead == g_rxTail || g_rxQueue[g_rxTail].deliver_at > Sim_nowNs())
+	{
+		/* The firmware is polling, let the other MCU run on a single core host */
+		sched_yield();
+		return FALSE;
+	}
+
+	message = &g_rxQueue[g_rxTail];
+	*length = message->length;
+	memcpy(data, message->data, message->length);
+	g_rxTail = (g_rxTail + 1) & SIM_SPI_QUEUE_MASK;
+	return TRUE;
+}
@@ -0,0 +1,280 @@
+ /******************************************************************************
+ *
+ * Module: Host Simulation - Timer
+ *
+ * File Name: sim_timer.c
+ *
+ * Description: Host implementation of the timer.h API. A thread plays the role
+ *              of Timer1 and calls the callback at the period the hardware
+ *              would have, divided by SIM_TIME_SCALE. Periods shorter than
+ *              SIM_TIMER_MIN_SLEEP_NS (a 10 ms tick at x1000) are served in
+ *              batches: the thread wakes at most that often and calls the
+ *              callback once for every period elapsed, so the tick count keeps
+ *              the right rate without a wake-up per tick.
+ *              TCNT1 is the time since the last call in timer counts, held at
+ *              the top until the next call so the count never runs backwards.
+ *              Like OCF1A, the compare flag is set from the wrap of the count
+ *              until the callback has returned.
+ *              Timer0 and Timer2 only keep their settings (Timer0 in the
+ *              emulated registers): the host builds use them for the motor
+ *              PWM, which has no observable effect, and never for a tone.
+ *              Timer2 in asynchronous mode (the RTC) gets a thread of its
+ *              own, on the 32.768 kHz crystal divided by SIM_TIME_SCALE.
+ *              With ISR_PROFILE, both threads profile their callbacks as the
+ *              TIMER1_COMPA and TIMER2_OVF vectors, and the stats are reported
+ *              on stderr at the end of the run. The latency is how late the
+ *              host thread served the period, up to the whole tick when the
+ *              periods come in batches, and the times are host times scaled
+ *              by SIM_TIME_SCALE: neither says much about the hardware.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#define _GNU_SOURCE				/* program_invocation_short_name */
+#include "timer.h"
+#include "isr_profile.h"
+#include "sim.h"
+#include <avr/io.h>
+#include <pthread.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define SIM_TIMER_MIN_SLEEP_NS	200000ULL
+#define SIM_TIMER_CRYSTAL_HZ	32768ULL
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+static void (*volatile g_callBackPtr)(void) = NULL_PTR;
+static volatile uint64 g_periodNs = 0;
+static volatile uint64 g_lastCallNs = 0;
+static volatile uint16 g_divider = 0;
+static volatile uint16 g_top = 0;
+static volatile boolean g_comparePending = FALSE;
+static pthread_t g_timerThread;
+static boolean g_threadStarted = FALSE;
+
+/* Clock divider for every Timer1_Prescaler value, 0 means stopped */
+static const uint16 g_prescalerDivider[] = {0, 1, 8, 64, 256, 1024, 0, 0};
+
+/* Asynchronous Timer2 */
+static void (*volatile g_timer2CallBackPtr)(void) = NULL_PTR;
+static volatile uint64 g_timer2PeriodNs = 0;
+static pthread_t g_timer2Thread;
+static boolean g_timer2ThreadStarted = FALSE;
+
+/* Clock divider for every Timer2_Prescaler value */
+static const uint16 g_timer2PrescalerDivider[] = {0, 1, 8, 32, 64, 128, 256, 1024};
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+#ifdef ISR_PROFILE
+static void Timer_reportIsrProfile(void)
+{
+	static const char *const names[] = {"TIMER1_COMPA", "TIMER2_OVF"};
+	static const IsrProfile_VectorType vectors[] = {ISR_PROFILE_TIMER1_COMPA, ISR_PROFILE_TIMER2_OVF};
+	IsrProfile_StatsType stats;
+	uint8 i;
+
+	for(i = 0; i < 2; i++)
+	{
+		IsrProfile_getStats(vectors[i], &stats);
+		if(stats.runs == 0)
+		{
+			continue;
+		}
+		/* Both firmwares report, each with its program name */
+		fprintf(stderr, "isr   %-12s %-12s runs %8lu  time min/avg/max %u/%lu/%u us",
+				program_invocation_short_name, names[i], (unsigned long)stats.runs,
+				stats.time_min_us, (unsigned long)(stats.time_total_us / stats.runs), stats.time_max_us);
+		if(stats.latency_runs != 0)
+		{
+			fprintf(stderr, "  latency min/avg/max %u/%lu/%u us",
+					stats.latency_min_us, (unsigned long)(stats.latency_total_us / stats.latency_runs),
+					stats.latency_max_us);
+		}
+		fputc('\n', stderr);
+	}
+}
+#endif
+
+static void *Timer1_thread(void *arg)
+{
+	uint64 next = Sim_nowNs();
+	uint64 now;
+	(void)arg;
+
+	while(1)
+	{
+		uint64 period = g_periodNs;
+		if(period == 0)
+		{
+			/* Timer stopped, poll for a new configuration */
+			next = Sim_nowNs() + 1000000ULL;
+			Sim_sleepUntilNs(next);
+			continue;
+		}
+		/* next is the time of the last call, short periods are served in batches */
+		Sim_sleepUntilNs(next + ((period < SIM_TIMER_MIN_SLEEP_NS) ? SIM_TIMER_MIN_SLEEP_NS : period));
+		now = Sim_nowNs();
+		/* One call per elapsed period */
+		while(next + period <= now)
+		{
+			next += period;
+			g_comparePending = TRUE;
+			g_lastCallNs = next;
+			/* The count restarted at next, the count now is the lateness */
+			ISR_PROFILE_ENTER_AT(ISR_PROFILE_TIMER1_COMPA, 0);
+			if(g_callBackPtr != NULL_PTR)
+			{
+				(*g_callBackPtr)();
+			}
+			ISR_PROFILE_EXIT(ISR_PROFILE_TIMER1_COMPA);
+			g_comparePending = FALSE;
+		}
+	}
+	return NULL;
+}
+
+void Timer1_init(const Timer1_ConfigType * Config_Ptr)
+{
+	uint64 counts;
+	uint16 divider = g_prescalerDivider[Config_Ptr->prescaler & 0x07];
+
+	/* CTC wraps at OCR1A, the other modes wrap at the 16-bit top */
+	if(Config_Ptr->mode == COMPARE_MODE)
+	{
+		counts = (uint64)Config_Ptr->compare_value + 1;
+	}
+	else
+	{
+		counts = 65536ULL;
+	}
+
+	g_top = (uint16)(counts - 1);
+	g_divider = divider;
+	g_lastCallNs = Sim_nowNs();
+	g_periodNs = (divider == 0) ? 0 : (counts * divider * 1000000000ULL) / F_CPU / Sim_timeScale();
+
+	if(!g_threadStarted)
+	{
+		g_threadStarted = TRUE;
+#ifdef ISR_PROFILE
+		atexit(&Timer_reportIsrProfile);
+#endif
+		pthread_create(&g_timerThread, NULL, Timer1_thread, NULL);
+	}
+}
+
+void Timer1_deInit(void)
+{
+	g_periodNs = 0;
+}
+
+void Timer1_setCallBack(void(*a_ptr)(void))
+{
+	g_callBackPtr = a_ptr;
+}
+
+uint16 Timer1_getCount(void)
+{
+	uint64 count;
+
+	if(g_divider == 0)
+	{
+		return 0;
+	}
+	count = (Sim_nowNs() - g_lastCallNs) * Sim_timeScale() * (F_CPU / 1000UL) / (g_divider * 1000000ULL);
+	return (count > g_top) ? g_top : (uint16)count;
+}
+
+boolean Timer1_isComparePending(void)
+{
+	return g_comparePending;
+}
+
+void Timer0_init(const Timer0_ConfigType * Config_Ptr)
+{
+	TCNT0 = Config_Ptr->initial_value;
+	OCR0 = Config_Ptr->compare_value;
+	TCCR0 = ((Config_Ptr->output & 0x03) << COM00) | (Config_Ptr->prescaler & 0x07);
+}
+
+void Timer0_deInit(void)
+{
+	TCCR0 = 0;
+	TCNT0 = 0;
+}
+
+void Timer0_setCallBack(void(*a_ptr)(void))
+{
+	(void)a_ptr;
+}
+
+/* One call per crystal period, its periods are long enough for one wake-up each */
+static void *Timer2_thread(void *arg)
+{
+	uint64 next = Sim_nowNs();
+	(void)arg;
+
+	while(1)
+	{
+		uint64 period = g_timer2PeriodNs;
+		if(period == 0)
+		{
+			next = Sim_nowNs() + 1000000ULL;
+			Sim_sleepUntilNs(next);
+			continue;
+		}
+		next += period;
+		Sim_sleepUntilNs(next);
+		ISR_PROFILE_ENTER(ISR_PROFILE_TIMER2_OVF);
+		if(g_timer2CallBackPtr != NULL_PTR)
+		{
+			(*g_timer2CallBackPtr)();
+		}
+		ISR_PROFILE_EXIT(ISR_PROFILE_TIMER2_OVF);
+	}
+	return NULL;
+}
+
+void Timer2_init(const Timer2_ConfigType * Config_Ptr)
+{
+	(void)Config_Ptr;
+}
+
+void Timer2_initAsync(const Timer2_ConfigType * Config_Ptr)
+{
+	uint64 counts = (Config_Ptr->mode == COMPARE_MODE) ? (uint64)Config_Ptr->compare_value + 1 : 256ULL;
+	uint16 divider = g_timer2PrescalerDivider[Config_Ptr->prescaler & 0x07];
+
+	g_timer2PeriodNs = (counts * divider * 1000000000ULL) / SIM_TIMER_CRYSTAL_HZ / Sim_timeScale();
+	if(!g_timer2ThreadStarted)
+	{
+		g_timer2ThreadStarted = TRUE;
+		pthread_create(&g_timer2Thread, NULL, Timer2_thread, NULL);
+	}
+}
+
+void Timer2_waitAsyncUpdate(void)
+{
+}
+
+void Timer2_deInit(void)
+{
+	g_timer2PeriodNs = 0;
+}
+
+void Timer2_setCallBack(void(*a_ptr)(void))
+{
+	g_timer2CallBackPtr = a_ptr;
+}
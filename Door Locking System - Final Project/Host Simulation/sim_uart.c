@@ -0,0 +1,252 @@
+ /******************************************************************************
+ *
+ * Module: Host Simulation - UART
+ *
+ * File Name: sim_uart.c
+ *
+ * Description: Host implementation of the UART.h API. The line between the two
+ *              MCUs is a Unix socket pair set up by the harness. Every byte
+ *              travels with the time it would leave the receiver's shift
+ *              register, so the shaper can emulate the configured baud rate
+ *              and a propagation delay, or run unthrottled (SIM_LINK_BAUD=0).
+ *              The line never corrupts bytes, so the error counters stay 0;
+ *              max_rx_latency is always measured, in micro-seconds. With
+ *              SIM_LINK_DROP, every n-th byte sent still takes its time on the
+ *              line but never reaches the receiver, which exercises the
+ *              resends of the door link.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include "UART.h"
+#include "sim.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/socket.h>
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Bytes received from the socket, the RX ring buffer of the host (power of 2) */
+#define SIM_UART_QUEUE_SIZE		64
+#define SIM_UART_QUEUE_MASK		(SIM_UART_QUEUE_SIZE - 1)
+
+/* One byte on the emulated line */
+typedef struct
+{
+	uint64 deliver_at;	/* Monotonic time the byte is complete at the receiver */
+	uint8 data;
+}Sim_UartFrame;
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+static int g_lineFd = SIM_NO_FD;
+static uint64 g_frameTimeNs = 0;	/* 0 means unthrottled */
+static uint64 g_latencyNs = 0;
+static uint32 g_dropPeriod = 0;		/* 0 means no byte is lost */
+static uint32 g_dropCount = 0;
+static uint64 g_txStart = 0;		/* Last byte moved to the shift register */
+static uint64 g_txEnd = 0;			/* Shift register empty again */
+static UART_StatsType g_stats;
+static Sim_UartFrame g_rxQueue[SIM_UART_QUEUE_SIZE];
+static uint8 g_rxHead = 0;
+static uint8 g_rxTail = 0;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+void UART_init(const UART_ConfigType *Config_Ptr)
+{
+	sint32 baud;
+	uint8 frame_bits;
+
+	g_lineFd = Sim_getEnv(SIM_ENV_UART_FD, SIM_NO_FD);
+	if(g_lineFd == SIM_NO_FD)
+	{
+		exit(EXIT_FAILURE);
+	}
+
+	/* Start bit + data bits + optional parity bit + stop bits */
+	frame_bits = 1 + (5 + Config_Ptr->bit_data) + ((Config_Ptr->parity != DISABLED) ? 1 : 0) + (1 + Config_Ptr->stop_bit);
+
+	baud = Sim_getEnv(SIM_ENV_LINK_BAUD, 0);
+	g_frameTimeNs = (baud > 0) ? (frame_bits * 1000000000ULL) / (uint32)baud : 0;
+	g_latencyNs = (uint64)Sim_getEnv(SIM_ENV_LINK_LATENCY, 0) * 1000ULL;
+	g_dropPeriod = (uint32)Sim_getEnv(SIM_ENV_LINK_DROP, 0);
+	UART_resetStats();
+}
+
+void UART_sendByte(const uint8 data)
+{
+	Sim_UartFrame frame;
+	uint64 now;
+
+	/* Wait until UDR is empty: the previous byte moved to the shift register */
+	if(g_frameTimeNs != 0 && Sim_nowNs() < g_txStart)
+	{
+		Sim_sleepUntilNs(g_txStart);
+	}
+
+	now = Sim_nowNs();
+	g_txStart = (now > g_txEnd) ? now : g_txEnd;
+	g_txEnd = g_txStart + g_frameTimeNs;
+
+	g_stats.tx_bytes++;
+	if(g_dropPeriod != 0 && ++g_dropCount == g_dropPeriod)
+	{
+		g_dropCount = 0;
+		return;
+	}
+
+	frame.deliver_at = g_txEnd + g_latencyNs;
+	frame.data = data;
+	if(write(g_lineFd, &frame, sizeof(frame)) != sizeof(frame))
+	{
+		/* The other MCU is gone, the harness ends the run */
+		exit(EXIT_SUCCESS);
+	}
+}
+
+/*
+ * Read one frame from the socket into the RX queue. Without wait, only a frame
+ * already complete on the socket is taken. Return FALSE if none was taken.
+ */
+static boolean UART_pullFrame(boolean wait)
+{
+	Sim_UartFrame *frame = &g_rxQueue[g_rxHead];
+	uint8 level;
+	ssize_t count;
+
+	if(((g_rxHead + 1) & SIM_UART_QUEUE_MASK) == g_rxTail)
+	{
+		return FALSE;
+	}
+	if(!wait)
+	{
+		count = recv(g_lineFd, frame, sizeof(Sim_UartFrame), MSG_DONTWAIT | MSG_PEEK);
+		if(count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			return FALSE;
+		}
+		if(count > 0 && count < (ssize_t)sizeof(Sim_UartFrame))
+		{
+			return FALSE;
+		}
+	}
+	if(recv(g_lineFd, frame, sizeof(Sim_UartFrame), MSG_WAITALL) != sizeof(Sim_UartFrame))
+	{
+		/* The other MCU is gone, the harness ends the run */
+		exit(EXIT_SUCCESS);
+	}
+	g_rxHead = (g_rxHead + 1) & SIM_UART_QUEUE_MASK;
+
+	level = (g_rxHead - g_rxTail) & SIM_UART_QUEUE_MASK;
+	if(level > g_stats.rx_high_water)
+	{
+		g_stats.rx_high_water = level;
+	}
+	return TRUE;
+}
+
+uint8 UART_receiveByte(void)
+{
+	Sim_UartFrame *frame;
+	uint64 now;
+
+	if(g_rxHead == g_rxTail)
+	{
+		UART_pullFrame(TRUE);
+	}
+	frame = &g_rxQueue[g_rxTail];
+
+	/* RXC is only set once the whole frame has arrived */
+	now = Sim_nowNs();
+	if(now < frame->deliver_at)
+	{
+		Sim_sleepUntilNs(frame->deliver_at);
+	}
+	else if((now - frame->deliver_at) / 1000 > g_stats.max_rx_latency)
+	{
+		g_stats.max_rx_latency = (now - frame->deliver_at) / 1000;
+	}
+	g_rxTail = (g_rxTail + 1) & SIM_UART_QUEUE_MASK;
+	g_stats.rx_bytes++;
+	return frame->data;
+}
+
+uint8 UART_availableBytes(void)
+{
+	uint64 now = Sim_nowNs();
+	uint8 count = 0;
+	uint8 index;
+
+	while(UART_pullFrame(FALSE));
+	for(index = g_rxTail; index != g_rxHead; index = (index + 1) & SIM_UART_QUEUE_MASK)
+	{
+		if(g_rxQueue[index].deliver_at > now)
+		{
+			break;
+		}
+		count++;
+	}
+	if(count == 0)
+	{
+		/* The firmware is polling, let the other MCU run on a single core host */
+		sched_yield();
+	}
+	return count;
+}
+
+void UART_sendString(const uint8 *Str)
+{
+	uint8 i = 0;
+
+	/* Send the whole string */
+	while(Str[i] != '\0')
+	{
+		UART_sendByte(Str[i]);
+		i++;
+	}
+}
+
+void UART_receiveString(uint8 *Str)
+{
+	uint8 i = 0;
+
+	/* Receive the first byte */
+	Str[i] = UART_receiveByte();
+
+	/* Receive the whole string until the '#' */
+	while(Str[i] != '#')
+	{
+		i++;
+		Str[i] = UART_receiveByte();
+	}
+
+	/* After receiving the whole string plus the '#', replace the '#' with '\0' */
+	Str[i] = '\0';
+}
+
+void UART_setTimeSource(uint32(*a_ptr)(void))
+{
+	/* The host clock is always used */
+	(void)a_ptr;
+}
+
+void UART_getStats(UART_StatsType *Stats_Ptr)
+{
+	*Stats_Ptr = g_stats;
+}
+
+void UART_resetStats(void)
+{
+	memset(&g_stats, 0, sizeof(g_stats));
+}
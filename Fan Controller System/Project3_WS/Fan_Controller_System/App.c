@@ -8,16 +8,73 @@
  *
  *******************************************************************************/
 
+#include <avr/io.h>
 #include "gpio.h"
 #include "adc.h"
 #include "lcd.h"
 #include "lm35_sensor.h"
 #include "motor.h"
 #include "pwm.h"
+#include "soft_timer.h"
+#include "scheduler.h"
+#include "power.h"
+#include "isr_profile.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* The temperature is read every 100 ms, the fan and the LCD follow its changes */
+#define TASK_SENSOR_PERIOD		100
+#define TASK_SENSOR_DEADLINE	10
+#define TASK_FAN_DEADLINE		100
+/* Posted by the sensor task when the temperature has changed */
+#define EVENT_TEMPERATURE		SCHEDULER_EVENT(0)
+/* Above the LM35 range: no reading yet */
+#define NO_TEMPERATURE			0xFF
+/*
+ * The scheduler stats are shown every second in the free LCD corners: the
+ * deadline misses of all tasks and the longest task run in ms. With
+ * ISR_PROFILE they take turns with the longest ADC and Timer1 ISRs.
+ */
+#define TASK_DIAG_PERIOD		1000
+#define TASK_DIAG_DEADLINE		100
+/* Corners right of "FAN IS OFF" and of "Temp =    C" */
+#define DIAG_ROW0_COLUMN		11
+#define DIAG_ROW1_COLUMN		12
+#define DIAG_ROW0_MAX			9999
+#define DIAG_ROW1_MAX			999
+#define DIAG_LCD_COLUMNS		16
+
+/*******************************************************************************
+ *                               Global-Variables                              *
+ *******************************************************************************/
+
+uint8 g_temperature = NO_TEMPERATURE;
+
+/*******************************************************************************
+ *                             Functions Prototypes                            *
+ *******************************************************************************/
+
+void sensor_task(void);
+void fan_task(void);
+void idle_task(void);
+void diag_task(void);
+void show_diag(uint8 row, uint8 col, char tag, uint32 value, uint32 max);
+
+/*******************************************************************************
+ *                               Task Table                                    *
+ *******************************************************************************/
+
+const Scheduler_TaskType g_tasks[] = {
+	{&sensor_task,  TASK_SENSOR_PERIOD,  TASK_SENSOR_DEADLINE,  0},
+	{&fan_task,     0,                   TASK_FAN_DEADLINE,     EVENT_TEMPERATURE},
+	{&diag_task,    TASK_DIAG_PERIOD,    TASK_DIAG_DEADLINE,    0}
+};
+#define TASK_COUNT				(sizeof(g_tasks) / sizeof(g_tasks[0]))
 
 int main(void) {
 
-	uint8 temp;
 	/* Initializing configuration for ADC */
 	ADC_ConfigType adcConfig;
 	adcConfig.prescaler = ADC_PRESCALER_8;
@@ -35,66 +92,166 @@ int main(void) {
 	LCD_moveCursor(1,0);
 	LCD_displayString("Temp =    C");
 
-	while(1)
+	/* Timer1 tick for the scheduler time source */
+	SoftTimer_init();
+#ifdef ISR_PROFILE
+	/* Time the ISRs on the free-running soft timer count */
+	IsrProfile_init(&Timer1_getCount, SOFT_TIMER_COMPARE_VALUE, SOFT_TIMER_US_PER_COUNT);
+#endif
+	SREG |= (1<<7);
+
+	Scheduler_setTimeSource(&SoftTimer_micros);
+	Scheduler_setIdleHook(&idle_task);
+	Scheduler_init(g_tasks, TASK_COUNT);
+	Scheduler_run();
+}
+
+/*
+ * Description :
+ * Read the LM35 and release the fan task when the temperature has changed.
+ */
+void sensor_task(void)
+{
+	uint8 temp = LM35_getTemperature();
+
+	if(temp != g_temperature)
 	{
-    	temp = LM35_getTemperature();
-    	/* If temperature is less than 30 C ==> Turn OFF the Fan */
-		if(temp < 30)
-		{
-			DcMotor_Rotate(MOTOR_STOP,0);
-			LCD_moveCursor(0,0);
-			LCD_displayString("FAN IS OFF");
-			LCD_moveCursor(1,7);
-			LCD_intgerToString(temp);
+		g_temperature = temp;
+		Scheduler_postEvent(EVENT_TEMPERATURE);
+	}
+}
 
-		}
-		/* If temperature is more than 30 C ==> Turn ON the Fan with speed = 25% */
-		else if(temp >= 30 && temp < 60)
-		{
-			DcMotor_Rotate(MOTOR_CW,25);
-			LCD_moveCursor(0,0);
-			LCD_displayString("FAN IS ON ");
-			LCD_moveCursor(1,7);
-			LCD_intgerToString(temp);
-			LCD_displayCharacter(' ');
-		}
-		/* If temperature is more than 60 C ==> Turn ON the Fan with speed = 50% */
-		else if (temp >= 60 && temp < 90)
+/*
+ * Description :
+ * Sleep in idle mode until a task is released, the Timer1 tick wakes the
+ * CPU every SOFT_TIMER_TICK_MS.
+ */
+void idle_task(void)
+{
+	Power_waitFor(&Scheduler_isReleased, POWER_IDLE);
+}
+
+/*
+ * Description :
+ * Display the deadline misses of all tasks after the fan state ('M') and the
+ * longest task run in ms after the temperature ('X'). With ISR_PROFILE, every
+ * other run displays the max execution time in us of the ADC ISR ('A') and of
+ * the Timer1 tick ISR ('T') instead.
+ */
+void diag_task(void)
+{
+	Scheduler_StatsType stats;
+	uint32 misses = 0;
+	uint32 exec_max_us = 0;
+	uint8 i;
+#ifdef ISR_PROFILE
+	static boolean isr_turn = FALSE;
+	IsrProfile_StatsType isr_stats;
+
+	isr_turn = !isr_turn;
+	if(isr_turn)
+	{
+		IsrProfile_getStats(ISR_PROFILE_ADC, &isr_stats);
+		show_diag(0, DIAG_ROW0_COLUMN, 'A', (isr_stats.runs != 0) ? isr_stats.time_max_us : 0, DIAG_ROW0_MAX);
+		IsrProfile_getStats(ISR_PROFILE_TIMER1_COMPA, &isr_stats);
+		show_diag(1, DIAG_ROW1_COLUMN, 'T', (isr_stats.runs != 0) ? isr_stats.time_max_us : 0, DIAG_ROW1_MAX);
+		return;
+	}
+#endif
+
+	for(i = 0; i < TASK_COUNT; i++)
+	{
+		Scheduler_getStats(i, &stats);
+		misses += stats.deadline_misses;
+		if(stats.exec_max_us > exec_max_us)
 		{
-			DcMotor_Rotate(MOTOR_CW,50);
-			LCD_moveCursor(0,0);
-			LCD_displayString("FAN IS ON ");
-			LCD_moveCursor(1,7);
-			LCD_intgerToString(temp);
-			LCD_displayCharacter(' ');
+			exec_max_us = stats.exec_max_us;
 		}
-		/* If temperature is more than 90 C ==> Turn ON the Fan with speed = 75% */
-		else if (temp >= 90 && temp < 120)
-		{
-			DcMotor_Rotate(MOTOR_CW,75);
-			LCD_moveCursor(0,0);
-			LCD_displayString("FAN IS ON ");
-			LCD_moveCursor(1,7);
-			if (temp >= 100)
-				LCD_intgerToString(temp);
-			else{
-				LCD_intgerToString(temp);
-				LCD_displayCharacter(' ');
-				}
+	}
+	show_diag(0, DIAG_ROW0_COLUMN, 'M', misses, DIAG_ROW0_MAX);
+	show_diag(1, DIAG_ROW1_COLUMN, 'X', exec_max_us / 1000, DIAG_ROW1_MAX);
+}
 
-		}
-		/* If temperature is more than 120 C ==> Turn ON the Fan with speed = 100% */
-		else if(temp >= 120)
-		{
-			DcMotor_Rotate(MOTOR_CW,100);
-			LCD_moveCursor(0,0);
-			LCD_displayString("FAN IS ON ");
-			LCD_moveCursor(1,7);
-			LCD_intgerToString(temp);
+/*
+ * Description :
+ * Display a tag and a value, capped at max, from row/col to the end of the
+ * row, so a shorter value leaves no digits of the previous one.
+ */
+void show_diag(uint8 row, uint8 col, char tag, uint32 value, uint32 max)
+{
+	uint8 i;
 
-		}
+	LCD_moveCursor(row, col);
+	for(i = col; i < DIAG_LCD_COLUMNS; i++)
+	{
+		LCD_displayCharacter(' ');
+	}
+	LCD_moveCursor(row, col);
+	LCD_displayCharacter(tag);
+	LCD_intgerToString((value > max) ? max : value);
+}
 
+/*
+ * Description :
+ * Set the fan speed for the last temperature and display both on the LCD.
+ */
+void fan_task(void)
+{
+	uint8 temp = g_temperature;
+
+	/* If temperature is less than 30 C ==> Turn OFF the Fan */
+	if(temp < 30)
+	{
+		DcMotor_Rotate(MOTOR_STOP,0);
+		LCD_moveCursor(0,0);
+		LCD_displayString("FAN IS OFF");
+		LCD_moveCursor(1,7);
+		LCD_intgerToString(temp);
+
+	}
+	/* If temperature is more than 30 C ==> Turn ON the Fan with speed = 25% */
+	else if(temp >= 30 && temp < 60)
+	{
+		DcMotor_Rotate(MOTOR_CW,25);
+		LCD_moveCursor(0,0);
+		LCD_displayString("FAN IS ON ");
+		LCD_moveCursor(1,7);
+		LCD_intgerToString(temp);
+		LCD_displayCharacter(' ');
+	}
+	/* If temperature is more than 60 C ==> Turn ON the Fan with speed = 50% */
+	else if (temp >= 60 && temp < 90)
+	{
+		DcMotor_Rotate(MOTOR_CW,50);
+		LCD_moveCursor(0,0);
+		LCD_displayString("FAN IS ON ");
+		LCD_moveCursor(1,7);
+		LCD_intgerToString(temp);
+		LCD_displayCharacter(' ');
+	}
+	/* If temperature is more than 90 C ==> Turn ON the Fan with speed = 75% */
+	else if (temp >= 90 && temp < 120)
+	{
+		DcMotor_Rotate(MOTOR_CW,75);
+		LCD_moveCursor(0,0);
+		LCD_displayString("FAN IS ON ");
+		LCD_moveCursor(1,7);
+		if (temp >= 100)
+			LCD_intgerToString(temp);
+		else{
+			LCD_intgerToString(temp);
+			LCD_displayCharacter(' ');
+			}
 
 	}
+	/* If temperature is more than 120 C ==> Turn ON the Fan with speed = 100% */
+	else if(temp >= 120)
+	{
+		DcMotor_Rotate(MOTOR_CW,100);
+		LCD_moveCursor(0,0);
+		LCD_displayString("FAN IS ON ");
+		LCD_moveCursor(1,7);
+		LCD_intgerToString(temp);
 
+	}
 }
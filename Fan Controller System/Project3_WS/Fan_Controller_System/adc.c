@@ -11,9 +11,39 @@
  *******************************************************************************/
 
 #include "avr/io.h"
+#include <avr/interrupt.h>
 #include "adc.h"
+#include "power.h"
+#include "isr_profile.h"
 #include "common_macros.h"
 
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Set by the ADC interrupt at the end of the conversion */
+static volatile boolean g_conversionDone = FALSE;
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+ISR(ADC_vect)
+{
+	ISR_PROFILE_ENTER(ISR_PROFILE_ADC);
+	g_conversionDone = TRUE;
+	ISR_PROFILE_EXIT(ISR_PROFILE_ADC);
+}
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+static boolean ADC_isConversionDone(void)
+{
+	return g_conversionDone;
+}
+
 /*******************************************************************************
  *                      Functions Definitions                                  *
  *******************************************************************************/
@@ -21,8 +51,8 @@ void ADC_init(const ADC_ConfigType * configPtr)
 {
     /* Set the reference voltage and adjust the result left or right */
 	ADMUX = (configPtr->ref_volt << REFS0) | (configPtr->adjustResult << ADLAR);
-    /* Enable the ADC and set the prescaler value */
-	ADCSRA = (1<<ADEN)  | (configPtr->prescaler<<ADPS0);
+    /* Enable the ADC, its interrupt and set the prescaler value */
+	ADCSRA = (1<<ADEN) | (1<<ADIE) | (configPtr->prescaler<<ADPS0);
 
 }
 
@@ -30,12 +60,14 @@ uint16 ADC_readChannel(uint8 channel)
 {
     /* Configure the channel */
 	ADMUX = (ADMUX & 0xE0) | (channel & 0x07);
-    /* Start the conversion */
-	ADCSRA |= (1<<ADSC);
-    /* Wait for the conversion to complete */
-	while(BIT_IS_CLEAR(ADCSRA,ADIF));
-	/* Clearing the Interrupt Flag */
-	ADCSRA |= (1<<ADIF);
+	g_conversionDone = FALSE;
+	/* Start the conversion */
+	SET_BIT(ADCSRA, ADSC);
+	/*
+	 * Sleep in idle mode until the ADC interrupt: the noise reduction mode
+	 * would stop the I/O clock, freezing the Timer0 PWM and the Timer1 tick.
+	 */
+	Power_waitFor(&ADC_isConversionDone, POWER_IDLE);
     /* Return the result */
 	return ADC;
 }
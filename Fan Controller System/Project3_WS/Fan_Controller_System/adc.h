@@ -63,7 +63,8 @@ void ADC_init(const ADC_ConfigType * configPtr);
 /*
  * Description :
  * Function responsible for read analog data from a certain ADC channel
- * and convert it to digital using the ADC driver.
+ * and convert it to digital using the ADC driver. The CPU sleeps in idle
+ * mode during the conversion, the PWM and the tick keep running.
  */
 uint16 ADC_readChannel(uint8 channel);
 
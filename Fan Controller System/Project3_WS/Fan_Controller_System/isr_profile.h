@@ -0,0 +1,122 @@
+ /******************************************************************************
+ *
+ * Module: ISR Profile
+ *
+ * File Name: isr_profile.h
+ *
+ * Description: Header file for the optional interrupt profiler. In a build
+ *              with ISR_PROFILE defined, the profiled ISRs read a free-running
+ *              count on entry and on exit, and every vector keeps:
+ *              - its execution time, min/avg/max: the time the other
+ *                interrupts stay disabled because of it,
+ *              - its entry latency, min/avg/max, for the vectors whose
+ *                request time is known from the hardware: a compare match
+ *                clearing the count, an input capture. The latency includes
+ *                the other ISRs and the code running with the interrupts
+ *                disabled when the request came.
+ *              The times are taken after the register saves of the ISR and
+ *              before their restores, and each includes one read of the count.
+ *
+ *              Without ISR_PROFILE the ISR_PROFILE_xxx macros are empty, the
+ *              ISRs are unchanged and isr_profile.c compiles to nothing.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#ifndef ISR_PROFILE_H_
+#define ISR_PROFILE_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Profiled vectors of all the boards, the same numbers on both door MCUs */
+typedef enum
+{
+	ISR_PROFILE_TIMER1_COMPA,
+	ISR_PROFILE_TIMER1_OVF,
+	ISR_PROFILE_TIMER1_CAPT,
+	ISR_PROFILE_TIMER0_COMP,
+	ISR_PROFILE_TIMER0_OVF,
+	ISR_PROFILE_TIMER2_COMP,
+	ISR_PROFILE_TIMER2_OVF,
+	ISR_PROFILE_USART_RXC,
+	ISR_PROFILE_USART_UDRE,
+	ISR_PROFILE_SPI_STC,
+	ISR_PROFILE_TWI,
+	ISR_PROFILE_ADC,
+	ISR_PROFILE_VECTORS
+}IsrProfile_VectorType;
+
+typedef struct{
+	uint32 runs;
+	uint32 time_total_us;			/* time_total_us / runs is the average execution time */
+	uint16 time_min_us;
+	uint16 time_max_us;
+	uint32 latency_runs;			/* runs with a known request time */
+	uint32 latency_total_us;
+	uint16 latency_min_us;
+	uint16 latency_max_us;
+}IsrProfile_StatsType;
+
+#ifdef ISR_PROFILE
+/* First statement of the ISR */
+#define ISR_PROFILE_ENTER(vector)				IsrProfile_enter(vector)
+/* First statement of the ISR, request is the count when the interrupt was requested */
+#define ISR_PROFILE_ENTER_AT(vector, request)	IsrProfile_enterAt(vector, request)
+/* Last statement of the ISR */
+#define ISR_PROFILE_EXIT(vector)				IsrProfile_exit(vector)
+#else
+#define ISR_PROFILE_ENTER(vector)
+#define ISR_PROFILE_ENTER_AT(vector, request)
+#define ISR_PROFILE_EXIT(vector)
+#endif
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Set the free-running count: the function reading it, the value after which
+ * it wraps to 0 and the us per count. The profiler does nothing until then.
+ * The stats are cleared.
+ */
+void IsrProfile_init(uint16(*a_ptr)(void), uint16 top, uint8 us_per_count);
+
+/*
+ * Description :
+ * Take the entry time of a vector, through ISR_PROFILE_ENTER.
+ */
+void IsrProfile_enter(IsrProfile_VectorType vector);
+
+/*
+ * Description :
+ * Take the entry time of a vector and the latency since its request, through
+ * ISR_PROFILE_ENTER_AT.
+ */
+void IsrProfile_enterAt(IsrProfile_VectorType vector, uint16 request);
+
+/*
+ * Description :
+ * Add the execution time since the entry to the stats of a vector, through
+ * ISR_PROFILE_EXIT.
+ */
+void IsrProfile_exit(IsrProfile_VectorType vector);
+
+/*
+ * Description :
+ * Copy the stats of a vector in us. The min fields are 0xFFFF until a run.
+ */
+void IsrProfile_getStats(IsrProfile_VectorType vector, IsrProfile_StatsType *Stats_Ptr);
+
+/*
+ * Description :
+ * Clear the stats of all the vectors.
+ */
+void IsrProfile_resetStats(void);
+
+#endif /* ISR_PROFILE_H_ */
@@ -0,0 +1,51 @@
+ /******************************************************************************
+ *
+ * Module: Power
+ *
+ * File Name: power.c
+ *
+ * Description: Source file for the wait-for-event primitive
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include "power.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* SM2:0 of every Power_SleepMode */
+static const uint8 g_sleepModes[] = {SLEEP_MODE_IDLE, SLEEP_MODE_ADC, SLEEP_MODE_PWR_SAVE};
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Check the condition with the interrupts disabled, then enable them and
+ * sleep in the same instruction pair.
+ */
+void Power_waitFor(boolean (*condition)(void), Power_SleepMode mode)
+{
+	uint8 sreg = SREG;
+
+	set_sleep_mode(g_sleepModes[mode]);
+
+	cli();
+	while(!(*condition)())
+	{
+		sleep_enable();
+		/* SEI takes effect after SLEEP: an interrupt pending here wakes it at once */
+		sei();
+		sleep_cpu();
+		sleep_disable();
+		cli();
+	}
+	SREG = sreg;
+}
@@ -1,4 +1,4 @@
-/******************************************************************************
+ /******************************************************************************
  *
  * Module: PWM
  *
@@ -11,28 +11,38 @@
  *******************************************************************************/
 
 #include "pwm.h"
-#include "avr/io.h"
+#include "timer.h"
 #include "gpio.h"
-#include <math.h>
+
+#if PWM_TIMER == TIMER_NONE
+#error "pwm.c needs a PWM_TIMER in timer_resources.h"
+#endif
 
 /*******************************************************************************
  *                      Functions Definitions                                  *
  *******************************************************************************/
 
-void PWM_Timer0_Start(uint8 duty_cycle) {
+void PWM_start(uint8 duty_cycle) {
 
-	/* Set Timer Initial Value to 0 */
-	TCNT0 = 0;
-	/* Set Compare Value */
-    uint16 compareValue = (duty_cycle * 255) / 100;
-	OCR0 = round(compareValue);
-	/* Set Pwm Pin Direction as output */
-    GPIO_setupPinDirection(PWM_OC0_PORT_ID, PWM_OC0_PIN_ID, PIN_OUTPUT);
-	/* Configure timer control register
-	 * 1. Fast PWM mode FOC0=0
-	 * 2. Fast PWM Mode WGM01=1 & WGM00=1
-	 * 3. Clear OC0 when match occurs (non inverted mode) COM00=0 & COM01=1
-	 * 4. clock = F_CPU/8 CS00=0 CS01=1 CS02=0
+	/* Compare value of the duty cycle, the timer counts 0..255 */
+	uint8 compareValue = (uint8)(((uint16)duty_cycle * 255) / 100);
+
+	/* Configure the PWM timer:
+	 * 1. Fast PWM mode
+	 * 2. Clear OC pin when match occurs (non inverted mode)
+	 * 3. clock = F_CPU/8
 	 */
-	TCCR0 = (1 << WGM00) | (1 << WGM01) | (1 << COM01) | (1 << CS01);
+#if PWM_TIMER == TIMER_2
+	Timer2_ConfigType PWM_config = {0, compareValue, TIMER2_F_CPU_8, FAST_PWM_MODE, OC_CLEAR};
+#else
+	Timer0_ConfigType PWM_config = {0, compareValue, F_CPU_8, FAST_PWM_MODE, OC_CLEAR};
+#endif
+
+	/* Set Pwm Pin Direction as output */
+	GPIO_setupPinDirection(PWM_OC_PORT_ID, PWM_OC_PIN_ID, PIN_OUTPUT);
+#if PWM_TIMER == TIMER_2
+	Timer2_init(&PWM_config);
+#else
+	Timer0_init(&PWM_config);
+#endif
 }
@@ -14,13 +14,20 @@
 #define PWM_H_
 
 #include "std_types.h"
+#include "timer_resources.h"
 
 /*******************************************************************************
  *                                Definitions                                  *
  *******************************************************************************/
 
-#define PWM_OC0_PORT_ID     PORTB_ID
-#define PWM_OC0_PIN_ID      PIN3_ID
+/* Output compare pin of the PWM_TIMER */
+#if PWM_TIMER == TIMER_2
+#define PWM_OC_PORT_ID      PORTD_ID
+#define PWM_OC_PIN_ID       PIN7_ID
+#else
+#define PWM_OC_PORT_ID      PORTB_ID
+#define PWM_OC_PIN_ID       PIN3_ID
+#endif
 
 /*******************************************************************************
  *                      Functions Prototypes                                   *
@@ -28,8 +35,9 @@
 
 /*
  * Description :
- * Function responsible for Setting the Motor speed.
+ * Function responsible for Setting the Motor speed: fast PWM at F_CPU/8/256
+ * on the PWM_TIMER, duty cycle in percent.
  */
-void PWM_Timer0_Start(uint8 duty_cycle);
+void PWM_start(uint8 duty_cycle);
 
 #endif /* PWM_H_ */
@@ -0,0 +1,242 @@
+ /******************************************************************************
+ *
+ * Module: Scheduler
+ *
+ * File Name: scheduler.c
+ *
+ * Description: Source file for the cooperative task scheduler
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include "scheduler.h"
+#include <avr/io.h>
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+static const Scheduler_TaskType *g_tasks = NULL_PTR;
+static uint8 g_taskCount = 0;
+
+/* Next periodic release of every task, in us of the time source */
+static uint32 g_release[SCHEDULER_MAX_TASKS];
+
+static Scheduler_StatsType g_stats[SCHEDULER_MAX_TASKS];
+
+/* Event flags posted and not served yet, written by ISRs */
+static volatile uint8 g_events = 0;
+
+static uint32 (*g_timeSourcePtr)(void) = NULL_PTR;
+static void (*g_idleHookPtr)(void) = NULL_PTR;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+static uint32 Scheduler_now(void)
+{
+	return (g_timeSourcePtr != NULL_PTR) ? (*g_timeSourcePtr)() : 0;
+}
+
+/* Clear the given flags, a flag posted by an ISR meanwhile is not lost */
+static void Scheduler_clearEvents(uint8 events)
+{
+	uint8 sreg = SREG;
+
+	SREG &= ~(1<<7);
+	g_events &= ~events;
+	SREG = sreg;
+}
+
+/* Move the release of a periodic task past now, whole periods only to stay on its grid */
+static void Scheduler_nextRelease(uint8 index, uint32 now)
+{
+	uint32 period = (uint32)g_tasks[index].period_ms * 1000UL;
+
+	g_release[index] += period;
+	if((sint32)(now - g_release[index]) >= 0)
+	{
+		/* Late by more than a period: the releases missed meanwhile are dropped */
+		g_release[index] += ((now - g_release[index]) / period + 1) * period;
+	}
+}
+
+/* Index of the first released task, g_taskCount if none */
+static uint8 Scheduler_firstReleased(uint32 now, boolean *periodic)
+{
+	const Scheduler_TaskType *task;
+	uint8 i;
+
+	for(i = 0; i < g_taskCount; i++)
+	{
+		task = &g_tasks[i];
+		*periodic = (task->period_ms != 0 && (sint32)(now - g_release[i]) >= 0);
+		if(*periodic || (g_events & task->events) != 0)
+		{
+			break;
+		}
+	}
+	return i;
+}
+
+/* Run a task and measure it, release is its release time. Returns the end time */
+static uint32 Scheduler_dispatch(uint8 index, uint32 release, boolean periodic)
+{
+	const Scheduler_TaskType *task = &g_tasks[index];
+	Scheduler_StatsType *stats = &g_stats[index];
+	uint32 start = Scheduler_now();
+	uint32 end;
+
+	(*task->run)();
+	end = Scheduler_now();
+
+	stats->runs++;
+	stats->exec_total_us += end - start;
+	if(end - start > stats->exec_max_us)
+	{
+		stats->exec_max_us = end - start;
+	}
+	if(periodic && start - release > stats->jitter_max_us)
+	{
+		stats->jitter_max_us = start - release;
+	}
+	if(task->deadline_ms != 0 && end - release > (uint32)task->deadline_ms * 1000UL)
+	{
+		stats->deadline_misses++;
+	}
+	return end;
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Keep the table and release the periodic tasks now.
+ */
+void Scheduler_init(const Scheduler_TaskType *tasks, uint8 count)
+{
+	uint32 now = Scheduler_now();
+	uint8 i;
+
+	g_tasks = tasks;
+	g_taskCount = (count > SCHEDULER_MAX_TASKS) ? SCHEDULER_MAX_TASKS : count;
+	for(i = 0; i < g_taskCount; i++)
+	{
+		g_release[i] = now;
+	}
+	g_events = 0;
+	Scheduler_resetStats();
+}
+
+/*
+ * Description :
+ * Set the time source of the releases and of the stats.
+ */
+void Scheduler_setTimeSource(uint32(*a_ptr)(void))
+{
+	g_timeSourcePtr = a_ptr;
+}
+
+/*
+ * Description :
+ * Set the idle hook.
+ */
+void Scheduler_setIdleHook(void(*a_ptr)(void))
+{
+	g_idleHookPtr = a_ptr;
+}
+
+/*
+ * Description :
+ * Set the flags with the interrupt disabled, the caller may be a task.
+ */
+void Scheduler_postEvent(uint8 events)
+{
+	uint8 sreg = SREG;
+
+	SREG &= ~(1<<7);
+	g_events |= events;
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Look for the first released task of the table and run it, or call the
+ * idle hook if there is none.
+ */
+void Scheduler_run(void)
+{
+	boolean periodic;
+	uint32 release;
+	uint32 now;
+	uint8 i;
+
+	while(1)
+	{
+		now = Scheduler_now();
+		i = Scheduler_firstReleased(now, &periodic);
+		if(i == g_taskCount)
+		{
+			if(g_idleHookPtr != NULL_PTR)
+			{
+				(*g_idleHookPtr)();
+			}
+			continue;
+		}
+
+		/* The run serves the pending events, the ones posted during it release the task again */
+		Scheduler_clearEvents(g_tasks[i].events);
+		release = periodic ? g_release[i] : now;
+		now = Scheduler_dispatch(i, release, periodic);
+		if(periodic)
+		{
+			/*
+			 * From the end of the run: a task running longer than its period
+			 * is not released again at once, the lower priorities get the CPU
+			 */
+			Scheduler_nextRelease(i, now);
+		}
+	}
+}
+
+/*
+ * Description :
+ * Look for a released task without running it.
+ */
+boolean Scheduler_isReleased(void)
+{
+	boolean periodic;
+
+	return (Scheduler_firstReleased(Scheduler_now(), &periodic) != g_taskCount);
+}
+
+/*
+ * Description :
+ * Copy the stats of one task.
+ */
+void Scheduler_getStats(uint8 task, Scheduler_StatsType *Stats_Ptr)
+{
+	if(task < g_taskCount)
+	{
+		*Stats_Ptr = g_stats[task];
+	}
+}
+
+/*
+ * Description :
+ * Clear the stats of every task.
+ */
+void Scheduler_resetStats(void)
+{
+	Scheduler_StatsType cleared = {0, 0, 0, 0, 0};
+	uint8 i;
+
+	for(i = 0; i < SCHEDULER_MAX_TASKS; i++)
+	{
+		g_stats[i] = cleared;
+	}
+}
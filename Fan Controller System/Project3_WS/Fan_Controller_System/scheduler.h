@@ -0,0 +1,116 @@
+ /******************************************************************************
+ *
+ * Module: Scheduler
+ *
+ * File Name: scheduler.h
+ *
+ * Description: Header file for the cooperative task scheduler. The application
+ *              gives a static table of tasks in priority order, the first one
+ *              has the highest priority. A task is released:
+ *              - every period_ms, on a fixed grid: a late run does not delay
+ *                the next releases,
+ *              - when one of its event flags is posted, from an ISR or from
+ *                another task.
+ *              Scheduler_run runs the highest priority released task to its
+ *              end, then looks again from the top of the table. No task is
+ *              preempted, so the tasks share data without any lock. When no
+ *              task is released the idle hook is called; it may sleep with
+ *              Power_waitFor(&Scheduler_isReleased, ...). Nothing wakes the
+ *              CPU at a periodic release, the next interrupt does: a task
+ *              that must run on time is better released by an event.
+ *
+ *              Every run is measured with the time source: execution time,
+ *              jitter (start time minus release time, periodic releases only)
+ *              and the runs ending after their deadline.
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define SCHEDULER_MAX_TASKS		8
+
+/* Event flag n, 8 flags shared by the tasks of the table */
+#define SCHEDULER_EVENT(n)		((uint8)(1 << (n)))
+
+typedef struct{
+	void (*run)(void);
+	uint16 period_ms;				/* 0 for a task released by its events only */
+	uint16 deadline_ms;				/* from the release to the end of the run, 0 for none */
+	uint8 events;					/* event flags releasing the task */
+}Scheduler_TaskType;
+
+typedef struct{
+	uint32 runs;
+	uint32 exec_total_us;			/* exec_total_us / runs is the average execution time */
+	uint32 exec_max_us;
+	uint32 jitter_max_us;
+	uint16 deadline_misses;
+}Scheduler_StatsType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Take the task table, at most SCHEDULER_MAX_TASKS tasks. The periodic tasks
+ * are released at once, then every period. The stats are cleared.
+ */
+void Scheduler_init(const Scheduler_TaskType *tasks, uint8 count);
+
+/*
+ * Description :
+ * Set the function returning the time in us, e.g. SoftTimer_micros. To be
+ * set before Scheduler_init.
+ */
+void Scheduler_setTimeSource(uint32(*a_ptr)(void));
+
+/*
+ * Description :
+ * Set the function called when no task is released.
+ */
+void Scheduler_setIdleHook(void(*a_ptr)(void));
+
+/*
+ * Description :
+ * Post event flags: the tasks waiting for one of them are released. Safe to
+ * call from an ISR or a task. A flag posted again before its task runs is
+ * only served once.
+ */
+void Scheduler_postEvent(uint8 events);
+
+/*
+ * Description :
+ * Run the released tasks forever, it never returns.
+ */
+void Scheduler_run(void);
+
+/*
+ * Description :
+ * Return TRUE if a task is released: a pending event or a periodic release
+ * reached. Safe with the interrupts disabled, as a Power_waitFor condition.
+ */
+boolean Scheduler_isReleased(void);
+
+/*
+ * Description :
+ * Copy the stats of a task, by its index in the table.
+ */
+void Scheduler_getStats(uint8 task, Scheduler_StatsType *Stats_Ptr);
+
+/*
+ * Description :
+ * Clear the stats of all the tasks.
+ */
+void Scheduler_resetStats(void);
+
+#endif /* SCHEDULER_H_ */
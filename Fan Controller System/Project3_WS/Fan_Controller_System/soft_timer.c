@@ -0,0 +1,279 @@
+ /******************************************************************************
+ *
+ * Module: Software Timer
+ *
+ * File Name: soft_timer.c
+ *
+ * Description: Source file for the software timer service
+ *
+ * Author: Ahmed Hazem
+ *
+ *******************************************************************************/
+
+#include "soft_timer.h"
+#include <avr/io.h>
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Ticks counted by the Timer1 interrupt, the time base of the list and of the clock */
+static volatile uint32 g_tickCount = 0;
+
+/* Called from the tick interrupt after the count */
+static void (*volatile g_tickCallBackPtr)(void) = NULL_PTR;
+
+/* Running timers by expiry, the delta of the head counts from g_listTime */
+static SoftTimer_Type *g_head = NULL_PTR;
+static uint16 g_listTime = 0;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/* Timer1 callback: the whole interrupt work, whatever the number of timers */
+static void SoftTimer_tick(void)
+{
+	g_tickCount++;
+	if(g_tickCallBackPtr != NULL_PTR)
+	{
+		(*g_tickCallBackPtr)();
+	}
+}
+
+/* Read the tick count with the interrupt disabled, the list only needs its low half */
+static uint16 SoftTimer_now(void)
+{
+	uint8 sreg = SREG;
+	uint16 now;
+
+	SREG &= ~(1<<7);
+	now = (uint16)g_tickCount;
+	SREG = sreg;
+	return now;
+}
+
+/*
+ * Read the tick count and the Timer1 count together. A compare match during
+ * the read leaves its interrupt pending: the count has wrapped, so the tick
+ * is added here. A count still close to the top was read before the match.
+ */
+static uint32 SoftTimer_sample(uint16 *count)
+{
+	uint8 sreg = SREG;
+	uint32 ticks;
+
+	SREG &= ~(1<<7);
+	ticks = g_tickCount;
+	*count = Timer1_getCount();
+	if(Timer1_isComparePending() && *count < SOFT_TIMER_COMPARE_VALUE / 2)
+	{
+		ticks++;
+	}
+	SREG = sreg;
+	return ticks;
+}
+
+/* Link a timer expiring offset ticks after g_listTime, after the timers expiring at the same tick */
+static void SoftTimer_insert(SoftTimer_Type *timer, uint16 offset)
+{
+	SoftTimer_Type **link = &g_head;
+
+	while(*link != NULL_PTR && (*link)->delta <= offset)
+	{
+		offset -= (*link)->delta;
+		link = &(*link)->next;
+	}
+
+	timer->delta = offset;
+	timer->next = *link;
+	if(timer->next != NULL_PTR)
+	{
+		/* The next timer now counts from this one */
+		timer->next->delta -= offset;
+	}
+	*link = timer;
+	timer->running = TRUE;
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Start Timer1 in CTC mode with the tick period.
+ */
+void SoftTimer_init(void)
+{
+	Timer1_ConfigType TIMER1_config = {0,
+									   SOFT_TIMER_COMPARE_VALUE,
+									   SOFT_TIMER_PRESCALER,
+									   COMPARE_MODE};
+
+	Timer1_setCallBack(&SoftTimer_tick);
+	Timer1_init(&TIMER1_config);
+}
+
+/*
+ * Description :
+ * Set the function called from the tick interrupt.
+ */
+void SoftTimer_setTickCallBack(void(*a_ptr)(void))
+{
+	g_tickCallBackPtr = a_ptr;
+}
+
+/*
+ * Description :
+ * Set the expiry callback of a timer.
+ */
+void SoftTimer_setCallBack(SoftTimer_Type *timer, void(*a_ptr)(void))
+{
+	timer->callBack = a_ptr;
+}
+
+/*
+ * Description :
+ * Insert the timer at its place in the list, a running one is moved.
+ */
+void SoftTimer_start(SoftTimer_Type *timer, uint16 delay, uint16 period)
+{
+	uint16 now = SoftTimer_now();
+
+	SoftTimer_stop(timer);
+	timer->delay = (delay > SOFT_TIMER_MAX_TICKS) ? SOFT_TIMER_MAX_TICKS : delay;
+	timer->period = (period > SOFT_TIMER_MAX_TICKS) ? SOFT_TIMER_MAX_TICKS : period;
+
+	if(g_head == NULL_PTR)
+	{
+		g_listTime = now;
+	}
+	/* The ticks not handled yet by SoftTimer_update are part of the offset */
+	SoftTimer_insert(timer, (uint16)(now - g_listTime) + timer->delay);
+}
+
+/*
+ * Description :
+ * Start the timer with its last delay and period.
+ */
+void SoftTimer_restart(SoftTimer_Type *timer)
+{
+	SoftTimer_start(timer, timer->delay, timer->period);
+}
+
+/*
+ * Description :
+ * Unlink the timer, the next one takes its delta.
+ */
+void SoftTimer_stop(SoftTimer_Type *timer)
+{
+	SoftTimer_Type **link = &g_head;
+
+	if(!timer->running)
+	{
+		return;
+	}
+
+	while(*link != timer)
+	{
+		link = &(*link)->next;
+	}
+	*link = timer->next;
+	if(timer->next != NULL_PTR)
+	{
+		timer->next->delta += timer->delta;
+	}
+	timer->running = FALSE;
+}
+
+/*
+ * Description :
+ * Return the running state of the timer.
+ */
+boolean SoftTimer_isRunning(const SoftTimer_Type *timer)
+{
+	return timer->running;
+}
+
+/*
+ * Description :
+ * Add the deltas up to the timer and remove the ticks already elapsed.
+ */
+uint16 SoftTimer_remaining(const SoftTimer_Type *timer)
+{
+	const SoftTimer_Type *current;
+	uint16 expiry = 0;
+	uint16 elapsed;
+
+	if(!timer->running)
+	{
+		return 0;
+	}
+
+	for(current = g_head; current != timer; current = current->next)
+	{
+		expiry += current->delta;
+	}
+	expiry += timer->delta;
+	elapsed = (uint16)(SoftTimer_now() - g_listTime);
+	return (expiry > elapsed) ? (expiry - elapsed) : 0;
+}
+
+/*
+ * Description :
+ * Remove the expired timers from the head of the list and call their
+ * callbacks. A periodic timer is linked again before its callback, which
+ * may then stop it.
+ */
+void SoftTimer_update(void)
+{
+	uint16 now = SoftTimer_now();
+	SoftTimer_Type *timer;
+
+	while(g_head != NULL_PTR && (uint16)(now - g_listTime) >= g_head->delta)
+	{
+		timer = g_head;
+		g_listTime += timer->delta;
+		g_head = timer->next;
+
+		if(timer->period != 0)
+		{
+			/* From the expiry time: no drift if the main loop is late */
+			SoftTimer_insert(timer, timer->period);
+		}
+		else
+		{
+			timer->running = FALSE;
+		}
+
+		if(timer->callBack != NULL_PTR)
+		{
+			(*timer->callBack)();
+		}
+	}
+}
+
+/*
+ * Description :
+ * Whole ms of the ticks plus the ms of the current tick.
+ */
+uint32 SoftTimer_millis(void)
+{
+	uint16 count;
+	uint32 ticks = SoftTimer_sample(&count);
+
+	return ticks * SOFT_TIMER_TICK_MS + count / SOFT_TIMER_COUNTS_PER_MS;
+}
+
+/*
+ * Description :
+ * us of the ticks plus the Timer1 count in us.
+ */
+uint32 SoftTimer_micros(void)
+{
+	uint16 count;
+	uint32 ticks = SoftTimer_sample(&count);
+
+	return ticks * (SOFT_TIMER_TICK_MS * 1000UL) + (uint32)count * SOFT_TIMER_US_PER_COUNT;
+}
@@ -7,12 +7,14 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
-#include <util/delay.h>
+#include <avr/sleep.h>
+#ifdef ISR_PROFILE
+#include <stdlib.h>
+#endif
 
 // Global Variables
-volatile unsigned char Runningflag = 0; // Flag to indicate if the stop watch is running
-volatile unsigned char Pauseflag = 0; // Flag to indicate if the stop watch is paused
-volatile unsigned char Resumeflag = 0; // Flag to indicate if the stop watch is resumed
+volatile unsigned char Runningflag = 0; // Flag set by Timer2 every second
+volatile unsigned char displayDigit = 0; // Seven-segment digit shown by the Timer0 ISR
 volatile unsigned char secCount1 = 0; // Ones place of seconds
 volatile unsigned char secCount2 = 0; // Tens place of seconds
 volatile unsigned char minCount1 = 0; // Ones place of minutes
@@ -20,20 +22,51 @@ volatile unsigned char minCount2 = 0; // Tens place of minutes
 volatile unsigned char hourCount1 = 0; // Ones place of hours
 volatile unsigned char hourCount2 = 0; // Tens place of hours
 
-// Initializes Timer1 in CTC mode for a resolution of 1 millisecond
-void Timer1_Init_CTC_Mode(void)
+#ifdef ISR_PROFILE
+/* Optional ISR profiler, built with -DISR_PROFILE: each ISR times itself on
+ * Timer1, free-running at 1MHz, and the main loop sends the run count and the
+ * average and max execution times in us on the UART (TXD/PD1, 9600 baud) every
+ * minute. The time of the ISRs with a cli()/sei() block is taken before their
+ * sei(). The entry latency is not measured: nothing records when these
+ * interrupts were requested, on the 1 us scale */
+#define PROFILE_TIMER0_COMP	0
+#define PROFILE_TIMER2_OVF	1
+#define PROFILE_INT0		2
+#define PROFILE_INT1		3
+#define PROFILE_INT2		4
+#define PROFILE_VECTORS		5
+
+typedef struct
 {
-	/*For a stop watch, we want a timer resolution of 1 millisecond (ms)or less, for
-	 * resolution of 1ms we can use prescaler of 64, Timer Resolution = 1 / (1MHz * 64 * OCR1A) = 1ms
-	  Then OCR1A = (1 / (1MHz * 64)) * 1000 = 15.625 */
+	unsigned long runs;
+	unsigned long total; // Sum of the execution times in us
+	unsigned int max;	 // Longest execution time in us
+}ProfileStats;
 
-	TCNT1 = 0;
-	OCR1A = 15625;
-	TIMSK |= (1<<OCIE1A);			  //Timer Interrupt Enable
-	TCCR1A = (1<<FOC1A) | (1<<FOC1B); // Non PWM
-	TCCR1B = (1<<WGM12) | (1<<CS11) | (1<<CS10); //Prescaler of 64, CTC
+volatile ProfileStats profileStats[PROFILE_VECTORS];
 
+#define PROFILE_ENTER()			unsigned int profileEntry = TCNT1
+#define PROFILE_EXIT(vector)	Profile_Record(vector, profileEntry)
+#else
+#define PROFILE_ENTER()
+#define PROFILE_EXIT(vector)
+#endif
+
+// Initializes Timer2 as a real-time clock on the 32.768 kHz watch crystal at TOSC1/TOSC2 (PC6/PC7)
+void Timer2_Init_RTC_Mode(void)
+{
+	/* The seconds no longer come from the 1MHz RC oscillator, which may be a few %
+	 * off: Timer Overflow = 256 * 128 / 32768Hz = 1 second, as exact as the crystal.
+	 * In asynchronous mode a register write takes up to 2 crystal cycles to reach
+	 * the timer, the busy flags of ASSR tell when it is done */
 
+	TIMSK &= ~(1<<TOIE2);			  //No interrupt while the clock source changes
+	ASSR = (1<<AS2);				  //Clock from the crystal oscillator
+	TCNT2 = 0;
+	TCCR2 = (1<<CS22) | (1<<CS20);	  //Prescaler of 128, Normal mode
+	while(ASSR & ((1<<TCN2UB) | (1<<TCR2UB)));
+	TIFR = (1<<TOV2);				  //Clear the flag raised by the switch
+	TIMSK |= (1<<TOIE2);			  //Timer Interrupt Enable
 }
 
 // Initializes INT0 for the Reset button
@@ -60,77 +93,177 @@ void INT2_Init(void)
 	GICR |= (1<<INT2);				//Enable Module Interrupt (INT2)
 }
 
-// Displays the stop watch time on a seven-segment display
-void displaySevenSegment()
+// Initializes Timer0 in CTC mode to multiplex the seven-segment display
+void Timer0_Init_CTC_Mode(void)
+{
+	/* One digit per interrupt: 1MHz / 64 / (OCR0 + 1) = 601 Hz, so each of the
+	 * 6 digits is refreshed 100 times per second without flicker */
+
+	TCNT0 = 0;
+	OCR0 = 25;
+	TIMSK |= (1<<OCIE0);			  //Timer Interrupt Enable
+	TCCR0 = (1<<FOC0) | (1<<WGM01) | (1<<CS01) | (1<<CS00); //Prescaler of 64, CTC
+}
+
+#ifdef ISR_PROFILE
+// Initializes Timer1 as the free-running time base of the profiler
+void Timer1_Init_Profile(void)
+{
+	TCNT1 = 0;
+	TCCR1A = 0;
+	TCCR1B = (1<<CS10);				  //No prescaler: 1 count per us, Normal mode
+}
+
+// Initializes the UART transmitter for the profiler reports, 8 bits, no parity, 1 stop bit
+void UART_Init_Profile(void)
+{
+	UCSRA = (1<<U2X);				  //Double speed: 1MHz / 8 / (12 + 1) = 9615 baud
+	UCSRB = (1<<TXEN);
+	UCSRC = (1<<URSEL) | (1<<UCSZ1) | (1<<UCSZ0);
+	UBRRH = 0;
+	UBRRL = 12;
+}
+
+void UART_sendString(const char *str)
+{
+	while(*str != '\0')
+	{
+		while(!(UCSRA & (1<<UDRE)));
+		UDR = *str++;
+	}
+}
+
+void UART_sendNumber(unsigned long number)
+{
+	char digits[11];
+
+	ultoa(number, digits, 10);
+	UART_sendString(digits);
+}
+
+// Adds the time since the entry of an ISR to its stats, called with the interrupts disabled
+void Profile_Record(unsigned char vector, unsigned int entry)
+{
+	unsigned int time = TCNT1 - entry; // Modulo 2^16 across a wrap of Timer1
+
+	profileStats[vector].runs++;
+	profileStats[vector].total += time;
+	if(time > profileStats[vector].max)
+	{
+		profileStats[vector].max = time;
+	}
+}
+
+// Sends one line per ISR: name, runs, average and max execution time in us
+void Profile_Report(void)
 {
-	// Display ones place of seconds
-	PORTA = (PORTA & 0xC0) | 0x01;
-	PORTC = (PORTC & 0xF0) | (secCount1 & 0x0F);
-	_delay_us(50);
+	static const char *const names[PROFILE_VECTORS] = {"TIMER0_COMP", "TIMER2_OVF", "INT0", "INT1", "INT2"};
+	ProfileStats stats;
+	unsigned char i;
 
-	// Display tens place of seconds
-	PORTA = (PORTA & 0xC0) | 0x02;
-	PORTC = (PORTC & 0xF0) | (secCount2 & 0x0F);
-	_delay_us(50);
+	for(i = 0; i < PROFILE_VECTORS; i++)
+	{
+		cli();
+		stats = profileStats[i];
+		sei();
+		UART_sendString(names[i]);
+		UART_sendString(" runs ");
+		UART_sendNumber(stats.runs);
+		UART_sendString(" avg ");
+		UART_sendNumber((stats.runs != 0) ? stats.total / stats.runs : 0);
+		UART_sendString(" max ");
+		UART_sendNumber(stats.max);
+		UART_sendString(" us\r\n");
+	}
+}
+#endif
+
+// Sleeps in idle mode until the flag is set by an ISR
+void waitForFlag(volatile unsigned char *flag)
+{
+	cli();
+	while(*flag == 0)
+	{
+		sleep_enable();
+		// SEI takes effect after SLEEP: an interrupt setting the flag after the check still wakes the CPU
+		sei();
+		sleep_cpu();
+		sleep_disable();
+		cli();
+	}
+	sei();
+}
 
-	// Display ones place of minutes
-	PORTA = (PORTA & 0xC0) | 0x04;
-	PORTC = (PORTC & 0xF0) | (minCount1 & 0x0F);
-	_delay_us(50);
+// Displays the next digit of the stop watch time on the seven-segment display
+ISR(TIMER0_COMP_vect)
+{
+	PROFILE_ENTER();
+	unsigned char value; // PROFILE_ENTER() declares the entry time first, to take it first
 
-	// Display tens place of minutes
-	PORTA = (PORTA & 0xC0) | 0x08;
-	PORTC = (PORTC & 0xF0) | (minCount2 & 0x0F);
-	_delay_us(50);
+	switch(displayDigit)
+	{
+	case 0: value = secCount1; break;	// Ones place of seconds
+	case 1: value = secCount2; break;	// Tens place of seconds
+	case 2: value = minCount1; break;	// Ones place of minutes
+	case 3: value = minCount2; break;	// Tens place of minutes
+	case 4: value = hourCount1; break;	// Ones place of hours
+	default: value = hourCount2; break;	// Tens place of hours
+	}
 
-	// Display ones place of hours
-	PORTA = (PORTA & 0xC0) | 0x10;
-	PORTC = (PORTC & 0xF0) | (hourCount1 & 0x0F);
-	_delay_us(50);
+	PORTA = (PORTA & 0xC0) | (1<<displayDigit);
+	PORTC = (PORTC & 0xF0) | (value & 0x0F);
 
-	// Display tens place of hours
-	PORTA = (PORTA & 0xC0) | 0x20;
-	PORTC = (PORTC & 0xF0) | (hourCount2 & 0x0F);
-	_delay_us(50);
+	displayDigit++;
+	if(displayDigit == 6)
+	{
+		displayDigit = 0;
+	}
+	PROFILE_EXIT(PROFILE_TIMER0_COMP);
 }
 
-// Timer1 ISR
-ISR(TIMER1_COMPA_vect)
+// Timer2 ISR, every second of the crystal
+ISR(TIMER2_OVF_vect)
 {
+	PROFILE_ENTER();
 	cli();
 	Runningflag = 1;
+	PROFILE_EXIT(PROFILE_TIMER2_OVF);
 	sei();
 }
 
 // Reset Button ISR
 ISR(INT0_vect)
 {
+	PROFILE_ENTER();
 	cli();
-	TIMSK &= ~(1<<OCIE1A); //Disable Timer Interrupt
+	TIMSK &= ~(1<<TOIE2); //Disable Timer Interrupt
 	secCount1 = 0;
 	secCount2 = 0;
 	minCount1 = 0;
 	minCount2 = 0;
 	hourCount1 = 0;
 	hourCount2 = 0;
+	PROFILE_EXIT(PROFILE_INT0);
 	sei();
 }
 
 // Pause Button ISR
 ISR(INT1_vect)
 {
+	PROFILE_ENTER();
 	cli();
-	TIMSK &= ~(1<<OCIE1A); //Disable Timer Interrupt
-	Pauseflag = 1;
+	TIMSK &= ~(1<<TOIE2); //Disable Timer Interrupt, the display goes on
+	PROFILE_EXIT(PROFILE_INT1);
 	sei();
 }
 
 //Resume Button ISR
 ISR(INT2_vect)
 {
+	PROFILE_ENTER();
 	cli();
-	TIMSK |= (1<<OCIE1A); //Enable Timer Interrupt
-	Resumeflag = 1;
+	TIMSK |= (1<<TOIE2); //Enable Timer Interrupt
+	PROFILE_EXIT(PROFILE_INT2);
 	sei();
 }
 
@@ -154,59 +287,55 @@ int main(void)
 	INT0_Init(); // Initialize Reset button
 	INT1_Init(); // Initialize Pause button
 	INT2_Init(); // Initialize Resume button
-	Timer1_Init_CTC_Mode(); // Initialize Timer1 in CTC mode
+	Timer2_Init_RTC_Mode(); // Initialize the seconds on the crystal
+	Timer0_Init_CTC_Mode(); // Initialize the display refresh
+#ifdef ISR_PROFILE
+	Timer1_Init_Profile(); // Initialize the profiler time base
+	UART_Init_Profile(); // Initialize the profiler reports
+#endif
 	sei();
 
 	while(1)
 	{
-		if(Runningflag)
+		// Sleep until the next second, paused or not the Timer0 ISR keeps the display on
+		waitForFlag(&Runningflag);
+
+		secCount1++;
+		if (secCount1 == 10)
 		{
-			secCount1++;
-			if (secCount1 == 10)
-			{
-				secCount2++;
-				secCount1 = 0;
-			}
-			if(secCount2 == 6)
-			{
-				secCount2 = 0;
-				minCount1++;
-			}
-			if (minCount1 == 10)
-			{
-				minCount2++;
-				minCount1 = 0;
-			}
-			if (minCount2 == 6)
-			{
-				minCount2 = 0;
-				hourCount1++;
-			}
-			if (hourCount1 == 9)
-			{
-				hourCount2++;
-				hourCount1 = 0;
-			}
-
-			Runningflag = 0;
+			secCount2++;
+			secCount1 = 0;
 		}
-		else
+		if(secCount2 == 6)
 		{
-			displaySevenSegment();
+			secCount2 = 0;
+			minCount1++;
 		}
-
-		while(Pauseflag == 1)
+		if (minCount1 == 10)
 		{
-			displaySevenSegment();
-
-			if(Resumeflag == 1)
-			{
-				Resumeflag = 0;
-				Pauseflag = 0;
-			}
+			minCount2++;
+			minCount1 = 0;
+		}
+		if (minCount2 == 6)
+		{
+			minCount2 = 0;
+			hourCount1++;
+		}
+		if (hourCount1 == 9)
+		{
+			hourCount2++;
+			hourCount1 = 0;
 		}
 
+		Runningflag = 0;
+
+#ifdef ISR_PROFILE
+		// Report the ISR stats every minute
+		if(secCount1 == 0 && secCount2 == 0)
+		{
+			Profile_Report();
+		}
+#endif
 	}
 
 }
-